@@ -28,6 +28,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include <lib/document/documentfactory.h>
+#include <lib/imagescaling.h>
 #include <lib/semanticinfo/sorteddirmodel.h>
 
 namespace Gwenview
@@ -59,7 +60,7 @@ void DocumentInfoProvider::thumbnailForDocument(const QUrl &url, ThumbnailGroup:
 
     QImage image = doc->image();
     if (image.width() > pixelSize || image.height() > pixelSize) {
-        image = image.scaled(pixelSize, pixelSize, Qt::KeepAspectRatio);
+        image = ImageScaling::scaled(image, QSize(pixelSize, pixelSize), Qt::KeepAspectRatio, ImageScaling::Box);
     }
     *outPix = QPixmap::fromImage(image);
     *outFullSize = doc->size();
@@ -22,22 +22,32 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Qt
 #include <QApplication>
 #include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
 #include <QPointer>
 #include <QScopedPointer>
+#include <QSet>
 #include <QStringList>
-#include <QTemporaryDir>
 #include <QUrl>
 
 // KF
 #include <KAboutData>
 #include <KActionCollection>
-#include <KIO/CopyJob>
 #include <KLocalizedString>
 
 // Local
 #include "mainwindow.h"
 #include <lib/about.h>
+#include <lib/document/documentfactory.h>
 #include <lib/gwenviewconfig.h>
+#include <lib/tracing.h>
+
+#ifdef HAVE_QTDBUS
+#include "memoryaccountingservice.h"
+#include "singleinstance.h"
+#include "tracingservice.h"
+#endif
 
 #ifdef HAVE_FITS
 // This hack is needed to include the fitsplugin moc file in main.cpp
@@ -50,7 +60,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // To shut up libtiff
 #ifdef HAVE_TIFF
-#include <QLoggingCategory>
 #include <tiffio.h>
 
 // To enable AVIF/HEIF/JPEG-XL metadata support in Exiv2
@@ -75,6 +84,72 @@ static void handleTiffError(const char *mod, const char *fmt, va_list ap)
 } // namespace
 #endif
 
+namespace
+{
+Q_DECLARE_LOGGING_CATEGORY(StartupTraceLog)
+Q_LOGGING_CATEGORY(StartupTraceLog, "org.kde.kdegraphics.gwenview.startup", QtInfoMsg)
+
+/**
+ * Logs the time spent since the process started, or since the running
+ * instance received a request, when the debug output of StartupTraceLog is
+ * enabled. --startup-trace enables it.
+ */
+class StartupTrace
+{
+public:
+    static void init()
+    {
+        sEnabled = StartupTraceLog().isDebugEnabled();
+        if (sEnabled) {
+            sTimer.start();
+        }
+    }
+
+    static void restart()
+    {
+        if (sEnabled) {
+            sTimer.restart();
+            sWaitingForDocument = true;
+        }
+    }
+
+    static void step(const char *name)
+    {
+        if (sEnabled) {
+            qCDebug(StartupTraceLog, "%6lld ms %s", static_cast<long long>(sTimer.elapsed()), name);
+        }
+    }
+
+    /**
+     * Logs a step the first time a document is ready after init() or
+     * restart()
+     */
+    static void watchFirstDocument()
+    {
+        if (!sEnabled) {
+            return;
+        }
+        sWaitingForDocument = true;
+        QObject::connect(Gwenview::DocumentFactory::instance(), &Gwenview::DocumentFactory::readyForDirListerStart, qApp, [] {
+            if (sWaitingForDocument) {
+                sWaitingForDocument = false;
+                step("first document ready");
+            }
+        });
+    }
+
+private:
+    static bool sEnabled;
+    static bool sWaitingForDocument;
+    static QElapsedTimer sTimer;
+};
+
+bool StartupTrace::sEnabled = false;
+bool StartupTrace::sWaitingForDocument = false;
+QElapsedTimer StartupTrace::sTimer;
+
+} // namespace
+
 class StartHelper
 {
 public:
@@ -90,29 +165,28 @@ public:
     void parseArgs(const QStringList &args, bool fullscreen, bool slideshow)
     {
         if (args.count() > 1) {
-            // Create a temp dir containing links to url args
-            mMultipleUrlsDir.reset(new QTemporaryDir);
-            mUrl = QUrl::fromLocalFile(mMultipleUrlsDir->path());
-            QList<QUrl> list;
-            QStringList tmpArgs = args;
-            tmpArgs.removeDuplicates();
-            QStringList fileNames;
-            for (const QString &url : qAsConst(tmpArgs)) {
-                QUrl fileUrl = QUrl::fromUserInput(url, QDir::currentPath(), QUrl::AssumeLocalFile);
-                if (!fileNames.contains(fileUrl.fileName())) {
-                    fileNames << fileUrl.fileName();
-                    list << fileUrl;
+            // Browse the url args as a list, the main window adds them to its
+            // model once it is shown
+            const QString currentPath = QDir::currentPath();
+            QSet<QUrl> knownUrls;
+            knownUrls.reserve(args.count());
+            mUrlList.reserve(args.count());
+            for (const QString &arg : args) {
+                const QUrl url = QUrl::fromUserInput(arg, currentPath, QUrl::AssumeLocalFile);
+                if (url.isValid() && !knownUrls.contains(url)) {
+                    knownUrls.insert(url);
+                    mUrlList << url;
                 }
             }
-
-            KIO::CopyJob *job = KIO::link(list, mUrl);
-            job->exec();
+            if (mUrlList.count() == 1) {
+                mUrl = mUrlList.takeFirst();
+            }
         } else {
             QString tmpArg = args.first();
             mUrl = QUrl::fromUserInput(tmpArg, QDir::currentPath(), QUrl::AssumeLocalFile);
         }
 
-        if (mUrl.isValid() && (fullscreen || slideshow)) {
+        if ((mUrl.isValid() || !mUrlList.isEmpty()) && (fullscreen || slideshow)) {
             mFullScreen = true;
             if (slideshow) {
                 mSlideShow = true;
@@ -120,16 +194,45 @@ public:
         }
     }
 
+    /**
+     * The urls to open, as absolute urls which can be handed to another
+     * process
+     */
+    QStringList urls() const
+    {
+        QStringList list;
+        if (mUrl.isValid()) {
+            list << mUrl.toString();
+        }
+        for (const QUrl &url : mUrlList) {
+            list << url.toString();
+        }
+        return list;
+    }
+
+    bool fullScreen() const
+    {
+        return mFullScreen;
+    }
+
+    bool slideShow() const
+    {
+        return mSlideShow;
+    }
+
     void createMainWindow()
     {
         mMainWindow = new Gwenview::MainWindow();
         if (mUrl.isValid()) {
             mMainWindow->setInitialUrl(mUrl);
-        } else {
+        } else if (mUrlList.isEmpty()) {
             mMainWindow->showStartMainPage();
         }
 
         mMainWindow->show();
+        if (!mUrlList.isEmpty()) {
+            mMainWindow->setInitialUrlList(mUrlList);
+        }
         if (mFullScreen) {
             mMainWindow->actionCollection()->action(QStringLiteral("fullscreen"))->trigger();
         }
@@ -139,11 +242,32 @@ public:
         }
     }
 
+    /**
+     * Opens the urls in an already existing window
+     */
+    void reuseMainWindow(Gwenview::MainWindow *window)
+    {
+        mMainWindow = window;
+        if (mUrl.isValid()) {
+            mMainWindow->setInitialUrl(mUrl);
+        } else if (!mUrlList.isEmpty()) {
+            mMainWindow->setInitialUrlList(mUrlList);
+        }
+        if (mFullScreen && !mMainWindow->isFullScreen()) {
+            mMainWindow->actionCollection()->action(QStringLiteral("fullscreen"))->trigger();
+        }
+        if (mSlideShow) {
+            mMainWindow->startSlideShow();
+        }
+        mMainWindow->raise();
+        mMainWindow->activateWindow();
+    }
+
 private:
     QUrl mUrl;
+    QList<QUrl> mUrlList;
     bool mFullScreen;
     bool mSlideShow;
-    QScopedPointer<QTemporaryDir> mMultipleUrlsDir;
     QPointer<Gwenview::MainWindow> mMainWindow;
 };
 
@@ -183,19 +307,72 @@ int main(int argc, char *argv[])
     aboutData.data()->setupCommandLine(&parser);
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("f") << QStringLiteral("fullscreen"), i18n("Start in fullscreen mode")));
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("s") << QStringLiteral("slideshow"), i18n("Start in slideshow mode")));
+    parser.addOption(QCommandLineOption(QStringLiteral("single-instance"), i18n("Open the files in the running instance of Gwenview, if any")));
+    parser.addOption(QCommandLineOption(QStringLiteral("new-window"), i18n("Open a new window in the running instance instead of reusing one")));
+    parser.addOption(QCommandLineOption(QStringLiteral("startup-trace"), i18n("Print the time spent in the startup steps")));
     parser.addPositionalArgument("url", i18n("A starting file or folders"));
     parser.process(app);
     aboutData.data()->processCommandLine(&parser);
 
-    // startHelper must live for the whole life of the application
+    if (parser.isSet(QStringLiteral("startup-trace"))) {
+        QLoggingCategory::setFilterRules(QStringLiteral("org.kde.kdegraphics.gwenview.startup.debug=true"));
+    }
+    StartupTrace::init();
+    StartupTrace::watchFirstDocument();
+    StartupTrace::step("command line parsed");
+    Gwenview::Tracing::initFromEnvironment();
+
     StartHelper startHelper(parser.positionalArguments(),
                             parser.isSet(QStringLiteral("f")) ? true : Gwenview::GwenviewConfig::fullScreenModeActive(),
                             parser.isSet(QStringLiteral("s")));
+
+#ifdef HAVE_QTDBUS
+    const bool singleInstance = !app.isSessionRestored() && (parser.isSet(QStringLiteral("single-instance")) || Gwenview::GwenviewConfig::singleInstance());
+    if (singleInstance
+        && Gwenview::SingleInstance::forward(startHelper.urls(),
+                                             parser.isSet(QStringLiteral("new-window")),
+                                             startHelper.fullScreen(),
+                                             startHelper.slideShow())) {
+        StartupTrace::step("forwarded to running instance");
+        return 0;
+    }
+#endif
+
     if (app.isSessionRestored()) {
         kRestoreMainWindows<Gwenview::MainWindow>();
     } else {
         startHelper.createMainWindow();
     }
+    StartupTrace::step("main window shown");
+
+#ifdef HAVE_QTDBUS
+    if (singleInstance) {
+        auto openUrls = [](const QStringList &urls, bool newWindow, bool fullScreen, bool slideShow) {
+            StartupTrace::restart();
+            StartupTrace::step("request received");
+            // The window does not need the helper once the urls are passed to
+            // it, url lists are listed by its dir lister
+            StartHelper helper(urls, fullScreen, slideShow);
+
+            Gwenview::MainWindow *window = nullptr;
+            if (!newWindow) {
+                const QList<KMainWindow *> windows = KMainWindow::memberList();
+                for (auto it = windows.rbegin(); it != windows.rend() && !window; ++it) {
+                    window = qobject_cast<Gwenview::MainWindow *>(*it);
+                }
+            }
+            if (window) {
+                helper.reuseMainWindow(window);
+            } else {
+                helper.createMainWindow();
+            }
+            StartupTrace::step("urls opened");
+        };
+        new Gwenview::SingleInstance(openUrls, &app);
+    }
+    new Gwenview::TracingService(&app);
+    new Gwenview::MemoryAccountingService(&app);
+#endif
 
     // Workaround for QTBUG-38613
     // Another solution would be to port BalooSemanticInfoBackend::refreshAllTags
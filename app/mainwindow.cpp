@@ -88,12 +88,14 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "gwenview_app_debug.h"
 #include "imageopscontextmanageritem.h"
 #include "infocontextmanageritem.h"
+#include "memoryoverlay.h"
 #include "viewmainpage.h"
 #ifndef GWENVIEW_SEMANTICINFO_BACKEND_NONE
 #include "semanticinfocontextmanageritem.h"
 #endif
 #include "browsemainpage.h"
 #include "preloader.h"
+#include "slideshowprefetcher.h"
 #include "savebar.h"
 #include "sidebar.h"
 #include "splitter.h"
@@ -188,6 +190,7 @@ struct MainWindow::Private {
     SaveBar *mSaveBar = nullptr;
     bool mStartSlideShowWhenDirListerCompleted;
     SlideShow *mSlideShow = nullptr;
+    SlideShowPrefetcher *mSlideShowPrefetcher = nullptr;
 #ifdef HAVE_QTDBUS
     Mpris2Service *mMpris2Service = nullptr;
 #endif
@@ -263,10 +266,14 @@ struct MainWindow::Private {
         layout->addWidget(mViewStackedWidget);
         layout->setContentsMargins(0, 0, 0, 0);
         layout->setSpacing(0);
+        if (MemoryOverlay::isEnabled()) {
+            new MemoryOverlay(mContentWidget);
+        }
         ////
 
         mStartSlideShowWhenDirListerCompleted = false;
         mSlideShow = new SlideShow(q);
+        mSlideShowPrefetcher = new SlideShowPrefetcher(mSlideShow, mViewStackedWidget, q);
         connect(mContextManager, &ContextManager::currentUrlChanged, mSlideShow, &SlideShow::setCurrentUrl);
 
         setupThumbnailView(mViewStackedWidget);
@@ -1115,6 +1122,14 @@ void MainWindow::setInitialUrl(const QUrl &_url)
     }
 }
 
+void MainWindow::setInitialUrlList(const QList<QUrl> &urls)
+{
+    d->mBrowseAction->trigger();
+    d->mThumbnailProvider->stop();
+    d->mContextManager->setUrlList(urls);
+    d->mViewMainPage->reset();
+}
+
 void MainWindow::startSlideShow()
 {
     d->mViewAction->trigger();
@@ -1416,6 +1431,10 @@ void MainWindow::slotDirModelNewItems()
 
 void MainWindow::slotDirListerCompleted()
 {
+    if (d->mContextManager->isPopulatingUrlList()) {
+        // Wait for the items of the list
+        return;
+    }
     if (d->mStartSlideShowWhenDirListerCompleted) {
         d->mStartSlideShowWhenDirListerCompleted = false;
         QTimer::singleShot(0, d->mToggleSlideShowAction, &QAction::trigger);
@@ -1828,6 +1847,11 @@ void MainWindow::preloadNextUrl()
         return;
     }
 
+    if (d->mSlideShow->isRunning()) {
+        // The slideshow prefetcher knows which url comes next
+        return;
+    }
+
     if (d->mCurrentMainPageId == ViewMainPageId) {
         // If we are in view mode, preload the next url, otherwise preload the
         // selected one
@@ -48,6 +48,12 @@ public:
      */
     void setInitialUrl(const QUrl &);
 
+    /**
+     * Defines several urls to browse when the window is shown for the first
+     * time, as if they were in the same folder
+     */
+    void setInitialUrlList(const QList<QUrl> &);
+
     void startSlideShow();
 
     ViewMainPage *viewMainPage() const;
@@ -0,0 +1,75 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "memoryaccountingservice.h"
+
+// STL
+#include <cstdio>
+
+// Qt
+#include <QDBusConnection>
+
+// Local
+#include "gwenview_app_debug.h"
+#include "tracingservice.h"
+#include <lib/memoryaccounting.h>
+
+namespace Gwenview
+{
+static const char *OBJECT_PATH = "/MemoryAccounting";
+
+MemoryAccountingService::MemoryAccountingService(QObject *parent)
+    : QObject(parent)
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    mRegistered = bus.registerObject(QLatin1String(OBJECT_PATH), this, QDBusConnection::ExportScriptableSlots);
+    if (!mRegistered) {
+        qCWarning(GWENVIEW_APP_LOG) << "Could not register the memory accounting object";
+        return;
+    }
+    // Does nothing if TracingService has already registered it
+    bus.registerService(TracingService::serviceName());
+}
+
+MemoryAccountingService::~MemoryAccountingService()
+{
+    if (mRegistered) {
+        QDBusConnection::sessionBus().unregisterObject(QLatin1String(OBJECT_PATH));
+    }
+}
+
+QString MemoryAccountingService::report() const
+{
+    return MemoryAccounting::instance()->report();
+}
+
+void MemoryAccountingService::dump() const
+{
+    fputs(qPrintable(report()), stdout);
+    fflush(stdout);
+}
+
+void MemoryAccountingService::shed()
+{
+    MemoryAccounting::instance()->shed();
+}
+
+} // namespace
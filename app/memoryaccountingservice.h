@@ -0,0 +1,62 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef MEMORYACCOUNTINGSERVICE_H
+#define MEMORYACCOUNTINGSERVICE_H
+
+// Qt
+#include <QObject>
+#include <QString>
+
+namespace Gwenview
+{
+/**
+ * Reports the memory used by the caches over the session bus:
+ *
+ *   qdbus org.kde.gwenview-<pid> /MemoryAccounting report
+ */
+class MemoryAccountingService : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.gwenview.MemoryAccounting")
+public:
+    explicit MemoryAccountingService(QObject *parent);
+    ~MemoryAccountingService() override;
+
+public Q_SLOTS:
+    Q_SCRIPTABLE QString report() const;
+
+    /**
+     * Prints the report on the standard output of the process
+     */
+    Q_SCRIPTABLE void dump() const;
+
+    /**
+     * Asks all caches to shed memory, as if the system was low on memory
+     */
+    Q_SCRIPTABLE void shed();
+
+private:
+    bool mRegistered = false;
+};
+
+} // namespace
+
+#endif /* MEMORYACCOUNTINGSERVICE_H */
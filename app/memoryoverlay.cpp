@@ -0,0 +1,60 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "memoryoverlay.h"
+
+// Qt
+#include <QFontDatabase>
+
+// Local
+#include <lib/memoryaccounting.h>
+
+namespace Gwenview
+{
+static const int REFRESH_INTERVAL = 1000;
+
+MemoryOverlay::MemoryOverlay(QWidget *parent)
+    : QLabel(parent)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setStyleSheet(QStringLiteral("background-color: rgba(0, 0, 0, 160); color: white; padding: 4px;"));
+    move(8, 8);
+
+    mRefreshTimer.setInterval(REFRESH_INTERVAL);
+    connect(&mRefreshTimer, &QTimer::timeout, this, &MemoryOverlay::refresh);
+    mRefreshTimer.start();
+    refresh();
+}
+
+bool MemoryOverlay::isEnabled()
+{
+    return qEnvironmentVariableIsSet("GV_MEMORY_OVERLAY");
+}
+
+void MemoryOverlay::refresh()
+{
+    setText(MemoryAccounting::instance()->report().trimmed());
+    adjustSize();
+    raise();
+}
+
+} // namespace
@@ -0,0 +1,51 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef MEMORYOVERLAY_H
+#define MEMORYOVERLAY_H
+
+// Qt
+#include <QLabel>
+#include <QTimer>
+
+namespace Gwenview
+{
+/**
+ * Shows the memory used by the caches on top of its parent widget, for
+ * debugging. Enabled by setting the GV_MEMORY_OVERLAY environment variable.
+ */
+class MemoryOverlay : public QLabel
+{
+    Q_OBJECT
+public:
+    explicit MemoryOverlay(QWidget *parent);
+
+    static bool isEnabled();
+
+private Q_SLOTS:
+    void refresh();
+
+private:
+    QTimer mRefreshTimer;
+};
+
+} // namespace
+
+#endif /* MEMORYOVERLAY_H */
@@ -22,12 +22,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "preloader.h"
 
 // Qt
+#include <QApplication>
+#include <QFutureWatcher>
 
 // KF
 
 // Local
 #include "gwenview_app_debug.h"
 #include <lib/document/documentfactory.h>
+#include <lib/ioscheduler.h>
 
 namespace Gwenview
 {
@@ -44,6 +47,30 @@ struct PreloaderPrivate {
     Preloader *q = nullptr;
     Document::Ptr mDocument;
     QSize mSize;
+    QUrl mPrefetchUrl;
+    IoCancellationToken mPrefetchToken;
+    QFutureWatcher<bool> mPrefetchWatcher;
+
+    void cancelPrefetch()
+    {
+        // A finished signal of the cancelled prefetch is ignored, since it
+        // finds no url
+        if (mPrefetchWatcher.isRunning()) {
+            mPrefetchToken.cancel();
+        }
+        mPrefetchUrl.clear();
+    }
+
+    void loadDocument(const QUrl &url)
+    {
+        mDocument = DocumentFactory::instance()->load(url);
+        QObject::connect(mDocument.data(), &Document::metaInfoUpdated, q, &Preloader::doPreload);
+
+        if (mDocument->size().isValid()) {
+            LOG("size is already available");
+            q->doPreload();
+        }
+    }
 
     void forgetDocument()
     {
@@ -59,10 +86,12 @@ Preloader::Preloader(QObject *parent)
     , d(new PreloaderPrivate)
 {
     d->q = this;
+    connect(&d->mPrefetchWatcher, &QFutureWatcherBase::finished, this, &Preloader::slotPrefetchFinished);
 }
 
 Preloader::~Preloader()
 {
+    d->cancelPrefetch();
     delete d;
 }
 
@@ -71,16 +100,32 @@ void Preloader::preload(const QUrl &url, const QSize &size)
     LOG("url=" << url);
     if (d->mDocument) {
         disconnect(d->mDocument.data(), nullptr, this, nullptr);
+        d->mDocument = nullptr;
     }
-
-    d->mDocument = DocumentFactory::instance()->load(url);
+    d->cancelPrefetch();
     d->mSize = size;
-    connect(d->mDocument.data(), &Document::metaInfoUpdated, this, &Preloader::doPreload);
 
-    if (d->mDocument->size().isValid()) {
-        LOG("size is already available");
-        doPreload();
+    if (url.isLocalFile() && !DocumentFactory::instance()->hasUrl(url)) {
+        // Read the file at preload priority first, so that it does not slow
+        // down the visible image. The document then loads from the page cache.
+        LOG("prefetching");
+        d->mPrefetchUrl = url;
+        d->mPrefetchToken = IoCancellationToken();
+        d->mPrefetchWatcher.setFuture(IoScheduler::instance()->prefetch(url.toLocalFile(), IoScheduler::Preload, d->mPrefetchToken));
+        return;
     }
+    d->loadDocument(url);
+}
+
+void Preloader::slotPrefetchFinished()
+{
+    const QUrl url = d->mPrefetchUrl;
+    d->mPrefetchUrl.clear();
+    if (url.isEmpty() || !d->mPrefetchWatcher.result()) {
+        LOG("prefetch failed or cancelled");
+        return;
+    }
+    d->loadDocument(url);
 }
 
 void Preloader::doPreload()
@@ -101,14 +146,13 @@ void Preloader::doPreload()
     }
 
     qreal zoom = qMin(d->mSize.width() / qreal(d->mDocument->width()), d->mSize.height() / qreal(d->mDocument->height()));
+    // Views show images in device pixels
+    zoom *= qApp->devicePixelRatio();
 
-    if (zoom < Document::maxDownSampledZoom()) {
-        LOG("preloading down sampled, zoom=" << zoom);
-        d->mDocument->prepareDownSampledImageForZoom(zoom);
-    } else {
-        LOG("preloading full image");
-        d->mDocument->startLoadingFullImage();
-    }
+    // Decode the image at the size the view is going to show it at, the full
+    // image is only needed if the user zooms in
+    LOG("preloading for zoom=" << zoom);
+    d->mDocument->prepareImageForSize(d->mDocument->size() * qMin(zoom, qreal(1)));
     d->forgetDocument();
 }
 
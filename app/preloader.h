@@ -50,8 +50,10 @@ public:
 
 private Q_SLOTS:
     void doPreload();
+    void slotPrefetchFinished();
 
 private:
+    friend struct PreloaderPrivate;
     PreloaderPrivate *const d;
 };
 
@@ -0,0 +1,93 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "singleinstance.h"
+
+// Qt
+#include <QDBusConnection>
+#include <QDBusConnectionInterface>
+#include <QDBusMessage>
+
+// Local
+#include "gwenview_app_debug.h"
+
+namespace Gwenview
+{
+static const char *SERVICE_NAME = "org.kde.gwenview.SingleInstance";
+static const char *OBJECT_PATH = "/SingleInstance";
+
+// The running instance may be busy decoding, but if it does not answer
+// within this delay it is better to start normally
+static const int FORWARD_TIMEOUT = 5000;
+
+bool SingleInstance::forward(const QStringList &urls, bool newWindow, bool fullScreen, bool slideShow)
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected() || !bus.interface()->isServiceRegistered(QLatin1String(SERVICE_NAME))) {
+        return false;
+    }
+
+    QDBusMessage message =
+        QDBusMessage::createMethodCall(QLatin1String(SERVICE_NAME), QLatin1String(OBJECT_PATH), QLatin1String(SERVICE_NAME), QStringLiteral("openUrls"));
+    message << urls << newWindow << fullScreen << slideShow;
+    const QDBusMessage reply = bus.call(message, QDBus::Block, FORWARD_TIMEOUT);
+    if (reply.type() == QDBusMessage::ErrorMessage) {
+        qCWarning(GWENVIEW_APP_LOG) << "Running instance did not handle the request:" << reply.errorMessage();
+        return false;
+    }
+    return true;
+}
+
+SingleInstance::SingleInstance(const OpenFunction &openFunction, QObject *parent)
+    : QObject(parent)
+    , mOpenFunction(openFunction)
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.registerObject(QLatin1String(OBJECT_PATH), this, QDBusConnection::ExportScriptableSlots)) {
+        return;
+    }
+    // Another instance may have been started in the meantime
+    mRegistered = bus.registerService(QLatin1String(SERVICE_NAME));
+    if (!mRegistered) {
+        bus.unregisterObject(QLatin1String(OBJECT_PATH));
+    }
+}
+
+SingleInstance::~SingleInstance()
+{
+    if (mRegistered) {
+        QDBusConnection bus = QDBusConnection::sessionBus();
+        bus.unregisterService(QLatin1String(SERVICE_NAME));
+        bus.unregisterObject(QLatin1String(OBJECT_PATH));
+    }
+}
+
+bool SingleInstance::isRegistered() const
+{
+    return mRegistered;
+}
+
+void SingleInstance::openUrls(const QStringList &urls, bool newWindow, bool fullScreen, bool slideShow)
+{
+    mOpenFunction(urls, newWindow, fullScreen, slideShow);
+}
+
+} // namespace
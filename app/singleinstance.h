@@ -0,0 +1,70 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef SINGLEINSTANCE_H
+#define SINGLEINSTANCE_H
+
+// STL
+#include <functional>
+
+// Qt
+#include <QObject>
+#include <QStringList>
+
+namespace Gwenview
+{
+/**
+ * Lets later invocations of Gwenview hand their urls to the running
+ * instance over the session bus, instead of paying for a full startup. The
+ * running instance keeps its document and thumbnail caches warm.
+ */
+class SingleInstance : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.gwenview.SingleInstance")
+public:
+    using OpenFunction = std::function<void(const QStringList &urls, bool newWindow, bool fullScreen, bool slideShow)>;
+
+    /**
+     * Asks the running instance, if any, to open @p urls. Returns false if
+     * there is no running instance or if it did not answer.
+     */
+    static bool forward(const QStringList &urls, bool newWindow, bool fullScreen, bool slideShow);
+
+    /**
+     * Makes this process the running instance: @p openFunction will be
+     * called for the requests of later invocations
+     */
+    SingleInstance(const OpenFunction &openFunction, QObject *parent);
+    ~SingleInstance() override;
+
+    bool isRegistered() const;
+
+public Q_SLOTS:
+    Q_SCRIPTABLE void openUrls(const QStringList &urls, bool newWindow, bool fullScreen, bool slideShow);
+
+private:
+    OpenFunction mOpenFunction;
+    bool mRegistered = false;
+};
+
+} // namespace
+
+#endif /* SINGLEINSTANCE_H */
@@ -0,0 +1,265 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "slideshowprefetcher.h"
+
+// Qt
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+#include <QWidget>
+
+// KF
+
+// Local
+#include "gwenview_app_debug.h"
+#include <lib/document/documentfactory.h>
+#include <lib/mimetypeutils.h>
+#include <lib/slideshow.h>
+
+namespace Gwenview
+{
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_APP_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+// Used until a load has been measured
+static const qreal INITIAL_LOAD_TIME = 1000;
+
+// Weight of the last measure in the load time estimate
+static const qreal LOAD_TIME_WEIGHT = 0.3;
+
+// An image starts loading this many estimated load times before it is
+// shown, plus SAFETY_MARGIN milliseconds
+static const qreal SAFETY_FACTOR = 3;
+static const int SAFETY_MARGIN = 1000;
+
+// Each prefetched image holds an image decoded at the size of the view in
+// memory
+static const int MAX_PREFETCH_COUNT = 4;
+
+struct PrefetchEntry {
+    QUrl url;
+    Document::Ptr document;
+    // When the slideshow is expected to show the image, on mClock
+    qint64 deadline = 0;
+    bool started = false;
+    // Whether the document has an image to show at the size of the view
+    bool ready = false;
+};
+
+struct SlideShowPrefetcherPrivate {
+    SlideShowPrefetcher *q = nullptr;
+    SlideShow *mSlideShow = nullptr;
+    QWidget *mView = nullptr;
+    QElapsedTimer mClock;
+    QTimer mStartTimer;
+    QVector<PrefetchEntry> mEntries;
+    Document::Ptr mLoadingDocument;
+    qint64 mLoadStartTime = 0;
+    qreal mEstimatedLoadTime = INITIAL_LOAD_TIME;
+    int mLateTransitionCount = 0;
+
+    qint64 leadTime() const
+    {
+        return qint64(mEstimatedLoadTime * SAFETY_FACTOR) + SAFETY_MARGIN;
+    }
+
+    /**
+     * Asks @p document for an image at the size the view is going to show it
+     * at, like the view does. Returns true if it is ready, or if it never
+     * will be because loading failed.
+     */
+    bool prepareImage(const Document::Ptr &document) const
+    {
+        if (document->loadingState() == Document::LoadingFailed) {
+            return true;
+        }
+        if (!document->size().isValid()) {
+            // Wait for metaInfoLoaded(), prepareImageForSize() would load the
+            // full image
+            return false;
+        }
+        const QSize viewSize = mView->size();
+        qreal zoom = qMin(viewSize.width() / qreal(document->width()), viewSize.height() / qreal(document->height()));
+        // Views show images in device pixels
+        zoom *= qApp->devicePixelRatio();
+        return document->prepareImageForSize(document->size() * qMin(zoom, qreal(1)));
+    }
+
+    PrefetchEntry takeEntry(const QUrl &url)
+    {
+        for (int i = 0; i < mEntries.count(); ++i) {
+            if (mEntries.at(i).url == url) {
+                return mEntries.takeAt(i);
+            }
+        }
+        PrefetchEntry entry;
+        entry.url = url;
+        return entry;
+    }
+
+    void checkCurrentEntry()
+    {
+        const QUrl currentUrl = mSlideShow->currentUrl();
+        for (const PrefetchEntry &entry : qAsConst(mEntries)) {
+            if (entry.url != currentUrl || !entry.document) {
+                continue;
+            }
+            if (!entry.ready) {
+                ++mLateTransitionCount;
+                qCDebug(GWENVIEW_APP_LOG) << "Slideshow reached" << currentUrl << "before it was loaded, estimated load time" << mEstimatedLoadTime << "ms";
+            }
+        }
+    }
+};
+
+SlideShowPrefetcher::SlideShowPrefetcher(SlideShow *slideShow, QWidget *view, QObject *parent)
+    : QObject(parent)
+    , d(new SlideShowPrefetcherPrivate)
+{
+    d->q = this;
+    d->mSlideShow = slideShow;
+    d->mView = view;
+    d->mClock.start();
+    d->mStartTimer.setSingleShot(true);
+    connect(&d->mStartTimer, &QTimer::timeout, this, &SlideShowPrefetcher::startNextLoad);
+    connect(slideShow, &SlideShow::scheduleChanged, this, &SlideShowPrefetcher::reschedule);
+}
+
+SlideShowPrefetcher::~SlideShowPrefetcher()
+{
+    delete d;
+}
+
+int SlideShowPrefetcher::lateTransitionCount() const
+{
+    return d->mLateTransitionCount;
+}
+
+void SlideShowPrefetcher::reschedule()
+{
+    if (!d->mSlideShow->isRunning()) {
+        LOG("Slideshow stopped");
+        d->mStartTimer.stop();
+        d->mEntries.clear();
+        return;
+    }
+    d->checkCurrentEntry();
+
+    const qint64 now = d->mClock.elapsed();
+    const int interval = qMax(1, d->mSlideShow->interval()) * 1000;
+    int remainingTime = d->mSlideShow->remainingTime();
+    if (remainingTime < 0) {
+        // Waiting for the end of a video, assume it lasts one interval
+        remainingTime = interval;
+    }
+
+    // Look ahead far enough that each image can start loading one lead time
+    // before it is shown
+    const int count = qBound(1, int(d->leadTime() / interval) + 1, MAX_PREFETCH_COUNT);
+    const QList<QUrl> urls = d->mSlideShow->upcomingUrls(count);
+
+    QVector<PrefetchEntry> entries;
+    for (int i = 0; i < urls.count(); ++i) {
+        PrefetchEntry entry = d->takeEntry(urls.at(i));
+        entry.deadline = now + remainingTime + qint64(i) * interval;
+        entries << entry;
+    }
+    // Entries which are no longer upcoming release their document
+    d->mEntries = entries;
+    LOG("Upcoming" << urls << "lead time" << d->leadTime());
+    startNextLoad();
+}
+
+void SlideShowPrefetcher::startNextLoad()
+{
+    d->mStartTimer.stop();
+    if (d->mLoadingDocument) {
+        // slotDocumentLoaded() comes back here
+        return;
+    }
+    const qint64 now = d->mClock.elapsed();
+    for (PrefetchEntry &entry : d->mEntries) {
+        if (entry.started) {
+            continue;
+        }
+        const qint64 startTime = entry.deadline - d->leadTime();
+        if (startTime > now) {
+            LOG("Next load in" << startTime - now << "ms");
+            d->mStartTimer.start(int(startTime - now));
+            return;
+        }
+        entry.started = true;
+        if (MimeTypeUtils::urlKind(entry.url) == MimeTypeUtils::KIND_VIDEO) {
+            continue;
+        }
+        entry.document = DocumentFactory::instance()->load(entry.url);
+        // The view negotiates the size it shows the image at, decode the
+        // image at this size rather than loading the full image
+        if (d->prepareImage(entry.document)) {
+            entry.ready = true;
+            continue;
+        }
+        LOG("Loading" << entry.url << (entry.deadline - now) << "ms before deadline");
+        d->mLoadingDocument = entry.document;
+        d->mLoadStartTime = now;
+        connect(entry.document.data(), &Document::metaInfoLoaded, this, &SlideShowPrefetcher::slotDocumentLoaded);
+        connect(entry.document.data(), &Document::downSampledImageReady, this, &SlideShowPrefetcher::slotDocumentLoaded);
+        connect(entry.document.data(), &Document::loaded, this, &SlideShowPrefetcher::slotDocumentLoaded);
+        connect(entry.document.data(), &Document::loadingFailed, this, &SlideShowPrefetcher::slotDocumentLoaded);
+        return;
+    }
+}
+
+void SlideShowPrefetcher::slotDocumentLoaded()
+{
+    const Document::Ptr document = d->mLoadingDocument;
+    if (!document) {
+        return;
+    }
+    if (!d->prepareImage(document)) {
+        LOG("Waiting for" << document->url());
+        return;
+    }
+    d->mLoadingDocument = nullptr;
+    disconnect(document.data(), nullptr, this, nullptr);
+    for (PrefetchEntry &entry : d->mEntries) {
+        if (entry.document == document) {
+            entry.ready = true;
+        }
+    }
+    if (document->loadingState() != Document::LoadingFailed) {
+        const qint64 loadTime = d->mClock.elapsed() - d->mLoadStartTime;
+        d->mEstimatedLoadTime = d->mEstimatedLoadTime * (1 - LOAD_TIME_WEIGHT) + loadTime * LOAD_TIME_WEIGHT;
+        LOG("Loaded" << document->url() << "in" << loadTime << "ms, estimate" << d->mEstimatedLoadTime);
+    }
+    startNextLoad();
+}
+
+} // namespace
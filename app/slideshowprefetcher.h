@@ -0,0 +1,68 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef SLIDESHOWPREFETCHER_H
+#define SLIDESHOWPREFETCHER_H
+
+// Qt
+#include <QObject>
+
+class QWidget;
+
+namespace Gwenview
+{
+class SlideShow;
+
+struct SlideShowPrefetcherPrivate;
+/**
+ * Loads the images a running slideshow is about to show, in the order the
+ * slideshow will show them.
+ *
+ * Each image starts loading early enough to be ready before the timer
+ * switches to it: the lead time comes from the measured load times of the
+ * previous images, with a safety margin. Images load one at a time so that
+ * they do not compete with each other for the disk and the CPU. Like the
+ * view, the prefetcher asks for images at the size they fit in the view, so
+ * that only what is going to be shown gets decoded.
+ */
+class SlideShowPrefetcher : public QObject
+{
+    Q_OBJECT
+public:
+    SlideShowPrefetcher(SlideShow *slideShow, QWidget *view, QObject *parent);
+    ~SlideShowPrefetcher() override;
+
+    /**
+     * Number of times the slideshow went to an image which was still loading
+     */
+    int lateTransitionCount() const;
+
+private Q_SLOTS:
+    void reschedule();
+    void startNextLoad();
+    void slotDocumentLoaded();
+
+private:
+    SlideShowPrefetcherPrivate *const d;
+};
+
+} // namespace
+
+#endif /* SLIDESHOWPREFETCHER_H */
@@ -0,0 +1,89 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "tracingservice.h"
+
+// Qt
+#include <QCoreApplication>
+#include <QDBusConnection>
+
+// Local
+#include "gwenview_app_debug.h"
+#include <lib/tracing.h>
+
+namespace Gwenview
+{
+static const char *OBJECT_PATH = "/Tracing";
+
+QString TracingService::serviceName()
+{
+    // The single instance service may be owned by another process, each
+    // process gets its own name
+    return QStringLiteral("org.kde.gwenview-%1").arg(QCoreApplication::applicationPid());
+}
+
+TracingService::TracingService(QObject *parent)
+    : QObject(parent)
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.registerObject(QLatin1String(OBJECT_PATH), this, QDBusConnection::ExportScriptableSlots)) {
+        qCWarning(GWENVIEW_APP_LOG) << "Could not register the tracing object";
+        return;
+    }
+    mRegistered = true;
+    bus.registerService(serviceName());
+}
+
+TracingService::~TracingService()
+{
+    if (mRegistered) {
+        // The service name is shared with MemoryAccountingService, the bus
+        // releases it when the process exits
+        QDBusConnection::sessionBus().unregisterObject(QLatin1String(OBJECT_PATH));
+    }
+}
+
+void TracingService::start()
+{
+    Tracing::setEnabled(true);
+}
+
+void TracingService::stop()
+{
+    Tracing::setEnabled(false);
+}
+
+bool TracingService::isEnabled() const
+{
+    return Tracing::isEnabled();
+}
+
+void TracingService::clear()
+{
+    Tracing::clear();
+}
+
+bool TracingService::save(const QString &path)
+{
+    return Tracing::writeChromeTrace(path);
+}
+
+} // namespace
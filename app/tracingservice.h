@@ -0,0 +1,69 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef TRACINGSERVICE_H
+#define TRACINGSERVICE_H
+
+// Qt
+#include <QObject>
+#include <QString>
+
+namespace Gwenview
+{
+/**
+ * Controls the tracing of the document pipeline over the session bus, so
+ * that a trace can be captured from a running instance:
+ *
+ *   qdbus org.kde.gwenview-<pid> /Tracing start
+ *   qdbus org.kde.gwenview-<pid> /Tracing save /tmp/gwenview.json
+ */
+class TracingService : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.gwenview.Tracing")
+public:
+    explicit TracingService(QObject *parent);
+    ~TracingService() override;
+
+    /**
+     * The name this process registers on the session bus for its debugging
+     * objects, see also MemoryAccountingService
+     */
+    static QString serviceName();
+
+public Q_SLOTS:
+    Q_SCRIPTABLE void start();
+    Q_SCRIPTABLE void stop();
+    Q_SCRIPTABLE bool isEnabled() const;
+    Q_SCRIPTABLE void clear();
+
+    /**
+     * Writes the spans recorded so far to @p path, in the Chrome trace event
+     * format
+     */
+    Q_SCRIPTABLE bool save(const QString &path);
+
+private:
+    bool mRegistered = false;
+};
+
+} // namespace
+
+#endif /* TRACINGSERVICE_H */
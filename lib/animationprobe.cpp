@@ -0,0 +1,292 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "animationprobe.h"
+
+// STL
+#include <cstring>
+
+// Qt
+#include <QtEndian>
+
+// Local
+#include "gwenview_lib_debug.h"
+
+namespace Gwenview
+{
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+namespace AnimationProbe
+{
+/**
+ * Bounds checked reads in a byte array
+ */
+class Reader
+{
+public:
+    explicit Reader(const QByteArray &data)
+        : mData(reinterpret_cast<const uchar *>(data.constData()))
+        , mSize(data.size())
+    {
+    }
+
+    bool has(qint64 pos, qint64 count) const
+    {
+        return pos >= 0 && count >= 0 && pos + count <= mSize;
+    }
+
+    uchar byte(qint64 pos) const
+    {
+        return mData[pos];
+    }
+
+    quint32 le32(qint64 pos) const
+    {
+        return qFromLittleEndian<quint32>(mData + pos);
+    }
+
+    quint32 be32(qint64 pos) const
+    {
+        return qFromBigEndian<quint32>(mData + pos);
+    }
+
+    quint64 be64(qint64 pos) const
+    {
+        return qFromBigEndian<quint64>(mData + pos);
+    }
+
+    bool matches(qint64 pos, const char *tag, int length = 4) const
+    {
+        return has(pos, length) && memcmp(mData + pos, tag, length) == 0;
+    }
+
+    qint64 size() const
+    {
+        return mSize;
+    }
+
+private:
+    const uchar *mData;
+    qint64 mSize;
+};
+
+/**
+ * Skips a chain of GIF data sub-blocks starting at @p pos. Returns the
+ * position after the terminator, or -1 if the data is truncated.
+ */
+static qint64 skipGifSubBlocks(const Reader &reader, qint64 pos)
+{
+    while (reader.has(pos, 1)) {
+        const int length = reader.byte(pos);
+        pos += 1 + length;
+        if (length == 0) {
+            return pos;
+        }
+    }
+    return -1;
+}
+
+static int gifFrameCount(const Reader &reader, int maxCount)
+{
+    // Header and logical screen descriptor
+    if (!reader.has(0, 13)) {
+        return 0;
+    }
+    qint64 pos = 13;
+    const uchar screenFlags = reader.byte(10);
+    if (screenFlags & 0x80) {
+        pos += 3 * (1 << ((screenFlags & 0x07) + 1));
+    }
+
+    int count = 0;
+    while (count < maxCount && reader.has(pos, 1)) {
+        const uchar introducer = reader.byte(pos);
+        if (introducer == 0x21) {
+            // Extension: label, then sub-blocks
+            pos = skipGifSubBlocks(reader, pos + 2);
+        } else if (introducer == 0x2C) {
+            // Image descriptor, optional local color table, LZW code size,
+            // then the image data sub-blocks
+            if (!reader.has(pos, 10)) {
+                break;
+            }
+            const uchar imageFlags = reader.byte(pos + 9);
+            pos += 10;
+            if (imageFlags & 0x80) {
+                pos += 3 * (1 << ((imageFlags & 0x07) + 1));
+            }
+            pos = skipGifSubBlocks(reader, pos + 1);
+            ++count;
+        } else {
+            // Trailer, or garbage
+            break;
+        }
+        if (pos < 0) {
+            break;
+        }
+    }
+    return count;
+}
+
+static int webpFrameCount(const Reader &reader, int maxCount)
+{
+    qint64 pos = 12;
+    int count = 0;
+    bool animated = false;
+    while (count < maxCount && reader.has(pos, 8)) {
+        const quint32 chunkSize = reader.le32(pos + 4);
+        if (reader.matches(pos, "VP8X")) {
+            if (!reader.has(pos + 8, 1)) {
+                break;
+            }
+            animated = reader.byte(pos + 8) & 0x02;
+        } else if (reader.matches(pos, "ANMF")) {
+            ++count;
+        } else if (!animated && (reader.matches(pos, "VP8 ") || reader.matches(pos, "VP8L"))) {
+            return 1;
+        }
+        // Chunks are padded to an even size
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    return count;
+}
+
+static int pngFrameCount(const Reader &reader, int maxCount)
+{
+    qint64 pos = 8;
+    while (reader.has(pos, 8)) {
+        const quint32 length = reader.be32(pos);
+        if (reader.matches(pos + 4, "acTL")) {
+            // The default image may not be part of the animation, but the
+            // frames are what gets displayed
+            if (!reader.has(pos + 8, 4)) {
+                break;
+            }
+            return int(qMin<quint32>(reader.be32(pos + 8), maxCount));
+        }
+        if (reader.matches(pos + 4, "IDAT") || reader.matches(pos + 4, "IEND")) {
+            // acTL must come before the image data
+            break;
+        }
+        // Length, type, data and CRC
+        pos += 12 + qint64(length);
+    }
+    return 1;
+}
+
+/**
+ * Looks for a box of type @p type in [@p pos, @p end) of an ISO base media
+ * file. On success, sets @p contentPos and @p contentEnd to the content of
+ * the box.
+ */
+static bool findBox(const Reader &reader, qint64 pos, qint64 end, const char *type, qint64 *contentPos, qint64 *contentEnd)
+{
+    while (pos + 8 <= end && reader.has(pos, 8)) {
+        qint64 size = reader.be32(pos);
+        qint64 headerSize = 8;
+        if (size == 1) {
+            if (!reader.has(pos + 8, 8)) {
+                return false;
+            }
+            size = qint64(reader.be64(pos + 8));
+            headerSize = 16;
+        } else if (size == 0) {
+            size = end - pos;
+        }
+        if (size < headerSize) {
+            return false;
+        }
+        if (reader.matches(pos + 4, type)) {
+            *contentPos = pos + headerSize;
+            *contentEnd = qMin(pos + size, end);
+            return true;
+        }
+        pos += size;
+    }
+    return false;
+}
+
+static int isoBmffFrameCount(const Reader &reader, int maxCount)
+{
+    qint64 pos = 0;
+    qint64 end = 0;
+    if (!findBox(reader, 0, reader.size(), "ftyp", &pos, &end)) {
+        return -1;
+    }
+    // Major brand, minor version, then compatible brands
+    bool sequence = false;
+    bool image = false;
+    for (qint64 brand = pos; brand + 4 <= end; brand += brand == pos ? 8 : 4) {
+        if (reader.matches(brand, "avis") || reader.matches(brand, "msf1") || reader.matches(brand, "hevs")) {
+            sequence = true;
+        } else if (reader.matches(brand, "avif") || reader.matches(brand, "heic") || reader.matches(brand, "mif1")) {
+            image = true;
+        }
+    }
+    if (!sequence) {
+        return image ? 1 : -1;
+    }
+
+    // moov/trak/mdia/minf/stbl/stsz of the first track, which holds the
+    // color frames
+    pos = 0;
+    end = reader.size();
+    static const char *path[] = {"moov", "trak", "mdia", "minf", "stbl", "stsz"};
+    for (const char *type : path) {
+        if (!findBox(reader, pos, end, type, &pos, &end)) {
+            LOG("No" << type << "box in image sequence");
+            return 1;
+        }
+    }
+    // Version and flags, sample size, sample count
+    if (end - pos < 12 || !reader.has(pos, 12)) {
+        return 1;
+    }
+    return int(qMin<quint32>(reader.be32(pos + 8), maxCount));
+}
+
+int frameCount(const QByteArray &data, int maxCount)
+{
+    const Reader reader(data);
+    if (reader.matches(0, "GIF87a", 6) || reader.matches(0, "GIF89a", 6)) {
+        return gifFrameCount(reader, maxCount);
+    }
+    if (reader.matches(0, "RIFF") && reader.matches(8, "WEBP")) {
+        return webpFrameCount(reader, maxCount);
+    }
+    if (reader.matches(0, "\x89PNG\r\n\x1a\n", 8)) {
+        return pngFrameCount(reader, maxCount);
+    }
+    if (reader.matches(4, "ftyp")) {
+        return isoBmffFrameCount(reader, maxCount);
+    }
+    return -1;
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,50 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef ANIMATIONPROBE_H
+#define ANIMATIONPROBE_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QByteArray>
+
+namespace Gwenview
+{
+/**
+ * Counts the frames of animated image files by reading their container
+ * structure, without decoding any pixel.
+ *
+ * Knows about GIF (block scan), WebP (ANMF chunks), PNG and APNG (acTL chunk)
+ * and AVIF or HEIF sequences (sample count of the first track).
+ */
+namespace AnimationProbe
+{
+/**
+ * Returns the number of frames in @p data, stopping the count at
+ * @p maxCount. Returns -1 if the container is not one of the supported
+ * formats.
+ */
+GWENVIEWLIB_EXPORT int frameCount(const QByteArray &data, int maxCount = 2);
+
+} // namespace
+} // namespace
+
+#endif /* ANIMATIONPROBE_H */
@@ -30,11 +30,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Local
 #include "gwenview_lib_debug.h"
+#include "lrucache.h"
 
 namespace Gwenview
 {
 namespace ArchiveUtils
 {
+// Far more than the number of mime types a session meets
+static const int MIMETYPE_CACHE_SIZE = 512;
+
 bool fileItemIsArchive(const KFileItem &item)
 {
     const QMimeType mimeType = item.determineMimeType();
@@ -52,10 +56,9 @@ bool fileItemIsDirOrArchive(const KFileItem &item)
 
 QString protocolForMimeType(const QString &mimeType)
 {
-    static QHash<QString, QString> cache;
-    QHash<QString, QString>::ConstIterator it = cache.constFind(mimeType);
-    if (it != cache.constEnd()) {
-        return it.value();
+    static LruCache<QString, QString> cache(MIMETYPE_CACHE_SIZE);
+    if (const QString *cached = cache.find(mimeType)) {
+        return *cached;
     }
 
     if (mimeType == QLatin1String("image/svg+xml-compressed")) {
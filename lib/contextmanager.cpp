@@ -29,13 +29,24 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <KProtocolManager>
 
 // Local
+#include "gwenview_lib_debug.h"
 #include <lib/document/documentfactory.h>
 #include <lib/gvdebug.h>
 #include <lib/gwenviewconfig.h>
 #include <lib/semanticinfo/sorteddirmodel.h>
+#include <lib/urllistdirlister.h>
 
 namespace Gwenview
 {
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
 struct ContextManagerPrivate {
     SortedDirModel *mDirModel = nullptr;
     QItemSelectionModel *mSelectionModel = nullptr;
@@ -53,6 +64,17 @@ struct ContextManagerPrivate {
     bool mDirListerFinished = false;
     QTimer *mQueuedSignalsTimer = nullptr;
 
+    UrlListDirLister *urlListDirLister() const
+    {
+        return qobject_cast<UrlListDirLister *>(mDirModel->dirLister());
+    }
+
+    bool isShowingUrlList() const
+    {
+        const UrlListDirLister *lister = urlListDirLister();
+        return lister && lister->isListingUrlList() && mCurrentDirUrl == lister->url().adjusted(QUrl::StripTrailingSlash);
+    }
+
     void queueSignal(Signal signal)
     {
         if (!mQueuedSignals.contains(signal)) {
@@ -129,6 +151,10 @@ ContextManager::ContextManager(SortedDirModel *dirModel, QObject *parent)
     d->mSelectedFileItemListNeedsUpdate = false;
 
     connect(DocumentFactory::instance(), &DocumentFactory::readyForDirListerStart, this, [this](const QUrl &urlReady) {
+        if (d->isShowingUrlList()) {
+            // Items of an url list live in various folders, do not leave the list
+            return;
+        }
         setCurrentDirUrl(urlReady.adjusted(QUrl::RemoveFilename));
     });
 }
@@ -200,6 +226,25 @@ QUrl ContextManager::currentDirUrl() const
     return d->mCurrentDirUrl;
 }
 
+void ContextManager::setUrlList(const QList<QUrl> &urls)
+{
+    UrlListDirLister *lister = d->urlListDirLister();
+    if (!lister) {
+        qCWarning(GWENVIEW_LIB_LOG) << "The dir lister of the model cannot list urls";
+        return;
+    }
+    LOG(urls.count() << "urls to list");
+    lister->openUrlList(urls);
+    d->mCurrentDirUrl = lister->url().adjusted(QUrl::StripTrailingSlash);
+    d->mDirListerFinished = false;
+    Q_EMIT currentDirUrlChanged(d->mCurrentDirUrl);
+}
+
+bool ContextManager::isPopulatingUrlList() const
+{
+    return d->isShowingUrlList() && d->urlListDirLister()->isPopulatingUrlList();
+}
+
 QUrl ContextManager::currentUrl() const
 {
     return d->mCurrentUrl;
@@ -363,6 +408,10 @@ void ContextManager::selectUrlToSelect()
 
 void ContextManager::slotDirListerCompleted()
 {
+    if (isPopulatingUrlList()) {
+        // Only the root folder of the list has been listed
+        return;
+    }
     d->mDirListerFinished = true;
 }
 
@@ -59,6 +59,21 @@ public:
 
     QUrl currentDirUrl() const;
 
+    /**
+     * Browses @p urls as if they were the content of a folder. The urls are
+     * not copied or linked anywhere: the dir lister of the model stats each of
+     * them and adds their items as they come, see
+     * UrlListDirLister. Requires the model to use an UrlListDirLister, which
+     * SortedDirModel does by default.
+     */
+    void setUrlList(const QList<QUrl> &urls);
+
+    /**
+     * Returns true while the urls passed to setUrlList() are being added to
+     * the model
+     */
+    bool isPopulatingUrlList() const;
+
     void setCurrentUrl(const QUrl &currentUrl);
 
     KFileItemList selectedFileItemList() const;
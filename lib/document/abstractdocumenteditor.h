@@ -31,9 +31,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/orientation.h>
 
 class QImage;
+class QRect;
 
 namespace Gwenview
 {
+class TiledImage;
+
 /**
  * An interface which can be returned by some implementations of
  * AbstractDocumentImpl if they support edition.
@@ -52,6 +55,26 @@ public:
      */
     virtual void setImage(const QImage &) = 0;
 
+    /**
+     * Like setImage(), for edits which only changed the pixels inside
+     * @p changedRect. This lets the document update its down sampled images
+     * instead of regenerating them.
+     */
+    virtual void updateImage(const QImage &image, const QRect & /*changedRect*/)
+    {
+        setImage(image);
+    }
+
+    /**
+     * Exchanges the tiles of the current image with @p tiles, see
+     * TiledImage::swap(). Only the area covered by the tiles is touched, so
+     * the cost of an edit is proportional to its area.
+     *
+     * This method should only be called from a subclass of
+     * AbstractImageOperation and applied through Document::undoStack().
+     */
+    virtual void swapImageTiles(TiledImage *tiles) = 0;
+
     /**
      * Apply a transformation to the document image.
      *
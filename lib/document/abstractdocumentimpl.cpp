@@ -61,6 +61,21 @@ void AbstractDocumentImpl::setDocumentImage(const QImage &image)
     d->mDocument->setImageInternal(image);
 }
 
+void AbstractDocumentImpl::updateDocumentImage(const QImage &image, const QRect &changedRect)
+{
+    d->mDocument->updateImageInternal(image, changedRect);
+}
+
+void AbstractDocumentImpl::setDocumentFrame(const QImage &frame)
+{
+    d->mDocument->setFrameInternal(frame);
+}
+
+void AbstractDocumentImpl::swapDocumentImageTiles(TiledImage *tiles)
+{
+    d->mDocument->swapImageTilesInternal(tiles);
+}
+
 void AbstractDocumentImpl::setDocumentImageSize(const QSize &size)
 {
     d->mDocument->setSize(size);
@@ -86,6 +101,11 @@ void AbstractDocumentImpl::setDocumentDownSampledImage(const QImage &image, int
     d->mDocument->setDownSampledImage(image, invertedZoom);
 }
 
+void AbstractDocumentImpl::setDocumentNegotiatedImage(const QImage &image, qreal scale)
+{
+    d->mDocument->setNegotiatedImage(image, scale);
+}
+
 void AbstractDocumentImpl::setDocumentErrorString(const QString &string)
 {
     d->mDocument->setErrorString(string);
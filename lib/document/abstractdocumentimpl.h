@@ -44,6 +44,7 @@ namespace Gwenview
 class Document;
 class DocumentJob;
 class AbstractDocumentEditor;
+class TiledImage;
 
 struct AbstractDocumentImplPrivate;
 class AbstractDocumentImpl : public QObject
@@ -94,6 +95,15 @@ public:
     {
     }
 
+    /**
+     * Called with the scale at which views need the image, once it has been
+     * loaded. Implementations which keep producing images, like animations,
+     * can produce them at this scale rather than at the full size.
+     */
+    virtual void setImageScale(qreal /*scale*/)
+    {
+    }
+
     Document *document() const;
 
     virtual QSvgRenderer *svgRenderer() const
@@ -110,11 +120,15 @@ Q_SIGNALS:
 
 protected:
     void setDocumentImage(const QImage &image);
+    void updateDocumentImage(const QImage &image, const QRect &changedRect);
+    void setDocumentFrame(const QImage &frame);
+    void swapDocumentImageTiles(TiledImage *tiles);
     void setDocumentImageSize(const QSize &size);
     void setDocumentKind(MimeTypeUtils::Kind);
     void setDocumentFormat(const QByteArray &format);
     void setDocumentExiv2Image(std::unique_ptr<Exiv2::Image>);
     void setDocumentDownSampledImage(const QImage &, int invertedZoom);
+    void setDocumentNegotiatedImage(const QImage &, qreal scale);
     void setDocumentCmsProfile(const Cms::Profile::Ptr &profile);
     void setDocumentErrorString(const QString &);
     void switchToImpl(AbstractDocumentImpl *impl);
@@ -22,21 +22,19 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "animateddocumentloadedimpl.h"
 
 // Qt
-#include <QBuffer>
 #include <QImage>
-#include <QMovie>
 
 // KF
 
 // Local
+#include "animationengine.h"
 #include "gwenview_lib_debug.h"
 
 namespace Gwenview
 {
 struct AnimatedDocumentLoadedImplPrivate {
     QByteArray mRawData;
-    QBuffer mMovieBuffer;
-    QMovie mMovie;
+    AnimationEngine *mEngine;
 };
 
 AnimatedDocumentLoadedImpl::AnimatedDocumentLoadedImpl(Document *document, const QByteArray &rawData)
@@ -44,12 +42,9 @@ AnimatedDocumentLoadedImpl::AnimatedDocumentLoadedImpl(Document *document, const
     , d(new AnimatedDocumentLoadedImplPrivate)
 {
     d->mRawData = rawData;
+    d->mEngine = new AnimationEngine(d->mRawData, -1, this);
 
-    connect(&d->mMovie, &QMovie::frameChanged, this, &AnimatedDocumentLoadedImpl::slotFrameChanged);
-
-    d->mMovieBuffer.setBuffer(&d->mRawData);
-    d->mMovieBuffer.open(QIODevice::ReadOnly);
-    d->mMovie.setDevice(&d->mMovieBuffer);
+    connect(d->mEngine, &AnimationEngine::frameChanged, this, &AnimatedDocumentLoadedImpl::slotFrameChanged);
 }
 
 AnimatedDocumentLoadedImpl::~AnimatedDocumentLoadedImpl()
@@ -79,11 +74,17 @@ QByteArray AnimatedDocumentLoadedImpl::rawData() const
     return d->mRawData;
 }
 
-void AnimatedDocumentLoadedImpl::slotFrameChanged(int /*frameNumber*/)
+void AnimatedDocumentLoadedImpl::slotFrameChanged(const QImage &image)
 {
-    QImage image = d->mMovie.currentImage();
-    setDocumentImage(image);
-    Q_EMIT imageRectUpdated(image.rect());
+    setDocumentFrame(image);
+    Q_EMIT imageRectUpdated(QRect(QPoint(0, 0), document()->size()));
+}
+
+void AnimatedDocumentLoadedImpl::setImageScale(qreal scale)
+{
+    // Frames are decoded at the size they are shown at, which saves decoding
+    // and painting time as well as memory when zoomed out
+    d->mEngine->setScaledSize(scale < 1 ? document()->size() * scale : QSize());
 }
 
 bool AnimatedDocumentLoadedImpl::isAnimated() const
@@ -93,18 +94,12 @@ bool AnimatedDocumentLoadedImpl::isAnimated() const
 
 void AnimatedDocumentLoadedImpl::startAnimation()
 {
-    d->mMovie.start();
-    if (d->mMovie.state() == QMovie::NotRunning) {
-        // This is true with qt-copy as of 2008.08.23
-        // qCDebug(GWENVIEW_LIB_LOG) << "QMovie didn't start. This can happen in some cases when starting for the second time.";
-        // qCDebug(GWENVIEW_LIB_LOG) << "Trying to start again, it usually fixes the bug.";
-        d->mMovie.start();
-    }
+    d->mEngine->start();
 }
 
 void AnimatedDocumentLoadedImpl::stopAnimation()
 {
-    d->mMovie.stop();
+    d->mEngine->stop();
 }
 
 } // namespace
@@ -44,9 +44,10 @@ public:
     bool isAnimated() const override;
     void startAnimation() override;
     void stopAnimation() override;
+    void setImageScale(qreal scale) override;
 
 private Q_SLOTS:
-    void slotFrameChanged(int frameNumber);
+    void slotFrameChanged(const QImage &image);
 
 private:
     AnimatedDocumentLoadedImplPrivate *const d;
@@ -0,0 +1,382 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "animationengine.h"
+
+// Qt
+#include <QBuffer>
+#include <QFuture>
+#include <QImageReader>
+#include <QMutex>
+#include <QQueue>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
+#include <QWaitCondition>
+#include <QtConcurrent>
+
+// Local
+#include "gwenview_lib_debug.h"
+#include "imagescaling.h"
+
+namespace Gwenview
+{
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+static const qint64 DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+// Some files ask for a 0 ms delay, do not spin on them
+static const int MIN_FRAME_DELAY = 10;
+
+struct AnimationFrame {
+    QImage image;
+    int delay = 0;
+    // Position of the frame in the animation, 0 starts a new loop
+    int number = 0;
+};
+
+/**
+ * Returns @p image at @p scaledSize, if valid, in a format which can be
+ * painted and color managed without conversion
+ */
+static QImage displayImage(const QImage &image, const QSize &scaledSize)
+{
+    // Frames are scaled after being decoded rather than by the reader:
+    // formats like GIF build each frame on top of the previous one
+    QImage frame = scaledSize.isValid() && scaledSize != image.size() ? ImageScaling::scaled(image, scaledSize, ImageScaling::Box) : image;
+    return frame.convertToFormat(frame.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+}
+
+struct AnimationEnginePrivate {
+    AnimationEngine *q;
+    QByteArray mData;
+    AnimationEngine::Mode mMode;
+    int mFrameCount;
+    int mLoopCount;
+
+    // GUI thread state
+    QTimer mTimer;
+    QImage mCurrentFrame;
+    int mCurrentFrameNumber = -1;
+    int mShownFrameCount = 0;
+    int mPlayedLoops = 0;
+    int mNextCachedFrame = 0;
+    // First frame of the next loop, kept when the animation finishes so
+    // that it can be restarted
+    AnimationFrame mPendingFrame;
+    bool mHasPendingFrame = false;
+    bool mRunning = false;
+    bool mWaitingForFrame = false;
+
+    // The decoder gets its own thread: it runs for as long as the animation
+    // plays and must not hold a slot of the global pool
+    QThreadPool mThreadPool;
+    QFuture<void> mDecoderFuture;
+    bool mDecoderStarted = false;
+
+    // Shared with the decoder, protected by mMutex
+    QMutex mMutex;
+    QWaitCondition mCanDecode;
+    QVector<AnimationFrame> mCachedFrames;
+    QQueue<AnimationFrame> mStreamedFrames;
+    bool mDecodingDone = false;
+    bool mStopDecoding = false;
+    QSize mScaledSize;
+    // In Streaming mode, frames before this one are skipped by the decoder
+    int mFirstStreamedFrame = 0;
+
+    void startDecoder()
+    {
+        if (mDecoderStarted) {
+            return;
+        }
+        mDecoderStarted = true;
+        mThreadPool.setMaxThreadCount(1);
+        mDecoderFuture = QtConcurrent::run(&mThreadPool, [this] {
+            decode();
+        });
+    }
+
+    void stopDecoder()
+    {
+        {
+            QMutexLocker locker(&mMutex);
+            mStopDecoding = true;
+            mCanDecode.wakeAll();
+        }
+        mDecoderFuture.waitForFinished();
+        mDecoderStarted = false;
+    }
+
+    /**
+     * Runs in the decoder thread
+     */
+    void decode()
+    {
+        QBuffer buffer;
+        buffer.setData(mData);
+        buffer.open(QIODevice::ReadOnly);
+        QScopedPointer<QImageReader> reader(new QImageReader(&buffer));
+        int number = 0;
+        QSize scaledSize;
+        int firstFrame;
+        {
+            QMutexLocker locker(&mMutex);
+            scaledSize = mScaledSize;
+            firstFrame = mFirstStreamedFrame;
+        }
+
+        while (true) {
+            {
+                QMutexLocker locker(&mMutex);
+                while (!mStopDecoding && mMode == AnimationEngine::Streaming && mStreamedFrames.count() >= AnimationEngine::StreamingFrameCount) {
+                    mCanDecode.wait(&mMutex);
+                }
+                if (mStopDecoding) {
+                    return;
+                }
+            }
+
+            QImage image;
+            if (!reader->read(&image)) {
+                if (number == 0 || mMode == AnimationEngine::Cached) {
+                    if (number == 0) {
+                        qCWarning(GWENVIEW_LIB_LOG) << "Could not decode animation:" << reader->errorString();
+                    }
+                    QMutexLocker locker(&mMutex);
+                    mDecodingDone = true;
+                    break;
+                }
+                // Start the next loop over
+                buffer.seek(0);
+                reader.reset(new QImageReader(&buffer));
+                number = 0;
+                firstFrame = 0;
+                continue;
+            }
+            if (mMode == AnimationEngine::Streaming && number < firstFrame) {
+                ++number;
+                continue;
+            }
+
+            AnimationFrame frame;
+            frame.image = displayImage(image, scaledSize);
+            frame.delay = reader->nextImageDelay();
+            frame.number = number++;
+            {
+                QMutexLocker locker(&mMutex);
+                if (mMode == AnimationEngine::Cached) {
+                    mCachedFrames.append(frame);
+                } else {
+                    mStreamedFrames.enqueue(frame);
+                }
+            }
+            QMetaObject::invokeMethod(q, "slotFrameDecoded", Qt::QueuedConnection);
+        }
+        LOG("All frames decoded");
+        QMetaObject::invokeMethod(q, "slotFrameDecoded", Qt::QueuedConnection);
+    }
+
+    /**
+     * Returns false if the next frame has not been decoded yet. Sets
+     * @p failed if there will never be one.
+     */
+    bool takeNextFrame(AnimationFrame *frame, bool *failed)
+    {
+        QMutexLocker locker(&mMutex);
+        *failed = false;
+        if (mMode == AnimationEngine::Cached) {
+            if (mNextCachedFrame == mCachedFrames.count() && mDecodingDone) {
+                mNextCachedFrame = 0;
+            }
+            if (mNextCachedFrame < mCachedFrames.count()) {
+                *frame = mCachedFrames.at(mNextCachedFrame++);
+                return true;
+            }
+            *failed = mDecodingDone;
+            return false;
+        }
+
+        if (mStreamedFrames.isEmpty()) {
+            *failed = mDecodingDone;
+            return false;
+        }
+        *frame = mStreamedFrames.dequeue();
+        mCanDecode.wakeAll();
+        return true;
+    }
+};
+
+AnimationEngine::AnimationEngine(const QByteArray &data, qint64 memoryBudget, QObject *parent)
+    : QObject(parent)
+    , d(new AnimationEnginePrivate)
+{
+    d->q = this;
+    d->mData = data;
+    d->mTimer.setSingleShot(true);
+    d->mTimer.setTimerType(Qt::PreciseTimer);
+    connect(&d->mTimer, &QTimer::timeout, this, &AnimationEngine::showNextFrame);
+
+    // Reading the header is enough to decide whether the frames fit in the
+    // budget
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    d->mFrameCount = qMax(0, reader.imageCount());
+    d->mLoopCount = reader.loopCount();
+    const QSize size = reader.size();
+    const qint64 frameBytes = qint64(size.width()) * size.height() * 4;
+    if (memoryBudget < 0) {
+        memoryBudget = defaultMemoryBudget();
+    }
+    d->mMode = d->mFrameCount > 0 && !size.isEmpty() && d->mFrameCount * frameBytes <= memoryBudget ? Cached : Streaming;
+    LOG(d->mFrameCount << "frames of" << size << (d->mMode == Cached ? "cached" : "streamed") << "loop count" << d->mLoopCount);
+}
+
+AnimationEngine::~AnimationEngine()
+{
+    d->stopDecoder();
+    delete d;
+}
+
+qint64 AnimationEngine::defaultMemoryBudget()
+{
+    return DEFAULT_MEMORY_BUDGET;
+}
+
+AnimationEngine::Mode AnimationEngine::mode() const
+{
+    return d->mMode;
+}
+
+int AnimationEngine::frameCount() const
+{
+    return d->mFrameCount;
+}
+
+bool AnimationEngine::isRunning() const
+{
+    return d->mRunning;
+}
+
+void AnimationEngine::start()
+{
+    if (d->mRunning) {
+        return;
+    }
+    d->mRunning = true;
+    d->startDecoder();
+    showNextFrame();
+}
+
+void AnimationEngine::stop()
+{
+    d->mRunning = false;
+    d->mWaitingForFrame = false;
+    d->mTimer.stop();
+}
+
+QImage AnimationEngine::currentFrame() const
+{
+    return d->mCurrentFrame;
+}
+
+void AnimationEngine::setScaledSize(const QSize &size)
+{
+    if (size == d->mScaledSize) {
+        return;
+    }
+    LOG("Scaled size" << size);
+    const bool decoderStarted = d->mDecoderStarted;
+    if (decoderStarted) {
+        d->stopDecoder();
+    }
+    // The decoder is stopped, no need to lock
+    d->mScaledSize = size;
+    d->mCachedFrames.clear();
+    d->mStreamedFrames.clear();
+    d->mDecodingDone = false;
+    d->mStopDecoding = false;
+    // In Cached mode the decoder starts over and playback waits for it to
+    // reach mNextCachedFrame
+    d->mFirstStreamedFrame = d->mCurrentFrameNumber + 1;
+    if (decoderStarted) {
+        d->startDecoder();
+    }
+}
+
+void AnimationEngine::showNextFrame()
+{
+    if (!d->mRunning) {
+        return;
+    }
+    AnimationFrame frame;
+    bool failed;
+    if (d->mHasPendingFrame) {
+        frame = d->mPendingFrame;
+        d->mHasPendingFrame = false;
+    } else if (!d->takeNextFrame(&frame, &failed)) {
+        if (failed) {
+            stop();
+            Q_EMIT finished();
+        } else {
+            // The decoder is late, show the frame as soon as it is ready
+            d->mWaitingForFrame = true;
+        }
+        return;
+    }
+
+    if (frame.number == 0 && d->mShownFrameCount > 0) {
+        ++d->mPlayedLoops;
+        if (d->mLoopCount >= 0 && d->mPlayedLoops > d->mLoopCount) {
+            d->mPendingFrame = frame;
+            d->mHasPendingFrame = true;
+            d->mPlayedLoops = 0;
+            d->mShownFrameCount = 0;
+            stop();
+            Q_EMIT finished();
+            return;
+        }
+    }
+    ++d->mShownFrameCount;
+    d->mCurrentFrame = frame.image;
+    d->mCurrentFrameNumber = frame.number;
+    d->mTimer.start(qMax(frame.delay, MIN_FRAME_DELAY));
+    Q_EMIT frameChanged(d->mCurrentFrame);
+}
+
+void AnimationEngine::slotFrameDecoded()
+{
+    if (d->mWaitingForFrame) {
+        d->mWaitingForFrame = false;
+        showNextFrame();
+    }
+}
+
+} // namespace
@@ -0,0 +1,114 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef ANIMATIONENGINE_H
+#define ANIMATIONENGINE_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QImage>
+#include <QObject>
+
+namespace Gwenview
+{
+struct AnimationEnginePrivate;
+/**
+ * Plays an animated image, replacing QMovie.
+ *
+ * Frames are decoded ahead of time in a worker thread and converted to a
+ * format which can be painted without conversion. If all the frames fit in
+ * memoryBudget() they are decoded once and kept (Cached mode), otherwise the
+ * worker decodes at most a few frames ahead of the playback, looping over
+ * the file again and again (Streaming mode).
+ *
+ * Frame timing comes from QImageReader::nextImageDelay() and the loop count
+ * of the file is honored, like QMovie does.
+ *
+ * Frames can be decoded below the size of the image, see setScaledSize().
+ */
+class GWENVIEWLIB_EXPORT AnimationEngine : public QObject
+{
+    Q_OBJECT
+public:
+    enum Mode {
+        Cached,
+        Streaming,
+    };
+
+    /**
+     * Maximum number of frames decoded ahead in Streaming mode
+     */
+    enum { StreamingFrameCount = 4 };
+
+    /**
+     * @p memoryBudget is the maximum number of bytes used to keep all the
+     * decoded frames. Pass -1 to use defaultMemoryBudget().
+     */
+    explicit AnimationEngine(const QByteArray &data, qint64 memoryBudget = -1, QObject *parent = nullptr);
+    ~AnimationEngine() override;
+
+    static qint64 defaultMemoryBudget();
+
+    Mode mode() const;
+
+    /**
+     * Returns the number of frames, or 0 if the file does not tell
+     */
+    int frameCount() const;
+
+    bool isRunning() const;
+
+    void start();
+
+    void stop();
+
+    /**
+     * Makes the next frames @p size large, or as large as the image if
+     * @p size is empty. The frames decoded ahead are decoded again, playback
+     * goes on from the current frame.
+     */
+    void setScaledSize(const QSize &size);
+
+    /**
+     * The frame shown last, null until the animation has been started
+     */
+    QImage currentFrame() const;
+
+Q_SIGNALS:
+    void frameChanged(const QImage &frame);
+
+    /**
+     * Emitted when the animation reached its loop count
+     */
+    void finished();
+
+private Q_SLOTS:
+    void showNextFrame();
+    void slotFrameDecoded();
+
+private:
+    friend struct AnimationEnginePrivate;
+    AnimationEnginePrivate *const d;
+};
+
+} // namespace
+
+#endif /* ANIMATIONENGINE_H */
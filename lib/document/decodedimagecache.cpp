@@ -0,0 +1,347 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "decodedimagecache.h"
+
+// STL
+#include <cstring>
+#include <memory>
+
+// Qt
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+// Local
+#include "gwenview_lib_debug.h"
+#include "gwenviewconfig.h"
+
+namespace Gwenview
+{
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+static const quint32 FORMAT_VERSION = 1;
+
+// Pixels start at this offset, which keeps rows aligned in the mapped file
+static const int HEADER_SIZE = 64;
+
+// When the cache is full, remove entries until it is this full
+static const qreal TRIM_RATIO = 0.75;
+
+struct EntryHeader {
+    char magic[4];
+    quint32 version;
+    // QImage::Format of the pixels, Format_Invalid for a profile entry
+    qint32 format;
+    qint32 width;
+    qint32 height;
+    qint32 bytesPerLine;
+    qint64 dataSize;
+
+    bool isValid(qint64 fileSize) const
+    {
+        return memcmp(magic, "GVDI", 4) == 0 && version == FORMAT_VERSION && dataSize >= 0 && HEADER_SIZE + dataSize == fileSize;
+    }
+
+    /**
+     * Checks that the pixels described by the header fit in the file, so that
+     * a corrupted entry cannot make QImage read past the mapping
+     */
+    bool isValidImage(qint64 fileSize) const
+    {
+        if (!isValid(fileSize) || format <= QImage::Format_Invalid || format >= QImage::NImageFormats || width <= 0 || height <= 0) {
+            return false;
+        }
+        const int depth = QImage::toPixelFormat(QImage::Format(format)).bitsPerPixel();
+        const qint64 minBytesPerLine = (qint64(width) * depth + 7) / 8;
+        return depth > 0 && bytesPerLine >= minBytesPerLine && qint64(bytesPerLine) * height <= fileSize - HEADER_SIZE;
+    }
+};
+static_assert(sizeof(EntryHeader) <= HEADER_SIZE, "Entry header does not fit");
+
+struct DecodedImageCachePrivate {
+    QString mDirectory;
+    qint64 mCapacity;
+
+    QMutex mMutex;
+    // -1 until the directory has been scanned
+    qint64 mSize = -1;
+
+    QString pathForKey(const QByteArray &key) const
+    {
+        return mDirectory + QLatin1Char('/') + QString::fromLatin1(key);
+    }
+
+    /**
+     * Must be called with mMutex locked
+     */
+    void scan()
+    {
+        mSize = 0;
+        const QFileInfoList list = QDir(mDirectory).entryInfoList(QDir::Files);
+        for (const QFileInfo &info : list) {
+            mSize += info.size();
+        }
+    }
+
+    /**
+     * Removes the least recently used entries. Must be called with mMutex
+     * locked.
+     */
+    void trim()
+    {
+        // Entries are touched when used, so the oldest files come first.
+        // Other instances may have added files: start from what is on disk.
+        QFileInfoList list = QDir(mDirectory).entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+        mSize = 0;
+        for (const QFileInfo &info : qAsConst(list)) {
+            mSize += info.size();
+        }
+        const qint64 target = qint64(mCapacity * TRIM_RATIO);
+        for (const QFileInfo &info : qAsConst(list)) {
+            if (mSize <= target) {
+                break;
+            }
+            if (QFile::remove(info.filePath())) {
+                mSize -= info.size();
+            }
+        }
+        LOG("Trimmed to" << mSize << "bytes");
+    }
+
+    void added(qint64 bytes)
+    {
+        QMutexLocker locker(&mMutex);
+        if (mSize < 0) {
+            scan();
+        } else {
+            mSize += bytes;
+        }
+        if (mSize > mCapacity) {
+            trim();
+        }
+    }
+
+    bool write(const QByteArray &key, const EntryHeader &header, const char *data)
+    {
+        if (!QDir().mkpath(mDirectory)) {
+            return false;
+        }
+        QSaveFile file(pathForKey(key));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCWarning(GWENVIEW_LIB_LOG) << "Could not create decoded image cache entry" << file.fileName();
+            return false;
+        }
+        char headerBuffer[HEADER_SIZE] = {};
+        memcpy(headerBuffer, &header, sizeof(header));
+        if (file.write(headerBuffer, HEADER_SIZE) != HEADER_SIZE || file.write(data, header.dataSize) != header.dataSize || !file.commit()) {
+            qCWarning(GWENVIEW_LIB_LOG) << "Could not write decoded image cache entry" << file.fileName();
+            return false;
+        }
+        added(HEADER_SIZE + header.dataSize);
+        return true;
+    }
+
+    static EntryHeader makeHeader()
+    {
+        EntryHeader header;
+        memcpy(header.magic, "GVDI", 4);
+        header.version = FORMAT_VERSION;
+        header.format = QImage::Format_Invalid;
+        header.width = 0;
+        header.height = 0;
+        header.bytesPerLine = 0;
+        header.dataSize = 0;
+        return header;
+    }
+
+    static void touch(QFile *file)
+    {
+        // The modification time orders entries for trim()
+        file->setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+    }
+};
+
+DecodedImageCache::DecodedImageCache(const QString &directory, qint64 capacity)
+    : d(new DecodedImageCachePrivate)
+{
+    d->mDirectory = directory;
+    d->mCapacity = capacity;
+}
+
+DecodedImageCache::~DecodedImageCache()
+{
+    delete d;
+}
+
+DecodedImageCache *DecodedImageCache::instance()
+{
+    if (!GwenviewConfig::decodedImageCacheEnabled()) {
+        return nullptr;
+    }
+    static DecodedImageCache cache(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QStringLiteral("/decoded"),
+                                   qint64(GwenviewConfig::decodedImageCacheSize()) * 1024 * 1024);
+    return &cache;
+}
+
+QByteArray DecodedImageCache::key(const QString &path, const QByteArray &variant)
+{
+    const QFileInfo info(path);
+    if (!info.exists()) {
+        return {};
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QFile::encodeName(info.absoluteFilePath()));
+    hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+    hash.addData(QByteArray::number(info.size()));
+    hash.addData(variant);
+    return hash.result().toHex();
+}
+
+QString DecodedImageCache::directory() const
+{
+    return d->mDirectory;
+}
+
+qint64 DecodedImageCache::capacity() const
+{
+    return d->mCapacity;
+}
+
+QImage DecodedImageCache::find(const QByteArray &key)
+{
+    auto file = std::make_unique<QFile>(d->pathForKey(key));
+    if (!file->open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    const qint64 fileSize = file->size();
+    if (fileSize < HEADER_SIZE) {
+        return {};
+    }
+    const uchar *data = file->map(0, fileSize);
+    if (!data) {
+        return {};
+    }
+    EntryHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (!header.isValidImage(fileSize)) {
+        qCWarning(GWENVIEW_LIB_LOG) << "Invalid decoded image cache entry" << file->fileName();
+        return {};
+    }
+    DecodedImageCachePrivate::touch(file.get());
+    LOG("Found" << key << QSize(header.width, header.height));
+
+    // The image owns the file, which unmaps the pixels when deleted
+    QFile *owner = file.release();
+    return QImage(
+        data + HEADER_SIZE,
+        header.width,
+        header.height,
+        header.bytesPerLine,
+        QImage::Format(header.format),
+        [](void *info) {
+            delete static_cast<QFile *>(info);
+        },
+        owner);
+}
+
+void DecodedImageCache::insert(const QByteArray &key, const QImage &source)
+{
+    if (key.isEmpty() || source.isNull()) {
+        return;
+    }
+    QImage image = source;
+    if (image.colorCount() > 0) {
+        // The color table is not stored
+        image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    }
+    EntryHeader header = DecodedImageCachePrivate::makeHeader();
+    header.format = image.format();
+    header.width = image.width();
+    header.height = image.height();
+    header.bytesPerLine = image.bytesPerLine();
+    header.dataSize = image.sizeInBytes();
+    if (HEADER_SIZE + header.dataSize > d->mCapacity / 8) {
+        LOG("Not storing" << image.size() << ": too large");
+        return;
+    }
+    d->write(key, header, reinterpret_cast<const char *>(image.constBits()));
+}
+
+bool DecodedImageCache::findProfile(const QByteArray &key, QByteArray *iccProfile)
+{
+    QFile file(d->pathForKey(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray content = file.readAll();
+    EntryHeader header;
+    if (content.size() < HEADER_SIZE) {
+        return false;
+    }
+    memcpy(&header, content.constData(), sizeof(header));
+    if (!header.isValid(content.size()) || header.format != QImage::Format_Invalid) {
+        return false;
+    }
+    DecodedImageCachePrivate::touch(&file);
+    *iccProfile = content.mid(HEADER_SIZE);
+    return true;
+}
+
+void DecodedImageCache::insertProfile(const QByteArray &key, const QByteArray &iccProfile)
+{
+    if (key.isEmpty()) {
+        return;
+    }
+    EntryHeader header = DecodedImageCachePrivate::makeHeader();
+    header.dataSize = iccProfile.size();
+    d->write(key, header, iccProfile.constData());
+}
+
+qint64 DecodedImageCache::size() const
+{
+    QMutexLocker locker(&d->mMutex);
+    if (d->mSize < 0) {
+        d->scan();
+    }
+    return d->mSize;
+}
+
+void DecodedImageCache::clear()
+{
+    QMutexLocker locker(&d->mMutex);
+    QDir(d->mDirectory).removeRecursively();
+    d->mSize = 0;
+}
+
+} // namespace
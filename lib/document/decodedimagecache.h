@@ -0,0 +1,100 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef DECODEDIMAGECACHE_H
+#define DECODEDIMAGECACHE_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+
+namespace Gwenview
+{
+struct DecodedImageCachePrivate;
+/**
+ * An on-disk store of decoded images, so that images which are viewed again
+ * in a later session do not have to be decoded again.
+ *
+ * Entries are raw pixel buffers which find() maps in memory: a hit costs an
+ * mmap() instead of a decode. The store is capped in size and the least
+ * recently used entries are removed first. All methods are thread safe.
+ */
+class GWENVIEWLIB_EXPORT DecodedImageCache
+{
+public:
+    DecodedImageCache(const QString &directory, qint64 capacity);
+    ~DecodedImageCache();
+
+    /**
+     * The cache used by document loading, or nullptr if it is disabled in the
+     * configuration
+     */
+    static DecodedImageCache *instance();
+
+    /**
+     * Returns the key of the entry for the file at @p path decoded with
+     * @p variant, which describes the target size and the decoding options.
+     * The key changes when the file is modified. Returns an empty key if the
+     * file does not exist.
+     */
+    static QByteArray key(const QString &path, const QByteArray &variant);
+
+    QString directory() const;
+
+    qint64 capacity() const;
+
+    /**
+     * Returns the image stored for @p key, or a null image. The returned
+     * image is read-only and backed by the mapped file.
+     */
+    QImage find(const QByteArray &key);
+
+    /**
+     * Stores @p image for @p key. Images larger than an eighth of the
+     * capacity are not stored.
+     */
+    void insert(const QByteArray &key, const QImage &image);
+
+    /**
+     * Some decoders only report the color profile after decoding the whole
+     * image. These store the profile, or its absence as an empty array, so
+     * that the decode can be skipped next time.
+     */
+    bool findProfile(const QByteArray &key, QByteArray *iccProfile);
+    void insertProfile(const QByteArray &key, const QByteArray &iccProfile);
+
+    /**
+     * Size of the stored entries, in bytes
+     */
+    qint64 size() const;
+
+    void clear();
+
+private:
+    Q_DISABLE_COPY(DecodedImageCache)
+    DecodedImageCachePrivate *const d;
+};
+
+} // namespace
+
+#endif /* DECODEDIMAGECACHE_H */
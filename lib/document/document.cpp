@@ -20,6 +20,10 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "document.h"
 #include "document_p.h"
 
+// STL
+#include <cmath>
+#include <cstring>
+
 // Qt
 #include <QApplication>
 #include <QImage>
@@ -39,9 +43,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "gvdebug.h"
 #include "gwenview_lib_debug.h"
 #include "imagemetainfomodel.h"
+#include "imagescaling.h"
 #include "loadingdocumentimpl.h"
 #include "loadingjob.h"
 #include "savejob.h"
+#include "tiledimage.h"
+#include "tracing.h"
 
 namespace Gwenview
 {
@@ -95,6 +102,13 @@ void DocumentPrivate::scheduleImageLoading(int invertedZoom)
     impl->loadImage(invertedZoom);
 }
 
+void DocumentPrivate::scheduleImageLoadingForScale(qreal scale)
+{
+    auto impl = qobject_cast<LoadingDocumentImpl *>(mImpl);
+    Q_ASSERT(impl);
+    impl->loadImageForScale(scale);
+}
+
 void DocumentPrivate::scheduleImageDownSampling(int invertedZoom)
 {
     LOG("invertedZoom=" << invertedZoom);
@@ -121,25 +135,130 @@ void DocumentPrivate::scheduleImageDownSampling(int invertedZoom)
             delete job;
         }
     }
-    q->enqueueJob(new DownSamplingJob(invertedZoom));
+    QImage levelImage = mImage;
+    auto level = mDownSampledImageMap.lowerBound(invertedZoom);
+    if (level != mDownSampledImageMap.begin()) {
+        --level;
+        levelImage = level.value();
+        LOG("Down sampling from level" << level.key());
+    }
+    auto newJob = new DownSamplingJob(invertedZoom, mImage, levelImage);
+    QObject::connect(newJob, &KJob::result, q, [this, newJob]() {
+        storeDownSampledImage(newJob->mSourceImage, newJob->mDownSampledImage, newJob->mInvertedZoom);
+    });
+    q->enqueueJob(newJob);
 }
 
-void DocumentPrivate::downSampleImage(int invertedZoom)
+void DocumentPrivate::storeDownSampledImage(const QImage &sourceImage, const QImage &downSampledImage, int invertedZoom)
 {
-    mDownSampledImageMap[invertedZoom] = mImage.scaled(mImage.size() / invertedZoom, Qt::KeepAspectRatio, Qt::FastTransformation);
-    if (mDownSampledImageMap[invertedZoom].size().isEmpty()) {
-        mDownSampledImageMap[invertedZoom] = mImage;
+    if (sourceImage.cacheKey() != mImage.cacheKey()) {
+        // The document has been reloaded or edited since the job was created
+        LOG("Dropping outdated down sampled image");
+        return;
     }
+    mDownSampledImageMap[invertedZoom] = downSampledImage;
     Q_EMIT q->downSampledImageReady();
 }
 
+void DocumentPrivate::updateDownSampledImages(const QRect &changedRect)
+{
+    for (auto it = mDownSampledImageMap.begin(); it != mDownSampledImageMap.end(); ++it) {
+        QImage &level = it.value();
+        if (level.size() == mImage.size()) {
+            // Image too small to be down sampled, the level is the image itself
+            level = mImage;
+            continue;
+        }
+        const qreal xRatio = qreal(mImage.width()) / level.width();
+        const qreal yRatio = qreal(mImage.height()) / level.height();
+
+        // Grow the area by one pixel of the level: pixels on its border
+        // average changed and unchanged pixels
+        const QRect levelRect = QRect(QPoint(int(changedRect.left() / xRatio) - 1, int(changedRect.top() / yRatio) - 1),
+                                      QPoint(int((changedRect.right() + 1) / xRatio) + 1, int((changedRect.bottom() + 1) / yRatio) + 1))
+                                    .intersected(level.rect());
+        if (levelRect.isEmpty()) {
+            continue;
+        }
+        const QRect sourceRect = QRect(QPoint(int(levelRect.left() * xRatio), int(levelRect.top() * yRatio)),
+                                       QPoint(int(std::ceil((levelRect.right() + 1) * xRatio)) - 1, int(std::ceil((levelRect.bottom() + 1) * yRatio)) - 1))
+                                     .intersected(mImage.rect());
+
+        QImage patch = ImageScaling::scaled(mImage.copy(sourceRect), levelRect.size(), ImageScaling::Box);
+        if (patch.format() != level.format()) {
+            patch.convertTo(level.format());
+        }
+        const int bytesPerPixel = level.depth() / 8;
+        for (int y = 0; y < patch.height(); ++y) {
+            memcpy(level.scanLine(levelRect.top() + y) + levelRect.left() * bytesPerPixel, patch.constScanLine(y), patch.width() * bytesPerPixel);
+        }
+    }
+}
+
+static bool isLargeEnough(const QImage &image, const QSize &size)
+{
+    // Allow for the rounding of the decoded size
+    return image.width() + 1 >= size.width() && image.height() + 1 >= size.height();
+}
+
+const QImage *DocumentPrivate::imageForSize(const QSize &size) const
+{
+    if (!mImage.isNull()) {
+        return &mImage;
+    }
+    const QImage *best = mNegotiatedImage.isNull() ? nullptr : &mNegotiatedImage;
+    for (const QImage &image : mDownSampledImageMap) {
+        if (!best) {
+            best = &image;
+        } else if (isLargeEnough(image, size)) {
+            if (!isLargeEnough(*best, size) || image.width() < best->width()) {
+                best = &image;
+            }
+        } else if (!isLargeEnough(*best, size) && image.width() > best->width()) {
+            best = &image;
+        }
+    }
+    return best;
+}
+
+/**
+ * Returns the scale at which to decode an image which is needed at @a scale.
+ * Scales go by half octaves, 1, 3/4, 1/2, 3/8, 1/4...: zooming does not
+ * require a new decode at every step, and the decoded image is at most half
+ * as large again as needed.
+ */
+static qreal decodeScaleForScale(qreal scale)
+{
+    qreal level = 1;
+    while (scale <= level / 2 && level > 1. / 64) {
+        level /= 2;
+    }
+    return scale <= level * 3 / 4 ? level * 3 / 4 : level;
+}
+
+void DocumentPrivate::renegotiateImageSize()
+{
+    if (mNegotiatedSize.isValid()) {
+        q->prepareImageForSize(mNegotiatedSize);
+    }
+}
+
 //- DownSamplingJob ---------------------------------------
-void DownSamplingJob::doStart()
+void DownSamplingJob::threadedStart()
 {
-    DocumentPrivate *d = document()->d;
-    d->downSampleImage(mInvertedZoom);
+    GV_TRACE_SPAN("downsample", "document");
+    const QSize size = mSourceImage.size() / mInvertedZoom;
+    if (size.isEmpty()) {
+        mDownSampledImage = mSourceImage;
+        setError(NoError);
+        return;
+    }
+
+    mDownSampledImage = ImageScaling::scaled(mLevelImage, size, Qt::KeepAspectRatio, ImageScaling::Box);
+    if (mDownSampledImage.isNull()) {
+        mDownSampledImage = mSourceImage;
+    }
     setError(NoError);
-    emitResult();
 }
 
 //- Document ----------------------------------------------
@@ -173,6 +292,12 @@ void Document::reload()
     d->mSize = QSize();
     d->mImage = QImage();
     d->mDownSampledImageMap.clear();
+    d->mNegotiatedImage = QImage();
+    d->mNegotiatedScale = 0;
+    d->mNegotiatedSize = QSize();
+    d->mFullImageRequested = false;
+    // The meta info model reads the Exiv2 image lazily, let it go first
+    d->mImageMetaInfoModel.setExiv2Image(nullptr);
     d->mExiv2Image.reset();
     d->mKind = MimeTypeUtils::KIND_UNKNOWN;
     d->mFormat = QByteArray();
@@ -226,6 +351,13 @@ const QImage &Document::downSampledImageForZoom(qreal zoom) const
     return d->mDownSampledImageMap[invertedZoom];
 }
 
+const QImage &Document::imageForSize(const QSize &size) const
+{
+    static const QImage sNullImage;
+    const QImage *image = d->imageForSize(size);
+    return image ? *image : sNullImage;
+}
+
 Document::LoadingState Document::loadingState() const
 {
     return d->mImpl->loadingState();
@@ -252,12 +384,47 @@ void Document::setImageInternal(const QImage &image)
 {
     d->mImage = image;
     d->mDownSampledImageMap.clear();
+    d->mNegotiatedImage = QImage();
+    d->mNegotiatedScale = 0;
 
     // If we didn't get the image size before decoding the full image, set it
     // now
     setSize(d->mImage.size());
 }
 
+void Document::updateImageInternal(const QImage &image, const QRect &changedRect)
+{
+    if (image.size() != d->mImage.size()) {
+        setImageInternal(image);
+        return;
+    }
+    d->mImage = image;
+    d->updateDownSampledImages(changedRect.intersected(image.rect()));
+}
+
+void Document::setFrameInternal(const QImage &frame)
+{
+    // Only the base image changes: frames may be decoded below the size of
+    // the document, which stays the same, and the down sampled images are
+    // dropped rather than updated for every frame
+    d->mImage = frame;
+    d->mDownSampledImageMap.clear();
+    d->mNegotiatedImage = QImage();
+    d->mNegotiatedScale = 0;
+}
+
+void Document::swapImageTilesInternal(TiledImage *tiles)
+{
+    if (tiles->imageSize() != d->mImage.size()) {
+        qCWarning(GWENVIEW_LIB_LOG) << "Tiles do not match the document image";
+        return;
+    }
+    // Modifies the image in place: unless someone else holds a reference to
+    // it, only the area covered by the tiles is written
+    tiles->swap(&d->mImage);
+    d->updateDownSampledImages(tiles->boundingRect());
+}
+
 QUrl Document::url() const
 {
     return d->mUrl;
@@ -355,10 +522,14 @@ bool Document::hasAlphaChannel() const
     }
 }
 
-int Document::memoryUsage() const
+qint64 Document::memoryUsage() const
 {
     // FIXME: Take undo stack into account
-    int usage = d->mImage.sizeInBytes();
+    qint64 usage = d->mImage.sizeInBytes();
+    for (const QImage &image : qAsConst(d->mDownSampledImageMap)) {
+        usage += image.sizeInBytes();
+    }
+    usage += d->mNegotiatedImage.sizeInBytes();
     usage += rawData().length();
     return usage;
 }
@@ -385,8 +556,10 @@ AbstractDocumentEditor *Document::editor()
 
 void Document::setExiv2Image(std::unique_ptr<Exiv2::Image> image)
 {
+    // The meta info model must stop reading the previous image before it is
+    // deleted
+    d->mImageMetaInfoModel.setExiv2Image(image.get());
     d->mExiv2Image = std::move(image);
-    d->mImageMetaInfoModel.setExiv2Image(d->mExiv2Image.get());
     Q_EMIT metaInfoUpdated();
 }
 
@@ -394,6 +567,22 @@ void Document::setDownSampledImage(const QImage &image, int invertedZoom)
 {
     Q_ASSERT(!d->mDownSampledImageMap.contains(invertedZoom));
     d->mDownSampledImageMap[invertedZoom] = image;
+    d->renegotiateImageSize();
+    Q_EMIT downSampledImageReady();
+}
+
+void Document::setNegotiatedImage(const QImage &image, qreal scale)
+{
+    if (scale < d->mNegotiatedScale) {
+        // Asked for before zooming in, keep the larger image: it is still
+        // good when zooming out again
+        LOG("Keeping the image decoded at scale" << d->mNegotiatedScale);
+        d->renegotiateImageSize();
+        return;
+    }
+    d->mNegotiatedImage = image;
+    d->mNegotiatedScale = scale;
+    d->renegotiateImageSize();
     Q_EMIT downSampledImageReady();
 }
 
@@ -416,6 +605,10 @@ void Document::startLoadingFullImage()
 {
     LoadingState state = loadingState();
     if (state <= MetaInfoLoaded) {
+        if (d->mFullImageRequested) {
+            return;
+        }
+        d->mFullImageRequested = true;
         // Schedule full image loading
         auto job = new LoadingJob;
         job->uiDelegate()->setAutoWarningHandlingEnabled(false);
@@ -457,6 +650,49 @@ bool Document::prepareDownSampledImageForZoom(qreal zoom)
     return false;
 }
 
+bool Document::prepareImageForSize(const QSize &size)
+{
+    d->mNegotiatedSize = size;
+    if (!d->mImage.isNull()) {
+        if (d->mSize.isValid()) {
+            d->mImpl->setImageScale(decodeScaleForScale(qMax(qreal(size.width()) / d->mSize.width(), qreal(size.height()) / d->mSize.height())));
+        }
+        return true;
+    }
+    const QImage *image = d->imageForSize(size);
+    if (image && isLargeEnough(*image, size)) {
+        LOG("imageForSize=" << size << "ready");
+        return true;
+    }
+
+    const LoadingState state = loadingState();
+    if (state == LoadingFailed) {
+        qCWarning(GWENVIEW_LIB_LOG) << "Image has failed to load, not doing anything";
+        return false;
+    } else if (state == Loaded) {
+        // Not a raster image
+        return true;
+    }
+
+    if (!d->mSize.isValid()) {
+        // We cannot tell how much to decode without the image size
+        startLoadingFullImage();
+        return false;
+    }
+    const qreal scale = decodeScaleForScale(qMax(qreal(size.width()) / d->mSize.width(), qreal(size.height()) / d->mSize.height()));
+    LOG("imageForSize=" << size << "decoding at scale" << scale);
+    if (scale >= 1) {
+        // Zoomed past what has been decoded
+        startLoadingFullImage();
+    } else if (scale <= d->mNegotiatedScale) {
+        // The decoder could not do better
+        return true;
+    } else {
+        d->scheduleImageLoadingForScale(scale);
+    }
+    return false;
+}
+
 void Document::emitMetaInfoLoaded()
 {
     Q_EMIT metaInfoLoaded(d->mUrl);
@@ -53,6 +53,7 @@ class AbstractDocumentEditor;
 class AbstractDocumentImpl;
 class DocumentJob;
 class DocumentFactory;
+class TiledImage;
 struct DocumentPrivate;
 class ImageMetaInfoModel;
 
@@ -67,6 +68,10 @@ class ImageMetaInfoModel;
  * images load much faster than the full image but you need to load the full
  * image to manipulate it (use startLoadingFullImage() to do so).
  *
+ * Views negotiate the resolution they need with prepareImageForSize() and
+ * imageForSize(): the image is decoded at the size they show it at, and the
+ * full image is only loaded once they zoom past it.
+ *
  * To get a Document instance for url, ask for one with
  * DocumentFactory::instance()->load(url);
  */
@@ -112,6 +117,18 @@ public:
      */
     bool prepareDownSampledImageForZoom(qreal zoom);
 
+    /**
+     * Negotiates the resolution of the image with a view which needs @a size
+     * pixels to show the whole image. Until the full image has been loaded,
+     * the image is decoded at the smallest of a few scales which gives at
+     * least @a size pixels, or fully when @a size is close to size().
+     *
+     * @return true if imageForSize() returns a large enough image, false if
+     * not. In this case the downSampledImageReady() signal, or loaded() if the
+     * full image is needed, will be emitted.
+     */
+    bool prepareImageForSize(const QSize &size);
+
     LoadingState loadingState() const;
 
     MimeTypeUtils::Kind kind() const;
@@ -122,6 +139,15 @@ public:
 
     const QImage &downSampledImageForZoom(qreal zoom) const;
 
+    /**
+     * Returns the smallest decoded image which has at least @a size pixels,
+     * which is image() once the full image has been loaded. If none is large
+     * enough, returns the largest one, which can be shown until the one asked
+     * for with prepareImageForSize() is ready. Returns a null image if nothing
+     * has been decoded yet.
+     */
+    const QImage &imageForSize(const QSize &size) const;
+
     /**
      * Returns an implementation of AbstractDocumentEditor if this document can
      * be edited.
@@ -161,7 +187,7 @@ public:
     /**
      * Returns how much bytes the document is using
      */
-    int memoryUsage() const;
+    qint64 memoryUsage() const;
 
     /**
      * Returns the compressed version of the document, if it is still
@@ -235,11 +261,15 @@ private:
     friend class DownSamplingJob;
 
     void setImageInternal(const QImage &);
+    void updateImageInternal(const QImage &, const QRect &changedRect);
+    void setFrameInternal(const QImage &);
+    void swapImageTilesInternal(TiledImage *tiles);
     void setKind(MimeTypeUtils::Kind);
     void setFormat(const QByteArray &);
     void setSize(const QSize &);
     void setExiv2Image(std::unique_ptr<Exiv2::Image>);
     void setDownSampledImage(const QImage &, int invertedZoom);
+    void setNegotiatedImage(const QImage &, qreal scale);
     void switchToImpl(AbstractDocumentImpl *impl);
     void setErrorString(const QString &);
     void setCmsProfile(const Cms::Profile::Ptr &);
@@ -60,6 +60,12 @@ struct DocumentPrivate {
     QSize mSize;
     QImage mImage;
     QMap<int, QImage> mDownSampledImageMap;
+    // Image decoded at the resolution negotiated by prepareImageForSize(),
+    // its scale, and the size which was asked for last
+    QImage mNegotiatedImage;
+    qreal mNegotiatedScale = 0;
+    QSize mNegotiatedSize;
+    bool mFullImageRequested = false;
     std::unique_ptr<Exiv2::Image> mExiv2Image;
     MimeTypeUtils::Kind mKind;
     QByteArray mFormat;
@@ -70,22 +76,51 @@ struct DocumentPrivate {
     /** @} */
 
     void scheduleImageLoading(int invertedZoom);
+    void scheduleImageLoadingForScale(qreal scale);
     void scheduleImageDownSampling(int invertedZoom);
-    void downSampleImage(int invertedZoom);
+    void storeDownSampledImage(const QImage &sourceImage, const QImage &downSampledImage, int invertedZoom);
+    void updateDownSampledImages(const QRect &changedRect);
+
+    /**
+     * Requests were dropped while an image was being decoded, ask again for
+     * the last size
+     */
+    void renegotiateImageSize();
+
+    /**
+     * Returns the smallest decoded image which has at least @a size pixels,
+     * or the largest one if none is large enough, or nullptr
+     */
+    const QImage *imageForSize(const QSize &size) const;
 };
 
-class DownSamplingJob : public DocumentJob
+/**
+ * Produces the down sampled image for mInvertedZoom in a thread, starting
+ * from the closest larger down sampled image which is already available.
+ *
+ * The images are shallow copies taken on the GUI thread when the job is
+ * created: the thread never reads the document, which may be edited
+ * meanwhile.
+ */
+class DownSamplingJob : public ThreadedDocumentJob
 {
     Q_OBJECT
 public:
-    DownSamplingJob(int invertedZoom)
+    DownSamplingJob(int invertedZoom, const QImage &sourceImage, const QImage &levelImage)
         : mInvertedZoom(invertedZoom)
+        , mSourceImage(sourceImage)
+        , mLevelImage(levelImage)
     {
     }
 
-    void doStart() override;
+    void threadedStart() override;
 
     int mInvertedZoom;
+    // The document image, and the image to scale down, which is either it
+    // or a down sampled level
+    QImage mSourceImage;
+    QImage mLevelImage;
+    QImage mDownSampledImage;
 };
 
 } // namespace
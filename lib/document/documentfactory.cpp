@@ -31,6 +31,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 // Local
 #include "gwenview_lib_debug.h"
 #include <gvdebug.h>
+#include <lib/memoryaccounting.h>
 
 namespace Gwenview
 {
@@ -79,10 +80,13 @@ struct DocumentFactoryPrivate {
     DocumentMap mDocumentMap;
     QUndoGroup mUndoGroup;
 
+    int mMemoryAccountingId = 0;
+
     /**
-     * Removes items in a map if they are no longer referenced elsewhere
+     * Removes items in a map if they are no longer referenced elsewhere,
+     * keeping at most @p maxUnreferencedImages of them
      */
-    void garbageCollect(DocumentMap &map)
+    void garbageCollect(DocumentMap &map, int maxUnreferencedImages = MAX_UNREFERENCED_IMAGES)
     {
         // Build a map of all unreferenced images. We use a MultiMap because in
         // rare cases documents may get accessed at the same millisecond.
@@ -100,7 +104,7 @@ struct DocumentFactoryPrivate {
 
         // Remove oldest unreferenced images. Since the map is sorted by key,
         // the oldest one is always unreferencedImages.begin().
-        for (UnreferencedImages::Iterator unreferencedIt = unreferencedImages.begin(); unreferencedImages.count() > MAX_UNREFERENCED_IMAGES;
+        for (UnreferencedImages::Iterator unreferencedIt = unreferencedImages.begin(); unreferencedImages.count() > maxUnreferencedImages;
              unreferencedIt = unreferencedImages.erase(unreferencedIt)) {
             const QUrl url = unreferencedIt.value();
             LOG("Collecting" << url);
@@ -130,10 +134,24 @@ struct DocumentFactoryPrivate {
 DocumentFactory::DocumentFactory()
     : d(new DocumentFactoryPrivate)
 {
+    d->mMemoryAccountingId = MemoryAccounting::instance()->registerCache(
+        QStringLiteral("Documents"),
+        [this] {
+            qint64 usage = 0;
+            for (const DocumentInfo *info : qAsConst(d->mDocumentMap)) {
+                usage += info->mDocument->memoryUsage();
+            }
+            return usage;
+        },
+        [this] {
+            // Documents which are displayed or modified are kept
+            d->garbageCollect(d->mDocumentMap, 0);
+        });
 }
 
 DocumentFactory::~DocumentFactory()
 {
+    MemoryAccounting::instance()->unregisterCache(d->mMemoryAccountingId);
     qDeleteAll(d->mDocumentMap);
     delete d;
 }
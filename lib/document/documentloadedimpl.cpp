@@ -36,6 +36,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "gwenviewconfig.h"
 #include "imageutils.h"
 #include "savejob.h"
+#include "tiledimage.h"
 
 namespace Gwenview
 {
@@ -106,10 +107,25 @@ AbstractDocumentEditor *DocumentLoadedImpl::editor()
 
 void DocumentLoadedImpl::setImage(const QImage &image)
 {
+    // The whole image is replaced: drop the down sampled images rather than
+    // resampling all of them
     setDocumentImage(image);
     Q_EMIT imageRectUpdated(image.rect());
 }
 
+void DocumentLoadedImpl::updateImage(const QImage &image, const QRect &changedRect)
+{
+    updateDocumentImage(image, changedRect);
+    Q_EMIT imageRectUpdated(changedRect);
+}
+
+void DocumentLoadedImpl::swapImageTiles(TiledImage *tiles)
+{
+    const QRect rect = tiles->boundingRect();
+    swapDocumentImageTiles(tiles);
+    Q_EMIT imageRectUpdated(rect);
+}
+
 void DocumentLoadedImpl::applyTransformation(Orientation orientation)
 {
     QImage image = document()->image();
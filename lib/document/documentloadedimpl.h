@@ -61,6 +61,8 @@ protected:
 
     // AbstractDocumentEditor
     void setImage(const QImage &) override;
+    void updateImage(const QImage &image, const QRect &changedRect) override;
+    void swapImageTiles(TiledImage *tiles) override;
     void applyTransformation(Orientation orientation) override;
     //
 
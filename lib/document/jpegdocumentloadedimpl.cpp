@@ -28,12 +28,17 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 // KF
 
 // Local
+#include "imagescaling.h"
 #include "jpegcontent.h"
 
 namespace Gwenview
 {
 struct JpegDocumentLoadedImplPrivate {
     JpegContent *mJpegContent = nullptr;
+    // Set when the document image has been edited in place. The JpegContent
+    // is only updated when saving: holding a reference to the image would
+    // force the next edit to copy it entirely.
+    bool mImageEditedInPlace = false;
 };
 
 JpegDocumentLoadedImpl::JpegDocumentLoadedImpl(Document *doc, JpegContent *jpegContent)
@@ -53,8 +58,12 @@ JpegDocumentLoadedImpl::~JpegDocumentLoadedImpl()
 bool JpegDocumentLoadedImpl::saveInternal(QIODevice *device, const QByteArray &format)
 {
     if (format == "jpeg") {
+        if (d->mImageEditedInPlace) {
+            d->mJpegContent->setImage(document()->image());
+            d->mImageEditedInPlace = false;
+        }
         if (!d->mJpegContent->thumbnail().isNull()) {
-            const QImage thumbnail = document()->image().scaled(128, 128, Qt::KeepAspectRatio);
+            const QImage thumbnail = ImageScaling::scaled(document()->image(), QSize(128, 128), Qt::KeepAspectRatio, ImageScaling::Box);
             d->mJpegContent->setThumbnail(thumbnail);
         }
 
@@ -71,9 +80,23 @@ bool JpegDocumentLoadedImpl::saveInternal(QIODevice *device, const QByteArray &f
 void JpegDocumentLoadedImpl::setImage(const QImage &image)
 {
     d->mJpegContent->setImage(image);
+    d->mImageEditedInPlace = false;
     DocumentLoadedImpl::setImage(image);
 }
 
+void JpegDocumentLoadedImpl::updateImage(const QImage &image, const QRect &changedRect)
+{
+    d->mJpegContent->setImage(image);
+    d->mImageEditedInPlace = false;
+    DocumentLoadedImpl::updateImage(image, changedRect);
+}
+
+void JpegDocumentLoadedImpl::swapImageTiles(TiledImage *tiles)
+{
+    DocumentLoadedImpl::swapImageTiles(tiles);
+    d->mImageEditedInPlace = true;
+}
+
 void JpegDocumentLoadedImpl::applyTransformation(Orientation orientation)
 {
     DocumentLoadedImpl::applyTransformation(orientation);
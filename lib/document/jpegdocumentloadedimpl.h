@@ -47,7 +47,9 @@ protected:
     bool saveInternal(QIODevice *device, const QByteArray &format) override;
 
     // AbstractDocumentEditor
-    void setImage(const QImage &) override;
+    void setImage(const QImage &image) override;
+    void updateImage(const QImage &image, const QRect &changedRect) override;
+    void swapImageTiles(TiledImage *tiles) override;
     void applyTransformation(Orientation orientation) override;
     //
 
@@ -52,7 +52,9 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Local
 #include "animateddocumentloadedimpl.h"
+#include "animationprobe.h"
 #include "cms/cmsprofile.h"
+#include "decodedimagecache.h"
 #include "document.h"
 #include "documentloadedimpl.h"
 #include "emptydocumentimpl.h"
@@ -61,10 +63,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "gwenview_lib_debug.h"
 #include "gwenviewconfig.h"
 #include "imageutils.h"
+#include "ioscheduler.h"
 #include "jpegcontent.h"
 #include "jpegdocumentloadedimpl.h"
 #include "orientation.h"
 #include "svgdocumentloadedimpl.h"
+#include "tracing.h"
 #include "urlutils.h"
 #include "videodocumentloadedimpl.h"
 
@@ -84,6 +88,8 @@ const int HEADER_SIZE = 256;
 struct LoadingDocumentImplPrivate {
     LoadingDocumentImpl *q;
     QPointer<KIO::TransferJob> mTransferJob;
+    // When the transfer started, for tracing
+    qint64 mTransferStartTime = 0;
     QFuture<bool> mMetaInfoFuture;
     QFutureWatcher<bool> mMetaInfoFutureWatcher;
     QFuture<void> mImageDataFuture;
@@ -92,6 +98,9 @@ struct LoadingDocumentImplPrivate {
     // If != 0, this means we need to load an image at zoom =
     // 1/mImageDataInvertedZoom
     int mImageDataInvertedZoom;
+    // If != 0, this means we need to load an image at zoom = mImageDataScale
+    // instead
+    qreal mImageDataScale = 0;
 
     bool mMetaInfoLoaded;
     bool mAnimated;
@@ -103,6 +112,9 @@ struct LoadingDocumentImplPrivate {
     std::unique_ptr<Exiv2::Image> mExiv2Image;
     std::unique_ptr<JpegContent> mJpegContent;
     QImage mImage;
+    // Key under which mImage must be stored in the decoded image cache, empty
+    // if it must not be stored
+    QByteArray mDecodedImageCacheKey;
     Cms::Profile::Ptr mCmsProfile;
     QMimeType mMimeType;
 
@@ -113,6 +125,7 @@ struct LoadingDocumentImplPrivate {
      */
     bool determineKind()
     {
+        GV_TRACE_SPAN("determineKind", "document");
         const QUrl &url = q->document()->url();
         QMimeDatabase db;
         if (KProtocolInfo::determineMimetypeFromExtension(url.scheme())) {
@@ -178,11 +191,16 @@ struct LoadingDocumentImplPrivate {
         }
     }
 
+    bool hasImageDataRequest() const
+    {
+        return mImageDataInvertedZoom != 0 || mImageDataScale > 0;
+    }
+
     void startImageDataLoading()
     {
         LOG("");
         Q_ASSERT(mMetaInfoLoaded);
-        Q_ASSERT(mImageDataInvertedZoom != 0);
+        Q_ASSERT(hasImageDataRequest());
         Q_ASSERT(!mImageDataFuture.isRunning());
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
         mImageDataFuture = QtConcurrent::run(this, &LoadingDocumentImplPrivate::loadImageData);
@@ -194,6 +212,7 @@ struct LoadingDocumentImplPrivate {
 
     bool loadMetaInfo()
     {
+        GV_TRACE_SPAN("loadMetaInfo", "document");
         LOG("mFormatHint" << mFormatHint);
         QBuffer buffer;
         buffer.setBuffer(&mData);
@@ -293,27 +312,98 @@ struct LoadingDocumentImplPrivate {
         }
 
         if (!mCmsProfile && reader.canRead()) {
-            const QImage qtimage = reader.read();
-            if (!qtimage.isNull()) {
-                mCmsProfile = Cms::Profile::loadFromICC(qtimage.colorSpace().iccProfile());
+            // Only a full decode tells the profile: remember it, or its
+            // absence, so that it is not needed next time
+            DecodedImageCache *cache = DecodedImageCache::instance();
+            const QByteArray cacheKey = decodedImageCacheKey(QByteArrayLiteral("icc"));
+            QByteArray iccProfile;
+            if (!cache || cacheKey.isEmpty() || !cache->findProfile(cacheKey, &iccProfile)) {
+                const QImage qtimage = reader.read();
+                if (!qtimage.isNull()) {
+                    iccProfile = qtimage.colorSpace().iccProfile();
+                    if (cache) {
+                        cache->insertProfile(cacheKey, iccProfile);
+                    }
+                }
             }
+            mCmsProfile = Cms::Profile::loadFromICC(iccProfile);
         }
 
         return true;
     }
 
+    /**
+     * Returns the key of the decoded image cache entry for the document
+     * decoded with @p variant, or an empty key if it should not be cached
+     */
+    QByteArray decodedImageCacheKey(const QByteArray &variant) const
+    {
+        const QUrl &url = q->document()->url();
+        if (!url.isLocalFile() || !DecodedImageCache::instance()) {
+            return {};
+        }
+        return DecodedImageCache::key(url.toLocalFile(), variant);
+    }
+
     void loadImageData()
+    {
+        GV_TRACE_SPAN("loadImageData", "document");
+        DecodedImageCache *cache = DecodedImageCache::instance();
+        // Decoding depends on the target size and on the orientation option
+        const QByteArray scaleKey = mImageDataScale > 0 ? "x" + QByteArray::number(mImageDataScale) : QByteArray::number(mImageDataInvertedZoom);
+        const QByteArray cacheKey = decodedImageCacheKey(scaleKey + (GwenviewConfig::applyExifOrientation() ? "/oriented" : "/raw"));
+        mDecodedImageCacheKey.clear();
+        if (!cacheKey.isEmpty()) {
+            mImage = cache->find(cacheKey);
+            if (!mImage.isNull()) {
+                // Only still images are stored
+                LOG("Found in decoded image cache");
+                mAnimated = false;
+                return;
+            }
+        }
+
+        decodeImageData();
+
+        if (!mAnimated && !mImage.isNull()) {
+            // Stored by storeDecodedImage(), once the image has been shown
+            mDecodedImageCacheKey = cacheKey;
+        }
+    }
+
+    /**
+     * Writes the decoded image to the decoded image cache from a worker
+     * thread, so that the write does not delay showing it
+     */
+    void storeDecodedImage()
+    {
+        if (mDecodedImageCacheKey.isEmpty()) {
+            return;
+        }
+        DecodedImageCache *cache = DecodedImageCache::instance();
+        if (!cache) {
+            return;
+        }
+        const QByteArray key = mDecodedImageCacheKey;
+        const QImage image = mImage;
+        mDecodedImageCacheKey.clear();
+        QtConcurrent::run([cache, key, image] {
+            cache->insert(key, image);
+        });
+    }
+
+    void decodeImageData()
     {
         QBuffer buffer;
         buffer.setBuffer(&mData);
         buffer.open(QIODevice::ReadOnly);
         QImageReader reader(&buffer, mFormat);
 
-        LOG("mImageDataInvertedZoom=" << mImageDataInvertedZoom);
+        LOG("mImageDataInvertedZoom=" << mImageDataInvertedZoom << "mImageDataScale=" << mImageDataScale);
         if (mImageSize.isValid() && mImageDataInvertedZoom != 1 && reader.supportsOption(QImageIOHandler::ScaledSize)) {
             // Do not use mImageSize here: QImageReader needs a non-transposed
             // image size
-            QSize size = reader.size() / mImageDataInvertedZoom;
+            QSize size = mImageDataScale > 0 ? reader.size() * mImageDataScale : reader.size() / mImageDataInvertedZoom;
             if (!size.isEmpty()) {
                 LOG("Setting scaled size to" << size);
                 reader.setScaledSize(size);
@@ -332,7 +422,20 @@ struct LoadingDocumentImplPrivate {
             return;
         }
 
-        if (reader.supportsAnimation() && reader.nextImageDelay() > 0 // Assume delay == 0 <=> only one frame
+        if (!reader.supportsAnimation()) {
+            return;
+        }
+
+        // Count frames from the container structure when we know it, it is
+        // much cheaper than decoding the next frame
+        const int frameCount = AnimationProbe::frameCount(mData);
+        if (frameCount >= 0) {
+            LOG("Container has" << frameCount << "frame(s)");
+            mAnimated = frameCount > 1;
+            return;
+        }
+
+        if (reader.nextImageDelay() > 0 // Assume delay == 0 <=> only one frame
         ) {
             /*
              * QImageReader is not really helpful to detect animated gif:
@@ -393,7 +496,9 @@ void LoadingDocumentImpl::init()
     QUrl url = document()->url();
 
     if (UrlUtils::urlIsFastLocalFile(url)) {
-        // Load file content directly
+        // Load file content directly. The read is never delayed, but it makes
+        // background reads on the same device wait.
+        IoScheduler::Request request(url.toLocalFile(), IoScheduler::VisibleImage);
         QFile file(url.toLocalFile());
         if (!file.open(QIODevice::ReadOnly)) {
             setDocumentErrorString(i18nc("@info", "Could not open file %1", url.toLocalFile()));
@@ -401,6 +506,7 @@ void LoadingDocumentImpl::init()
             switchToImpl(new EmptyDocumentImpl(document()));
             return;
         }
+        IoScheduler::adviseSequential(file.handle());
         d->mData = file.read(HEADER_SIZE);
         if (d->determineKind()) {
             return;
@@ -409,6 +515,7 @@ void LoadingDocumentImpl::init()
         d->startLoading();
     } else {
         // Transfer file via KIO
+        d->mTransferStartTime = Tracing::isEnabled() ? Tracing::now() : 0;
         d->mTransferJob = KIO::get(document()->url(), KIO::NoReload, KIO::HideProgressInfo);
         connect(d->mTransferJob.data(), &KIO::TransferJob::data, this, &LoadingDocumentImpl::slotDataReceived);
         connect(d->mTransferJob.data(), &KJob::result, this, &LoadingDocumentImpl::slotTransferFinished);
@@ -428,6 +535,7 @@ void LoadingDocumentImpl::loadImage(int invertedZoom)
     }
     d->mImageDataFutureWatcher.waitForFinished();
     d->mImageDataInvertedZoom = invertedZoom;
+    d->mImageDataScale = 0;
 
     if (d->mMetaInfoLoaded) {
         // Do not test on mMetaInfoFuture.isRunning() here: it might not have
@@ -436,6 +544,25 @@ void LoadingDocumentImpl::loadImage(int invertedZoom)
     }
 }
 
+void LoadingDocumentImpl::loadImageForScale(qreal scale)
+{
+    if (d->mImageDataInvertedZoom == 1) {
+        LOG("Ignoring request: we are loading a full image");
+        return;
+    }
+    if (d->mImageDataFuture.isRunning()) {
+        // Do not block while zooming
+        LOG("Ignoring request: an image is being loaded");
+        return;
+    }
+    d->mImageDataInvertedZoom = 0;
+    d->mImageDataScale = scale;
+
+    if (d->mMetaInfoLoaded) {
+        d->startImageDataLoading();
+    }
+}
+
 void LoadingDocumentImpl::slotDataReceived(KIO::Job *job, const QByteArray &chunk)
 {
     d->mData.append(chunk);
@@ -449,6 +576,9 @@ void LoadingDocumentImpl::slotDataReceived(KIO::Job *job, const QByteArray &chun
 
 void LoadingDocumentImpl::slotTransferFinished(KJob *job)
 {
+    if (d->mTransferStartTime && Tracing::isEnabled()) {
+        Tracing::record("kioTransfer", "document", d->mTransferStartTime, Tracing::now());
+    }
     if (job->error()) {
         setDocumentErrorString(job->errorString());
         Q_EMIT loadingFailed();
@@ -504,7 +634,7 @@ void LoadingDocumentImpl::slotMetaInfoLoaded()
     // Start image loading if necessary
     // We test if mImageDataFuture is not already running because code connected to
     // metaInfoLoaded() signal could have called loadImage()
-    if (!d->mImageDataFuture.isRunning() && d->mImageDataInvertedZoom != 0) {
+    if (!d->mImageDataFuture.isRunning() && d->hasImageDataRequest()) {
         d->startImageDataLoading();
     }
 }
@@ -535,12 +665,18 @@ void LoadingDocumentImpl::slotImageLoaded()
         LOG("Loaded a down sampled image");
         d->mDownSampledImageLoaded = true;
         // We loaded a down sampled image
-        setDocumentDownSampledImage(d->mImage, d->mImageDataInvertedZoom);
+        if (d->mImageDataScale > 0) {
+            setDocumentNegotiatedImage(d->mImage, d->mImageDataScale);
+        } else {
+            setDocumentDownSampledImage(d->mImage, d->mImageDataInvertedZoom);
+        }
+        d->storeDecodedImage();
         return;
     }
 
     LOG("Loaded a full image");
     setDocumentImage(d->mImage);
+    d->storeDecodedImage();
     DocumentLoadedImpl *impl;
     if (d->mJpegContent.get()) {
         impl = new JpegDocumentLoadedImpl(document(), d->mJpegContent.release());
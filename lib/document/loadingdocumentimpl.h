@@ -50,6 +50,13 @@ public:
 
     void loadImage(int invertedZoom);
 
+    /**
+     * Loads the image at @a scale, as negotiated by
+     * Document::prepareImageForSize(). The request is dropped if an image is
+     * being loaded: the document asks again once it is done.
+     */
+    void loadImageForScale(qreal scale);
+
 private Q_SLOTS:
     void slotMetaInfoLoaded();
     void slotImageLoaded();
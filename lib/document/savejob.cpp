@@ -39,6 +39,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include "documentloadedimpl.h"
+#include "tracing.h"
 
 namespace Gwenview
 {
@@ -72,6 +73,7 @@ SaveJob::~SaveJob()
 
 void SaveJob::saveInternal()
 {
+    GV_TRACE_SPAN("save", "document");
     if (!d->mImpl->saveInternal(d->mSaveFile.data(), d->mFormat)) {
         d->mSaveFile->cancelWriting();
         setError(UserDefinedError + 2);
@@ -0,0 +1,160 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "tiledimage.h"
+
+// STL
+#include <cstring>
+
+// Qt
+
+// Local
+#include "gwenview_lib_debug.h"
+
+namespace Gwenview
+{
+static int columnCount(const QSize &imageSize)
+{
+    return (imageSize.width() + TiledImage::TileSize - 1) / TiledImage::TileSize;
+}
+
+/**
+ * Copies an area of @p size pixels from @p src at (srcX, srcY) to @p dst at
+ * (dstX, dstY). Both images must have the same depth.
+ */
+static void copyPixels(const QImage &src, int srcX, int srcY, QImage *dst, int dstX, int dstY, const QSize &size)
+{
+    const int bytesPerPixel = src.depth() / 8;
+    const int bytes = size.width() * bytesPerPixel;
+    for (int y = 0; y < size.height(); ++y) {
+        memcpy(dst->scanLine(dstY + y) + dstX * bytesPerPixel, src.constScanLine(srcY + y) + srcX * bytesPerPixel, bytes);
+    }
+}
+
+TiledImage::TiledImage(const QImage &image, const QRect &rect)
+    : mImageSize(image.size())
+    , mFormat(image.format())
+{
+    const QRect area = rect.intersected(image.rect());
+    if (area.isEmpty()) {
+        return;
+    }
+    if (image.depth() < 8) {
+        qCWarning(GWENVIEW_LIB_LOG) << "Tiles are not supported for images with a depth of" << image.depth();
+        return;
+    }
+    const int columns = columnCount(mImageSize);
+    for (int row = area.top() / TileSize; row <= area.bottom() / TileSize; ++row) {
+        for (int column = area.left() / TileSize; column <= area.right() / TileSize; ++column) {
+            const int index = row * columns + column;
+            mTiles.insert(index, image.copy(tileRect(index)));
+        }
+    }
+}
+
+bool TiledImage::isEmpty() const
+{
+    return mTiles.isEmpty();
+}
+
+QSize TiledImage::imageSize() const
+{
+    return mImageSize;
+}
+
+int TiledImage::tileCount() const
+{
+    return mTiles.count();
+}
+
+QRect TiledImage::tileRect(int index) const
+{
+    const int columns = columnCount(mImageSize);
+    const QRect rect((index % columns) * TileSize, (index / columns) * TileSize, TileSize, TileSize);
+    return rect.intersected(QRect(QPoint(0, 0), mImageSize));
+}
+
+QRegion TiledImage::region() const
+{
+    QRegion region;
+    for (auto it = mTiles.constBegin(); it != mTiles.constEnd(); ++it) {
+        region += tileRect(it.key());
+    }
+    return region;
+}
+
+QRect TiledImage::boundingRect() const
+{
+    QRect rect;
+    for (auto it = mTiles.constBegin(); it != mTiles.constEnd(); ++it) {
+        rect |= tileRect(it.key());
+    }
+    return rect;
+}
+
+QImage TiledImage::toImage() const
+{
+    if (mTiles.isEmpty()) {
+        return {};
+    }
+    const QRect bounds = boundingRect();
+    QImage image(bounds.size(), mFormat);
+    if (image.isNull()) {
+        return {};
+    }
+    image.fill(Qt::transparent);
+    for (auto it = mTiles.constBegin(); it != mTiles.constEnd(); ++it) {
+        const QRect rect = tileRect(it.key());
+        copyPixels(it.value(), 0, 0, &image, rect.left() - bounds.left(), rect.top() - bounds.top(), rect.size());
+    }
+    image.setColorTable(mTiles.first().colorTable());
+    return image;
+}
+
+void TiledImage::setImage(const QImage &image)
+{
+    const QRect bounds = boundingRect();
+    if (image.size() != bounds.size() || image.format() != mFormat) {
+        qCWarning(GWENVIEW_LIB_LOG) << "Image does not match the tiles";
+        return;
+    }
+    for (auto it = mTiles.begin(); it != mTiles.end(); ++it) {
+        const QRect rect = tileRect(it.key());
+        copyPixels(image, rect.left() - bounds.left(), rect.top() - bounds.top(), &it.value(), 0, 0, rect.size());
+    }
+}
+
+void TiledImage::swap(QImage *image)
+{
+    Q_ASSERT(image);
+    if (image->size() != mImageSize || image->format() != mFormat) {
+        qCWarning(GWENVIEW_LIB_LOG) << "Image does not match the tiles";
+        return;
+    }
+    for (auto it = mTiles.begin(); it != mTiles.end(); ++it) {
+        const QRect rect = tileRect(it.key());
+        const QImage previous = image->copy(rect);
+        copyPixels(it.value(), 0, 0, image, rect.left(), rect.top(), rect.size());
+        it.value() = previous;
+    }
+}
+
+} // namespace
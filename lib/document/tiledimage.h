@@ -0,0 +1,99 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef TILEDIMAGE_H
+#define TILEDIMAGE_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QImage>
+#include <QMap>
+#include <QRegion>
+
+namespace Gwenview
+{
+/**
+ * A sparse set of tiles from an image, used to edit and undo parts of large
+ * images without copying them.
+ *
+ * Tiles are aligned on a grid of TileSize pixels covering the whole image.
+ * Only the tiles which have been copied are stored, so the memory used is
+ * proportional to the edited area. Tiles are implicitly shared: copying a
+ * TiledImage is cheap, and modifying a tile only duplicates this tile.
+ */
+class GWENVIEWLIB_EXPORT TiledImage
+{
+public:
+    enum { TileSize = 256 };
+
+    TiledImage() = default;
+
+    /**
+     * Copies the tiles of @p image which intersect @p rect
+     */
+    TiledImage(const QImage &image, const QRect &rect);
+
+    bool isEmpty() const;
+
+    QSize imageSize() const;
+
+    /**
+     * The area covered by the stored tiles, in image coordinates
+     */
+    QRegion region() const;
+
+    QRect boundingRect() const;
+
+    int tileCount() const;
+
+    /**
+     * Returns the stored tiles as a single image covering boundingRect().
+     * Areas of the bounding rect which are not covered by tiles are left
+     * transparent.
+     */
+    QImage toImage() const;
+
+    /**
+     * Updates the stored tiles from @p image, whose top-left corner is at
+     * boundingRect().topLeft()
+     */
+    void setImage(const QImage &image);
+
+    /**
+     * Exchanges the content of the stored tiles with the matching area of
+     * @p image. Calling it twice restores both to their initial state: this
+     * is how edits are undone and redone.
+     *
+     * @p image is modified in place, so it is only copied if it is shared.
+     */
+    void swap(QImage *image);
+
+private:
+    QRect tileRect(int index) const;
+
+    QSize mImageSize;
+    QImage::Format mFormat = QImage::Format_Invalid;
+    QMap<int, QImage> mTiles;
+};
+
+} // namespace
+
+#endif /* TILEDIMAGE_H */
@@ -26,14 +26,20 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include <lib/graphicswidgetfloater.h>
 #include <lib/gvdebug.h>
 #include <lib/gwenviewconfig.h>
+#include <lib/imageblending.h>
+#include <lib/tracing.h>
 
 // KF
 
 // Qt
+#include <QGraphicsItem>
 #include <QGraphicsScene>
 #include <QOpenGLWidget>
+#include <QPainter>
+#include <QPointer>
 #include <QPropertyAnimation>
 #include <QTimer>
+#include <QVariantAnimation>
 #include <QtMath>
 
 namespace Gwenview
@@ -41,6 +47,48 @@ namespace Gwenview
 using DocumentViewSet = QSet<DocumentView *>;
 using SetupForUrl = QHash<QUrl, DocumentView::Setup>;
 
+/**
+ * Shows the frames of a snapshot cross-fade, above the views
+ */
+class SnapshotFadeItem : public QGraphicsItem
+{
+public:
+    SnapshotFadeItem()
+    {
+        setAcceptedMouseButtons(Qt::NoButton);
+        setZValue(1000);
+    }
+
+    /**
+     * The image shown by the item, in device pixels. Call update() after
+     * changing its pixels.
+     */
+    QImage *frame()
+    {
+        return &mFrame;
+    }
+
+    void setFrame(const QImage &frame)
+    {
+        prepareGeometryChange();
+        mFrame = frame;
+        update();
+    }
+
+    QRectF boundingRect() const override
+    {
+        return QRectF(QPointF(0, 0), QSizeF(mFrame.size()) / mFrame.devicePixelRatio());
+    }
+
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *, QWidget *) override
+    {
+        painter->drawImage(QPointF(0, 0), mFrame);
+    }
+
+private:
+    QImage mFrame;
+};
+
 struct DocumentViewContainerPrivate {
     DocumentViewContainer *q = nullptr;
     QGraphicsScene *mScene = nullptr;
@@ -50,11 +98,140 @@ struct DocumentViewContainerPrivate {
     DocumentViewSet mRemovedViews;
     QTimer *mLayoutUpdateTimer = nullptr;
 
+    // Snapshot cross-fade, see startSnapshotFade()
+    SnapshotFadeItem *mFadeItem = nullptr;
+    QVariantAnimation *mFadeAnimation = nullptr;
+    QTimer *mFadeTimeoutTimer = nullptr;
+    QPointer<DocumentView> mFadeView;
+    QMetaObject::Connection mFadeViewConnection;
+    QImage mFadeFrom;
+    QImage mFadeTo;
+
     void scheduleLayoutUpdate()
     {
         mLayoutUpdateTimer->start();
     }
 
+    bool canSnapshotFade(DocumentView *newView) const
+    {
+        // The new view is kept out of the frames through its opacity effect,
+        // which is not installed on some setups
+        return GwenviewConfig::animationMethod() == DocumentView::SoftwareAnimation && GwenviewConfig::snapshotTransitions() && newView->graphicsEffect();
+    }
+
+    /**
+     * Renders what the container shows, at device resolution
+     */
+    QImage grab() const
+    {
+        GV_TRACE_SPAN("snapshotFade.grab", "view");
+        const qreal dpr = q->devicePixelRatioF();
+        const QSize size = q->viewport()->size();
+        QImage image(size * dpr, QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(dpr);
+        image.fill(q->palette().base().color());
+        QPainter painter(&image);
+        q->render(&painter, QRectF(QPointF(0, 0), size), QRect(QPoint(0, 0), size));
+        return image;
+    }
+
+    /**
+     * Cross-fades from oldView to newView without painting them on every
+     * frame: the container is rendered once now, the new view once it has
+     * loaded its document, and the frames are blends of these snapshots.
+     * This keeps fades smooth when the views are painted in software.
+     */
+    void startSnapshotFade(DocumentView *oldView, DocumentView *newView)
+    {
+        // Grab before finishing the current fade, if any: the snapshot starts
+        // from the frame being shown
+        const QImage from = grab();
+        finishSnapshotFade();
+
+        oldView->hideAndDeleteLater();
+        mFadeView = newView;
+        mFadeFrom = from;
+        mFadeTo = QImage();
+        if (!mFadeItem) {
+            mFadeItem = new SnapshotFadeItem;
+            mScene->addItem(mFadeItem);
+        }
+        mFadeItem->setFrame(from);
+        mFadeItem->show();
+
+        // Wait for the new view to load its document, but not longer than
+        // the fade would last: fade to what it shows then
+        mFadeViewConnection = QObject::connect(newView, &DocumentView::completed, q, [this] {
+            // Let the view apply its zoom before rendering it
+            QTimer::singleShot(0, q, [this] {
+                startSnapshotFadeAnimation();
+            });
+        });
+        mFadeTimeoutTimer->start();
+    }
+
+    void startSnapshotFadeAnimation()
+    {
+        if (!mFadeTo.isNull()) {
+            return;
+        }
+        if (!mFadeView) {
+            finishSnapshotFade();
+            return;
+        }
+        mFadeTimeoutTimer->stop();
+        QObject::disconnect(mFadeViewConnection);
+
+        mFadeItem->hide();
+        mFadeView->setGraphicsEffectOpacity(1);
+        mFadeTo = grab();
+        mFadeView->setGraphicsEffectOpacity(0);
+        mFadeItem->show();
+
+        // Blend in a buffer of its own, the frame shown until now shares its
+        // pixels with mFadeFrom
+        QImage frame;
+        if (!ImageBlending::crossFade(mFadeFrom, mFadeTo, 0, &frame)) {
+            finishSnapshotFade();
+            return;
+        }
+        mFadeItem->setFrame(frame);
+        mFadeAnimation->start();
+    }
+
+    void updateSnapshotFadeFrame(qreal progress)
+    {
+        if (mFadeTo.isNull()) {
+            return;
+        }
+        GV_TRACE_SPAN("snapshotFade.blend", "view");
+        ImageBlending::crossFade(mFadeFrom, mFadeTo, progress, mFadeItem->frame());
+        mFadeItem->update();
+    }
+
+    /**
+     * Ends the snapshot fade now, if there is one, and shows the new view
+     */
+    void finishSnapshotFade()
+    {
+        if (!mFadeItem || !mFadeItem->isVisible()) {
+            return;
+        }
+        mFadeAnimation->stop();
+        mFadeTimeoutTimer->stop();
+        QObject::disconnect(mFadeViewConnection);
+        mFadeItem->hide();
+        mFadeItem->setFrame(QImage());
+        mFadeFrom = QImage();
+        mFadeTo = QImage();
+        if (mFadeView) {
+            DocumentView *view = mFadeView;
+            mFadeView.clear();
+            view->setGraphicsEffectOpacity(1);
+            q->slotFadeInFinished(view);
+        }
+    }
+
     /**
      * Remove view from set, move it to mRemovedViews so that it is later
      * deleted.
@@ -102,6 +279,24 @@ DocumentViewContainer::DocumentViewContainer(QWidget *parent)
     d->mLayoutUpdateTimer->setSingleShot(true);
     connect(d->mLayoutUpdateTimer, &QTimer::timeout, this, &DocumentViewContainer::updateLayout);
 
+    d->mFadeAnimation = new QVariantAnimation(this);
+    d->mFadeAnimation->setStartValue(0.);
+    d->mFadeAnimation->setEndValue(1.);
+    d->mFadeAnimation->setDuration(DocumentView::AnimDuration);
+    connect(d->mFadeAnimation, &QVariantAnimation::valueChanged, this, [this](const QVariant &value) {
+        d->updateSnapshotFadeFrame(value.toReal());
+    });
+    connect(d->mFadeAnimation, &QVariantAnimation::finished, this, [this] {
+        d->finishSnapshotFade();
+    });
+
+    d->mFadeTimeoutTimer = new QTimer(this);
+    d->mFadeTimeoutTimer->setInterval(DocumentView::AnimDuration);
+    d->mFadeTimeoutTimer->setSingleShot(true);
+    connect(d->mFadeTimeoutTimer, &QTimer::timeout, this, [this] {
+        d->startSnapshotFadeAnimation();
+    });
+
     connect(GwenviewConfig::self(), &GwenviewConfig::configChanged, this, &DocumentViewContainer::slotConfigChanged);
 }
 
@@ -141,6 +336,7 @@ void DocumentViewContainer::updateSetup(DocumentView *view)
 
 void DocumentViewContainer::reset()
 {
+    d->finishSnapshotFade();
     d->resetSet(&d->mViews);
     d->resetSet(&d->mAddedViews);
     d->resetSet(&d->mRemovedViews);
@@ -155,6 +351,8 @@ void DocumentViewContainer::showEvent(QShowEvent *event)
 void DocumentViewContainer::resizeEvent(QResizeEvent *event)
 {
     QWidget::resizeEvent(event);
+    // The snapshots no longer match the views
+    d->finishSnapshotFade();
     d->mScene->setSceneRect(rect());
     updateLayout();
 }
@@ -180,6 +378,12 @@ void DocumentViewContainer::updateLayout()
         DocumentView *newView = *d->mAddedViews.begin();
 
         newView->setGeometry(rect());
+        if (d->canSnapshotFade(newView)) {
+            d->startSnapshotFade(oldView, newView);
+            d->mRemovedViews.clear();
+            return;
+        }
+        d->finishSnapshotFade();
         QPropertyAnimation *anim = newView->fadeIn();
 
         oldView->setZValue(-1);
@@ -189,6 +393,7 @@ void DocumentViewContainer::updateLayout()
         return;
     }
 
+    d->finishSnapshotFade();
     if (!views.isEmpty()) {
         // Compute column count
         int colCount;
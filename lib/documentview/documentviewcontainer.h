@@ -90,6 +90,7 @@ protected:
 
 private:
     friend class ViewItem;
+    friend struct DocumentViewContainerPrivate;
     DocumentViewContainerPrivate *const d;
 
 private Q_SLOTS:
@@ -24,12 +24,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 #include <QDebug>
 #include <QGraphicsScene>
-#include <QGraphicsView>
 #include <QPainter>
 
 #include "gvdebug.h"
+#include "imagescaling.h"
 #include "lib/cms/cmsprofile.h"
+#include "memoryaccounting.h"
 #include "rasterimageview.h"
+#include "renderscheduler.h"
+#include "tracing.h"
 
 using namespace Gwenview;
 
@@ -41,10 +44,23 @@ RasterImageItem::RasterImageItem(Gwenview::RasterImageView *parent)
     : QGraphicsItem(parent)
     , mParentView(parent)
 {
+    mMemoryAccountingId = MemoryAccounting::instance()->registerCache(
+        QStringLiteral("Scaled view images"),
+        [this] {
+            return mThirdScaledImage.sizeInBytes() + mSixthScaledImage.sizeInBytes() + mFrame.sizeInBytes();
+        },
+        [this] {
+            // Painting recomputes them when needed
+            updateCache();
+        });
 }
 
 RasterImageItem::~RasterImageItem()
 {
+    if (mScheduler) {
+        mScheduler->removeItem(this);
+    }
+    MemoryAccounting::instance()->unregisterCache(mMemoryAccountingId);
     if (mDisplayTransform) {
         cmsDeleteTransform(mDisplayTransform);
     }
@@ -53,77 +69,203 @@ RasterImageItem::~RasterImageItem()
 void RasterImageItem::setRenderingIntent(RenderingIntent::Enum intent)
 {
     mRenderingIntent = intent;
+    clearFrame();
+    update();
+}
+
+void RasterImageItem::setDisplayTransformEnabled(bool enabled)
+{
+    mDisplayTransformEnabled = enabled;
+    clearFrame();
     update();
 }
 
 void Gwenview::RasterImageItem::updateCache()
 {
-    // Cache two scaled down versions of the image, one at a third of the size
-    // and one at a sixth. These are used instead of the document image at small
-    // zoom levels, to avoid having to copy around the entire image which can be
-    // very slow for large images.
-    auto document = mParentView->document();
-    mThirdScaledImage = document->image().scaled(document->size() * Third, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-    mSixthScaledImage = document->image().scaled(document->size() * Sixth, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    GV_TRACE_SPAN("updateCache", "view");
+    // Two scaled down versions of the image are cached, one at a third of the
+    // size and one at a sixth. These are used instead of the document image at
+    // small zoom levels, to avoid having to copy around the entire image which
+    // can be very slow for large images.
+    // They are only computed when painting needs them: animations replace the
+    // image for every frame and are usually shown at zoom levels which do not
+    // use them.
+    mThirdScaledImage = QImage();
+    mSixthScaledImage = QImage();
+    clearFrame();
 }
 
-void RasterImageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem * /*option*/, QWidget * /*widget*/)
+void RasterImageItem::resetDisplayTransform()
 {
-    auto document = mParentView->document();
+    // Try again if creating the transform failed, the new profile may work
+    mApplyDisplayTransform = true;
+    clearFrame();
+    update();
+}
 
-    if (document->image().isNull() || mThirdScaledImage.isNull() || mSixthScaledImage.isNull()) {
+void RasterImageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem * /*option*/, QWidget * /*widget*/)
+{
+    GV_TRACE_SPAN("paint", "view");
+    RenderRequest request;
+    if (!createRenderRequest(&request)) {
         return;
     }
 
-    const auto dpr = mParentView->devicePixelRatio();
-    const auto zoom = mParentView->zoom();
+    if (!hasFrame(request)) {
+        if (!mScheduler) {
+            mScheduler = RenderScheduler::forScene(scene());
+            mScheduler->addItem(this);
+        }
+        mScheduler->renderFrames(this);
+    }
 
-    // This assumes we always have at least a single view of the graphics scene,
-    // which should be true when painting a graphics item.
-    const auto viewportRect = mParentView->scene()->views().first()->rect();
+    painter->drawImage(mFrameRect, mFrame);
+}
 
-    // Map the viewport to the image so we get the area of the image that is
-    // visible.
-    auto imageRect = mParentView->mapToImage(viewportRect);
+QRectF RasterImageItem::boundingRect() const
+{
+    return QRectF{QPointF{0, 0}, mParentView->documentSize() * mParentView->zoom()};
+}
+
+bool RasterImageItem::RenderRequest::hasSameFrame(const RenderRequest &other) const
+{
+    return imageKey == other.imageKey && documentSize == other.documentSize && imageRect == other.imageRect && qFuzzyCompare(zoom, other.zoom)
+        && qFuzzyCompare(dpr, other.dpr);
+}
+
+bool RasterImageItem::createRenderRequest(RenderRequest *request) const
+{
+    auto document = mParentView->document();
+    if (!document) {
+        return false;
+    }
+
+    request->documentSize = document->size();
+    request->zoom = mParentView->zoom();
+    // Until the view zooms past it, the document may only have been decoded
+    // at the resolution it is shown at
+    request->image = document->imageForSize(request->documentSize * request->zoom);
+    if (request->image.isNull()) {
+        return false;
+    }
+    request->imageKey = request->image.cacheKey();
+    request->dpr = mParentView->devicePixelRatio();
+
+    // Map the parent view, which clips this item, to the image so we get the
+    // area of the image that is visible. In compare mode the view is smaller
+    // than the viewport of the scene.
+    const QRect viewRect = mParentView->boundingRect().toAlignedRect();
+    auto imageRect = mParentView->mapToImage(viewRect);
 
     // Grow the resulting rect by an arbitrary but small amount to avoid pixel
     // alignment issues. This results in the image being drawn slightly larger
     // than the viewport.
-    imageRect = imageRect.marginsAdded(QMargins(5 * dpr, 5 * dpr, 5 * dpr, 5 * dpr));
+    const int margin = 5 * request->dpr;
+    imageRect = imageRect.marginsAdded(QMargins(margin, margin, margin, margin));
 
     // Constrain the visible area rect by the image's rect so we don't try to
     // copy pixels that are outside the image.
-    imageRect = imageRect.intersected(document->image().rect());
+    request->imageRect = imageRect.intersected(QRect{QPoint{0, 0}, request->documentSize});
+    return true;
+}
+
+bool RasterImageItem::hasFrame(const RenderRequest &request) const
+{
+    return !mFrame.isNull() && mFrameRequest.hasSameFrame(request);
+}
+
+void RasterImageItem::clearFrame()
+{
+    mFrame = QImage();
+    mFrameRequest = RenderRequest();
+}
+
+void RasterImageItem::setFrame(const RenderRequest &request, const QImage &image)
+{
+    mFrame = image;
+    mFrameRequest = request;
+    // Do not keep the document image alive through the request
+    mFrameRequest.image = QImage();
+    mFrameRequest.source = QImage();
+    mFrameRequest.displayTransform = nullptr;
+
+    const qreal zoom = request.zoom;
+    const qreal dpr = request.dpr;
+    const QRect &imageRect = request.imageRect;
+    mFrameRect = QRect{// Ceil the top left corner to avoid pixel alignment issues on higher DPI because QPoint/QSize/QRect
+                       // round instead of flooring when converting from float to int.
+                       QPoint{int(std::ceil(imageRect.left() * (zoom / dpr))), int(std::ceil(imageRect.top() * (zoom / dpr)))},
+                       // Floor the size, similarly to above.
+                       QSize{int(image.size().width() / dpr), int(image.size().height() / dpr)}};
+}
+
+void RasterImageItem::prepareRender(RenderRequest *request)
+{
+    GV_TRACE_SPAN("prepareRender", "view");
+    const QImage &documentImage = request->image;
+    const QRect &imageRect = request->imageRect;
+    const qreal zoom = request->zoom;
 
     QImage image;
     qreal targetZoom = zoom;
 
+    // The image is smaller than the document if it has not been fully loaded
+    const qreal imageScale = qreal(documentImage.width()) / request->documentSize.width();
+
     // Copy the visible area from the document's image into a new image. This
     // allows us to modify the resulting image without affecting the original
     // image data. If we are zoomed out far enough, we instead use one of the
-    // cached scaled copies to avoid having to copy a lot of data.
-    if (zoom > Third) {
-        image = document->image().copy(imageRect);
+    // cached scaled copies to avoid having to copy a lot of data. Images
+    // decoded close to the zoom, like animation frames, are not much larger
+    // than the copies: these would be computed again for each frame for
+    // nothing.
+    if (zoom > Third || imageScale <= 2 * Third) {
+        auto sourceRect = QRect{imageRect.topLeft() * imageScale, imageRect.size() * imageScale};
+        targetZoom = zoom / imageScale;
+        image = documentImage.copy(sourceRect.intersected(documentImage.rect()));
     } else if (zoom > Sixth) {
+        if (mThirdScaledImage.isNull()) {
+            GV_TRACE_SPAN("updateCache.third", "view");
+            mThirdScaledImage = ImageScaling::scaled(documentImage, request->documentSize * Third, ImageScaling::Box);
+        }
         auto sourceRect = QRect{imageRect.topLeft() * Third, imageRect.size() * Third};
         targetZoom = zoom / Third;
         image = mThirdScaledImage.copy(sourceRect);
     } else {
+        if (mSixthScaledImage.isNull()) {
+            GV_TRACE_SPAN("updateCache.sixth", "view");
+            const QImage &source = mThirdScaledImage.isNull() ? documentImage : mThirdScaledImage;
+            mSixthScaledImage = ImageScaling::scaled(source, request->documentSize * Sixth, ImageScaling::Box);
+        }
         auto sourceRect = QRect{imageRect.topLeft() * Sixth, imageRect.size() * Sixth};
         targetZoom = zoom / Sixth;
         image = mSixthScaledImage.copy(sourceRect);
     }
+    request->source = image;
+    request->sourceZoom = targetZoom;
 
+    // Rendering keeps the format of the source
+    if (mDisplayTransformEnabled && mApplyDisplayTransform) {
+        updateDisplayTransform(image.format());
+    }
+    request->displayTransform = mDisplayTransformEnabled && mApplyDisplayTransform ? mDisplayTransform : nullptr;
+}
+
+QImage RasterImageItem::render(const RenderRequest &request, ImageScaling::Threading threading)
+{
+    GV_TRACE_SPAN("render", "view");
+    QImage image = request.source;
     const QImage::Format originalImageFormat = image.format();
 
     // We want nearest neighbour at high zoom since that provides the most
     // accurate representation of pixels, but at low zoom or when zooming out it
     // will not look very nice, so use smoothing instead. Switch at an arbitrary
     // threshold of 400% zoom
-    const auto transformationMode = zoom < 4.0 ? Qt::SmoothTransformation : Qt::FastTransformation;
+    const auto transformationMode = request.zoom < 4.0 ? Qt::SmoothTransformation : Qt::FastTransformation;
 
     // Scale the visible image to the requested zoom.
-    image = image.scaled(image.size() * targetZoom, Qt::IgnoreAspectRatio, transformationMode);
+    const QSize targetSize = image.size() * request.sourceZoom;
+    image = ImageScaling::scaled(image, targetSize, ImageScaling::filterForTransformationMode(transformationMode, image.size(), targetSize), threading);
 
     // Scaling may convert image to premultiplied formats (unsupported by color correction engine),
     // so we convert image back to originalImageFormat.
@@ -131,32 +273,11 @@ void RasterImageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *
         image.convertTo(originalImageFormat);
     }
 
-    // Perform color correction on the visible image.
-    applyDisplayTransform(image);
-
-    const auto destinationRect = QRect{// Ceil the top left corner to avoid pixel alignment issues on higher DPI because QPoint/QSize/QRect
-                                       // round instead of flooring when converting from float to int.
-                                       QPoint{int(std::ceil(imageRect.left() * (zoom / dpr))), int(std::ceil(imageRect.top() * (zoom / dpr)))},
-                                       // Floor the size, similarly to above.
-                                       QSize{int(image.size().width() / dpr), int(image.size().height() / dpr)}};
-
-    painter->drawImage(destinationRect, image);
-}
-
-QRectF RasterImageItem::boundingRect() const
-{
-    return QRectF{QPointF{0, 0}, mParentView->documentSize() * mParentView->zoom()};
-}
-
-void RasterImageItem::applyDisplayTransform(QImage &image)
-{
-    if (mApplyDisplayTransform) {
-        updateDisplayTransform(image.format());
-        if (mDisplayTransform) {
-            quint8 *bytes = image.bits();
-            cmsDoTransform(mDisplayTransform, bytes, bytes, image.width() * image.height());
-        }
+    if (request.displayTransform) {
+        quint8 *bytes = image.bits();
+        cmsDoTransform(request.displayTransform, bytes, bytes, image.width() * image.height());
     }
+    return image;
 }
 
 void RasterImageItem::updateDisplayTransform(QImage::Format format)
@@ -22,12 +22,15 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #define RASTERIMAGEITEM_H
 
 #include <QGraphicsItem>
+#include <QPointer>
 
+#include "lib/imagescaling.h"
 #include "lib/renderingintent.h"
 
 namespace Gwenview
 {
 class RasterImageView;
+class RenderScheduler;
 
 /**
  * A QGraphicsItem subclass responsible for rendering the main raster image.
@@ -40,6 +43,15 @@ class RasterImageView;
  * For performance, two extra images are cached, one at a third of the image
  * size and one at a sixth. These are used at low zoom levels, to avoid having
  * to copy large amounts of image data that later gets discarded.
+ *
+ * Until the full image has been loaded, the image is the one the document
+ * decoded at the resolution the view negotiated with it, which may be smaller
+ * than the document.
+ *
+ * The rendered frame is kept until the zoom, the visible area or the image
+ * change. Frames are rendered by the RenderScheduler of the scene, which
+ * renders the frames of all the items shown side by side in compare mode at
+ * once, in parallel.
  */
 class RasterImageItem : public QGraphicsItem
 {
@@ -52,11 +64,23 @@ public:
      */
     void setRenderingIntent(RenderingIntent::Enum intent);
 
+    /**
+     * Enables or disables the conversion of the image to the display color
+     * profile. Enabled by default.
+     */
+    void setDisplayTransformEnabled(bool enabled);
+
     /**
      * Update the internal, smaller cached versions of the main image.
      */
     void updateCache();
 
+    /**
+     * Recreates the display transform on the next paint, for example because
+     * the monitor color profile changed.
+     */
+    void resetDisplayTransform();
+
     /**
      * Reimplemented from QGraphicsItem::paint
      */
@@ -68,16 +92,65 @@ public:
     virtual QRectF boundingRect() const override;
 
 private:
-    void applyDisplayTransform(QImage &image);
+    friend class RenderScheduler;
+
+    /**
+     * What a frame shows. Requests are created on the GUI thread, the image
+     * is a shallow copy of the document image for the zoom, see
+     * Document::imageForSize().
+     */
+    struct RenderRequest {
+        QImage image;
+        qint64 imageKey = 0;
+        QSize documentSize;
+        QRect imageRect;
+        qreal zoom = 0;
+        qreal dpr = 1;
+
+        // Set by prepareRender(): a copy of the visible part of the image,
+        // which nothing else references, the zoom to scale it by, and the
+        // display transform to apply, if any
+        QImage source;
+        qreal sourceZoom = 0;
+        cmsHTRANSFORM displayTransform = nullptr;
+
+        bool hasSameFrame(const RenderRequest &other) const;
+    };
+
+    bool createRenderRequest(RenderRequest *request) const;
+    bool hasFrame(const RenderRequest &request) const;
+    void clearFrame();
+    void setFrame(const RenderRequest &request, const QImage &image);
+
+    /**
+     * Copies the visible part of the image, or of one of the scaled down
+     * caches which it computes if needed, and creates the display transform.
+     * Must be called on the GUI thread.
+     */
+    void prepareRender(RenderRequest *request);
+
+    /**
+     * Scales the source of @p request and applies its display transform. It
+     * only uses the request, so it can run on a worker thread.
+     */
+    static QImage render(const RenderRequest &request, ImageScaling::Threading threading);
+
     void updateDisplayTransform(QImage::Format format);
 
     RasterImageView *mParentView;
+    QPointer<RenderScheduler> mScheduler;
     bool mApplyDisplayTransform = true;
+    bool mDisplayTransformEnabled = true;
+    int mMemoryAccountingId = 0;
     cmsHTRANSFORM mDisplayTransform = nullptr;
     cmsUInt32Number mRenderingIntent = INTENT_PERCEPTUAL;
 
     QImage mThirdScaledImage;
     QImage mSixthScaledImage;
+
+    RenderRequest mFrameRequest;
+    QImage mFrame;
+    QRect mFrameRect;
 };
 
 }
@@ -74,6 +74,10 @@ public:
     QPointer<AbstractRasterImageViewTool> mTool;
 };
 
+// Zooming renegotiates the resolution of the image once it has stopped for
+// this many milliseconds, rather than at every step
+static const int NEGOTIATION_DELAY = 150;
+
 struct RasterImageViewPrivate {
     RasterImageViewPrivate(RasterImageView *qq)
         : q(qq)
@@ -87,6 +91,25 @@ struct RasterImageViewPrivate {
 
     QPointer<AbstractRasterImageViewTool> mTool;
 
+    // True until the document has an image to show at the initial zoom
+    bool mWaitingForImage = false;
+
+    QTimer *mNegotiationTimer = nullptr;
+
+    /**
+     * Asks the document for the resolution the view needs at @a zoom.
+     * Returns true if the document has it.
+     */
+    bool prepareImageForZoom(qreal zoom)
+    {
+        Document::Ptr doc = q->document();
+        if (!doc || !doc->size().isValid()) {
+            return false;
+        }
+        // Zoom is in device pixels per image pixel
+        return doc->prepareImageForSize(doc->size() * zoom);
+    }
+
     void startAnimationIfNecessary()
     {
         if (q->document() && q->isVisible()) {
@@ -107,6 +130,13 @@ RasterImageView::RasterImageView(QGraphicsItem *parent)
 {
     d->mImageItem = new RasterImageItem{this};
 
+    d->mNegotiationTimer = new QTimer(this);
+    d->mNegotiationTimer->setSingleShot(true);
+    d->mNegotiationTimer->setInterval(NEGOTIATION_DELAY);
+    connect(d->mNegotiationTimer, &QTimer::timeout, this, [this]() {
+        d->prepareImageForZoom(zoom());
+    });
+
     // Clip this item so we only render the visible part of the image when
     // zoomed or when viewing a large image.
     setFlag(QGraphicsItem::ItemClipsChildrenToShape);
@@ -128,11 +158,18 @@ void RasterImageView::setRenderingIntent(const RenderingIntent::Enum &renderingI
 
 void RasterImageView::resetMonitorICC()
 {
-    update();
+    d->mImageItem->resetDisplayTransform();
+}
+
+void RasterImageView::setDisplayTransformEnabled(bool enabled)
+{
+    d->mImageItem->setDisplayTransformEnabled(enabled);
 }
 
 void RasterImageView::loadFromDocument()
 {
+    d->mWaitingForImage = false;
+    d->mNegotiationTimer->stop();
     Document::Ptr doc = document();
     if (!doc) {
         return;
@@ -143,6 +180,8 @@ void RasterImageView::loadFromDocument()
     connect(doc.data(), &Document::imageRectUpdated, this, [this]() {
         d->mImageItem->updateCache();
     });
+    connect(doc.data(), &Document::downSampledImageReady, this, &RasterImageView::slotDocumentImageReady);
+    connect(doc.data(), &Document::loaded, this, &RasterImageView::slotDocumentImageReady);
 
     const Document::LoadingState state = doc->loadingState();
     if (state == Document::MetaInfoLoaded || state == Document::Loaded) {
@@ -152,14 +191,34 @@ void RasterImageView::loadFromDocument()
 
 void RasterImageView::slotDocumentMetaInfoLoaded()
 {
-    if (document()->size().isValid() && document()->image().format() != QImage::Format_Invalid) {
-        QMetaObject::invokeMethod(this, &RasterImageView::finishSetDocument, Qt::QueuedConnection);
-    } else {
+    if (!document()->size().isValid()) {
         // Could not retrieve image size from meta info, we need to load the
         // full image now.
         connect(document().data(), &Document::loaded, this, &RasterImageView::finishSetDocument);
         document()->startLoadingFullImage();
+        return;
+    }
+
+    // Only decode the image at the resolution it is shown at: the full image
+    // is loaded when zooming in needs it
+    const qreal initialZoom = zoomToFit() ? computeZoomToFit() : zoomToFill() ? computeZoomToFill() : zoom();
+    if (d->prepareImageForZoom(initialZoom)) {
+        QMetaObject::invokeMethod(this, &RasterImageView::finishSetDocument, Qt::QueuedConnection);
+    } else {
+        d->mWaitingForImage = true;
+    }
+}
+
+void RasterImageView::slotDocumentImageReady()
+{
+    if (d->mWaitingForImage) {
+        d->mWaitingForImage = false;
+        finishSetDocument();
+        return;
     }
+    // A larger image is available
+    d->mImageItem->updateCache();
+    update();
 }
 
 void RasterImageView::finishSetDocument()
@@ -195,6 +254,10 @@ void RasterImageView::slotDocumentIsAnimatedUpdated()
 void RasterImageView::onZoomChanged()
 {
     d->adjustItemPosition();
+    if (!d->mWaitingForImage) {
+        // Until then, the image item scales the image it has
+        d->mNegotiationTimer->start();
+    }
 }
 
 void RasterImageView::onImageOffsetChanged()
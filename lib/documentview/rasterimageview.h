@@ -49,6 +49,11 @@ public:
     void setRenderingIntent(const RenderingIntent::Enum &renderingIntent);
     void resetMonitorICC();
 
+    /**
+     * Enables or disables color management of the displayed image
+     */
+    void setDisplayTransformEnabled(bool enabled);
+
 Q_SIGNALS:
     void currentToolChanged(AbstractRasterImageViewTool *);
     void imageRectUpdated();
@@ -70,6 +75,7 @@ protected:
 private Q_SLOTS:
     void slotDocumentMetaInfoLoaded();
     void slotDocumentIsAnimatedUpdated();
+    void slotDocumentImageReady();
     void finishSetDocument();
 
 private:
@@ -0,0 +1,127 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "renderscheduler.h"
+
+// Qt
+#include <QGraphicsScene>
+#include <QtConcurrentMap>
+
+// Local
+#include "gwenview_lib_debug.h"
+#include "gwenviewconfig.h"
+#include "rasterimageitem.h"
+#include "tracing.h"
+
+namespace Gwenview
+{
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+RenderScheduler::RenderScheduler(QGraphicsScene *scene)
+    : QObject(scene)
+{
+}
+
+RenderScheduler *RenderScheduler::forScene(QGraphicsScene *scene)
+{
+    Q_ASSERT(scene);
+    auto scheduler = scene->findChild<RenderScheduler *>(QString(), Qt::FindDirectChildrenOnly);
+    if (!scheduler) {
+        scheduler = new RenderScheduler(scene);
+    }
+    return scheduler;
+}
+
+void RenderScheduler::addItem(RasterImageItem *item)
+{
+    if (!mItems.contains(item)) {
+        mItems.append(item);
+    }
+}
+
+void RenderScheduler::removeItem(RasterImageItem *item)
+{
+    mItems.removeOne(item);
+}
+
+void RenderScheduler::renderFrames(RasterImageItem *item)
+{
+    GV_TRACE_SPAN("renderFrames", "view");
+    struct RenderJob {
+        RasterImageItem *item;
+        RasterImageItem::RenderRequest request;
+        QImage image;
+    };
+    QVector<RenderJob> jobs;
+    RenderJob job{item, {}, {}};
+    if (!item->createRenderRequest(&job.request)) {
+        return;
+    }
+    jobs << job;
+
+    if (GwenviewConfig::parallelViewRendering()) {
+        for (RasterImageItem *other : qAsConst(mItems)) {
+            if (other == item || !other->isVisible()) {
+                continue;
+            }
+            RenderJob otherJob{other, {}, {}};
+            if (other->createRenderRequest(&otherJob.request) && !other->hasFrame(otherJob.request)) {
+                jobs << otherJob;
+            }
+        }
+    }
+    LOG("Rendering" << jobs.count() << "frames");
+
+    // Everything which touches the items or the document images happens on
+    // this thread: the scaled down caches, the copies of the visible areas
+    // and the display transforms, which query the monitor profile
+    for (RenderJob &job : jobs) {
+        job.item->prepareRender(&job.request);
+    }
+
+    if (jobs.count() == 1) {
+        jobs.first().image = RasterImageItem::render(jobs.first().request, ImageScaling::Parallel);
+    } else {
+        // The jobs already use the pool, scaling must not wait on it from
+        // within
+        QtConcurrent::blockingMap(jobs, [](RenderJob &job) {
+            job.image = RasterImageItem::render(job.request, ImageScaling::SingleThreaded);
+        });
+    }
+
+    for (const RenderJob &job : qAsConst(jobs)) {
+        job.item->setFrame(job.request, job.image);
+        if (job.item != item) {
+            // item is being painted, the others must be painted again with
+            // their new frame
+            job.item->update();
+        }
+    }
+}
+
+} // namespace
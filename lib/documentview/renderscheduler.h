@@ -0,0 +1,71 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef RENDERSCHEDULER_H
+#define RENDERSCHEDULER_H
+
+// Qt
+#include <QObject>
+#include <QVector>
+
+class QGraphicsScene;
+
+namespace Gwenview
+{
+class RasterImageItem;
+
+/**
+ * Renders the frames of the RasterImageItems of a scene.
+ *
+ * In compare mode the views of a scene are repainted together, for example
+ * when a synchronized pan moves all of them. When painting an item needs a
+ * new frame, the scheduler renders the frames of all the visible items which
+ * need one at once. The visible areas are copied on the GUI thread, then
+ * their scaling and color transform run in parallel on the global thread
+ * pool, and the other views are repainted from their ready frames.
+ */
+class RenderScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Returns the scheduler of @p scene, creating it if necessary. It is
+     * deleted with the scene.
+     */
+    static RenderScheduler *forScene(QGraphicsScene *scene);
+
+    void addItem(RasterImageItem *item);
+    void removeItem(RasterImageItem *item);
+
+    /**
+     * Renders the frame of @p item, and the frames of the other visible
+     * items which are out of date. Must be called on the GUI thread.
+     */
+    void renderFrames(RasterImageItem *item);
+
+private:
+    explicit RenderScheduler(QGraphicsScene *scene);
+
+    QVector<RasterImageItem *> mItems;
+};
+
+} // namespace
+
+#endif /* RENDERSCHEDULER_H */
@@ -0,0 +1,113 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "imageblending.h"
+
+// Qt
+#include <QtGlobal>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Local
+#include "gwenview_lib_debug.h"
+
+namespace Gwenview
+{
+namespace ImageBlending
+{
+// Blend weights are fixed point numbers with this many fractional bits
+static const int WEIGHT_BITS = 8;
+static const uint WEIGHT_ONE = 1 << WEIGHT_BITS;
+
+static bool isBlendable(const QImage &image)
+{
+    return image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32_Premultiplied;
+}
+
+/**
+ * Blends the 4 channels of @p a and @p b at once, two of them in each half of
+ * a 32 bit integer. A channel times a weight fits in 16 bits.
+ */
+static inline quint32 blendPixel(quint32 a, quint32 b, uint weight)
+{
+    const uint inverse = WEIGHT_ONE - weight;
+    const quint32 rb = (((a & 0xff00ff) * inverse + (b & 0xff00ff) * weight) >> WEIGHT_BITS) & 0xff00ff;
+    const quint32 ag = (((a >> 8) & 0xff00ff) * inverse + ((b >> 8) & 0xff00ff) * weight) & 0xff00ff00;
+    return rb | ag;
+}
+
+static void blendRow(const quint32 *a, const quint32 *b, quint32 *out, int width, uint weight)
+{
+    int x = 0;
+#ifdef __SSE2__
+    // 4 pixels per iteration, channels expanded to 16 bit lanes. The results
+    // are the same as blendPixel().
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weightA = _mm_set1_epi16(short(WEIGHT_ONE - weight));
+    const __m128i weightB = _mm_set1_epi16(short(weight));
+    for (; x + 4 <= width; x += 4) {
+        const __m128i pa = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + x));
+        const __m128i pb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + x));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pa, zero), weightA), _mm_mullo_epi16(_mm_unpacklo_epi8(pb, zero), weightB));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pa, zero), weightA), _mm_mullo_epi16(_mm_unpackhi_epi8(pb, zero), weightB));
+        lo = _mm_srli_epi16(lo, WEIGHT_BITS);
+        hi = _mm_srli_epi16(hi, WEIGHT_BITS);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; x < width; ++x) {
+        out[x] = blendPixel(a[x], b[x], weight);
+    }
+}
+
+bool crossFade(const QImage &from, const QImage &to, qreal progress, QImage *dst)
+{
+    Q_ASSERT(dst);
+    if (from.size() != to.size() || !isBlendable(from) || !isBlendable(to)) {
+        qCWarning(GWENVIEW_LIB_LOG) << "Cannot blend" << from.size() << from.format() << "with" << to.size() << to.format();
+        return false;
+    }
+    // RGB32 pixels have an opaque alpha, so they are valid premultiplied ones
+    const QImage::Format format = from.format() == to.format() ? from.format() : QImage::Format_ARGB32_Premultiplied;
+    if (dst->size() != from.size() || dst->format() != format) {
+        *dst = QImage(from.size(), format);
+        if (dst->isNull()) {
+            return false;
+        }
+    }
+    dst->setDevicePixelRatio(from.devicePixelRatio());
+
+    const uint weight = uint(qBound(0, qRound(progress * WEIGHT_ONE), int(WEIGHT_ONE)));
+    const int width = from.width();
+    for (int y = 0; y < from.height(); ++y) {
+        blendRow(reinterpret_cast<const quint32 *>(from.constScanLine(y)),
+                 reinterpret_cast<const quint32 *>(to.constScanLine(y)),
+                 reinterpret_cast<quint32 *>(dst->scanLine(y)),
+                 width,
+                 weight);
+    }
+    return true;
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,51 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef IMAGEBLENDING_H
+#define IMAGEBLENDING_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QImage>
+
+namespace Gwenview
+{
+/**
+ * Pixel blending kernels, used to animate transitions from snapshots rather
+ * than by painting the views again on every frame.
+ */
+namespace ImageBlending
+{
+/**
+ * Stores in @p dst the blend of @p from and @p to, where @p progress goes
+ * from 0 (only @p from) to 1 (only @p to).
+ *
+ * @p from and @p to must have the same size and be RGB32 or
+ * ARGB32_Premultiplied images, blending premultiplied pixels is correct.
+ * @p dst is reallocated if it does not match. It must not be @p from or @p to.
+ * Returns false if the images cannot be blended.
+ */
+GWENVIEWLIB_EXPORT bool crossFade(const QImage &from, const QImage &to, qreal progress, QImage *dst);
+
+} // namespace
+} // namespace
+
+#endif /* IMAGEBLENDING_H */
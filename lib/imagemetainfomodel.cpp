@@ -23,8 +23,11 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "config-gwenview.h"
 
 // Qt
+#include <QFutureWatcher>
 #include <QLocale>
 #include <QSize>
+#include <QThreadPool>
+#include <QtConcurrent>
 
 // KF
 #include <KFileItem>
@@ -200,10 +203,213 @@ private:
     QString mLabel;
 };
 
+using EntryList = QList<MetaInfoGroup::Entry *>;
+
+template<class Datum>
+static void formatDatum(const Datum &datum, QString *label, QString *value)
+{
+    *label = QString::fromLocal8Bit(datum.tagLabel().c_str());
+    std::ostringstream stream;
+    stream << datum;
+    *value = QString::fromLocal8Bit(stream.str().c_str());
+}
+
+/**
+ * Formats all the entries of @p container. Runs in a worker thread, and
+ * returns an empty list if @p cancelled gets set.
+ */
+template<class Container>
+static EntryList formatExivData(const Container &container, const QAtomicInt *cancelled)
+{
+    // key aren't always unique (for example, "Iptc.Application2.Keywords"
+    // may appear multiple times) so we can't know how many rows we will
+    // insert before going through them. That's why we create a hash
+    // before.
+    using EntryHash = QHash<QString, MetaInfoGroup::Entry *>;
+    EntryHash hash;
+
+    for (auto it = container.begin(), end = container.end(); it != end; ++it) {
+        if (cancelled->loadRelaxed()) {
+            qDeleteAll(hash);
+            return {};
+        }
+        try {
+            // Skip metadatum if its tag is an hex number
+            if (it->tagName().substr(0, 2) == "0x") {
+                continue;
+            }
+            const QString key = QString::fromUtf8(it->key().c_str());
+            QString label;
+            QString value;
+            formatDatum(*it, &label, &value);
+
+            EntryHash::iterator hashIt = hash.find(key);
+            if (hashIt != hash.end()) {
+                hashIt.value()->appendValue(value);
+            } else {
+                hash.insert(key, new MetaInfoGroup::Entry(key, label, value));
+            }
+        } catch (const std::out_of_range &error) {
+            // Workaround for https://bugs.launchpad.net/ubuntu/+source/exiv2/+bug/1942799
+            // which was fixed with https://github.com/Exiv2/exiv2/pull/1918/commits/8a1e949bff482f74599f60b8ab518442036b1834
+            qCWarning(GWENVIEW_LIB_LOG) << "Failed to read some meta info:" << error.what();
+        } catch (const Exiv2::Error &error) {
+            qCWarning(GWENVIEW_LIB_LOG) << "Failed to read some meta info:" << error.what();
+        }
+    }
+    return hash.values();
+}
+
+using DatumList = QVector<const Exiv2::Metadatum *>;
+
+/**
+ * Adds the entries of @p container to @p hash, by key. A key may appear
+ * several times.
+ */
+template<class Container>
+static void addExivDatums(const Container &container, QHash<QString, DatumList> *hash)
+{
+    for (auto it = container.begin(), end = container.end(); it != end; ++it) {
+        (*hash)[QString::fromUtf8(it->key().c_str())] << &*it;
+    }
+}
+
+/**
+ * Formats the entries of a single key, without going through the others
+ */
+static bool formatExivDatums(const DatumList &datums, QString *label, QString *value)
+{
+    bool found = false;
+    for (const Exiv2::Metadatum *datum : datums) {
+        try {
+            QString datumValue;
+            formatDatum(*datum, label, &datumValue);
+            if (found) {
+                *value += QLatin1Char('\n') + datumValue.trimmed();
+            } else {
+                *value = datumValue.trimmed();
+            }
+            found = true;
+        } catch (const std::out_of_range &error) {
+            qCWarning(GWENVIEW_LIB_LOG) << "Failed to read some meta info:" << error.what();
+        } catch (const Exiv2::Error &error) {
+            qCWarning(GWENVIEW_LIB_LOG) << "Failed to read some meta info:" << error.what();
+        }
+    }
+    *label = label->trimmed();
+    return found;
+}
+
+/**
+ * Exiv2 groups are populated lazily: setExiv2Image() only indexes the
+ * entries of the image by key. Single keys asked through getInfoForKey(),
+ * which is all the side bar needs, are formatted on their own. Whole groups
+ * are only formatted, in a worker thread, when a view shows their entries
+ * (through fetchMore()): the image information dialog does so for all of
+ * them.
+ *
+ * Exiv2 is not thread safe: the workers share a single thread, and the GUI
+ * thread only reads the image while no worker runs.
+ */
 struct ImageMetaInfoModelPrivate {
     QVector<MetaInfoGroup *> mMetaInfoGroupVector;
     ImageMetaInfoModel *q;
 
+    const Exiv2::Image *mExiv2Image = nullptr;
+    // Exiv2 groups whose entries have not been added yet
+    QSet<int> mPendingGroups;
+    // Entries of the image, by key
+    QHash<QString, DatumList> mExivDatums;
+    QThreadPool mExiv2ThreadPool;
+    QHash<int, QFutureWatcher<EntryList> *> mGroupWatchers;
+    QAtomicInt mCancelled;
+
+    ImageMetaInfoModelPrivate()
+    {
+        mExiv2ThreadPool.setMaxThreadCount(1);
+    }
+
+    /**
+     * Stops the workers, they must not outlive mExiv2Image
+     */
+    void cancelGroupLoading()
+    {
+        mCancelled.storeRelaxed(1);
+        for (QFutureWatcher<EntryList> *watcher : qAsConst(mGroupWatchers)) {
+            watcher->disconnect();
+            watcher->waitForFinished();
+            if (watcher->future().resultCount() > 0) {
+                qDeleteAll(watcher->result());
+            }
+            delete watcher;
+        }
+        mGroupWatchers.clear();
+        mCancelled.storeRelaxed(0);
+    }
+
+    void startGroupLoading(int groupRow)
+    {
+        if (!mPendingGroups.contains(groupRow) || mGroupWatchers.contains(groupRow)) {
+            return;
+        }
+        const Exiv2::Image *image = mExiv2Image;
+        const QAtomicInt *cancelled = &mCancelled;
+        QFuture<EntryList> future;
+        switch (groupRow) {
+        case ExifGroup:
+            future = QtConcurrent::run(&mExiv2ThreadPool, [image, cancelled] {
+                return formatExivData(image->exifData(), cancelled);
+            });
+            break;
+        case IptcGroup:
+            future = QtConcurrent::run(&mExiv2ThreadPool, [image, cancelled] {
+                return formatExivData(image->iptcData(), cancelled);
+            });
+            break;
+        default:
+            future = QtConcurrent::run(&mExiv2ThreadPool, [image, cancelled] {
+                return formatExivData(image->xmpData(), cancelled);
+            });
+            break;
+        }
+        auto watcher = new QFutureWatcher<EntryList>;
+        mGroupWatchers.insert(groupRow, watcher);
+        QObject::connect(watcher, &QFutureWatcherBase::finished, q, [this, groupRow] {
+            QFutureWatcher<EntryList> *watcher = mGroupWatchers.take(groupRow);
+            insertGroupEntries(groupRow, watcher->result());
+            watcher->deleteLater();
+        });
+        watcher->setFuture(future);
+    }
+
+    void insertGroupEntries(int groupRow, const EntryList &entries)
+    {
+        mPendingGroups.remove(groupRow);
+        if (entries.isEmpty()) {
+            return;
+        }
+        MetaInfoGroup *group = mMetaInfoGroupVector[groupRow];
+        q->beginInsertRows(q->index(groupRow, 0), 0, entries.size() - 1);
+        for (MetaInfoGroup::Entry *entry : entries) {
+            group->addEntry(entry);
+        }
+        q->endInsertRows();
+    }
+
+    bool getPendingInfoForKey(const QString &key, QString *label, QString *value) const
+    {
+        const auto it = mExivDatums.constFind(key);
+        if (it == mExivDatums.constEnd()) {
+            return false;
+        }
+        // Group workers are short lived, wait for them rather than reading
+        // the image at the same time
+        for (QFutureWatcher<EntryList> *watcher : mGroupWatchers) {
+            watcher->waitForFinished();
+        }
+        return formatExivDatums(it.value(), label, value);
+    }
+
     void clearGroup(MetaInfoGroup *group, const QModelIndex &parent)
     {
         if (group->size() > 0) {
@@ -258,55 +464,6 @@ struct ImageMetaInfoModelPrivate {
         group->addEntry(QStringLiteral("General.ImageSize"), i18nc("@item:intable", "Image Size"), QString());
         group->addEntry(QStringLiteral("General.Comment"), i18nc("@item:intable", "Comment"), QString());
     }
-
-    template<class Container, class Iterator>
-    void fillExivGroup(const QModelIndex &parent, MetaInfoGroup *group, const Container &container)
-    {
-        // key aren't always unique (for example, "Iptc.Application2.Keywords"
-        // may appear multiple times) so we can't know how many rows we will
-        // insert before going through them. That's why we create a hash
-        // before.
-        using EntryHash = QHash<QString, MetaInfoGroup::Entry *>;
-        EntryHash hash;
-
-        Iterator it = container.begin(), end = container.end();
-
-        for (; it != end; ++it) {
-            try {
-                // Skip metadatum if its tag is an hex number
-                if (it->tagName().substr(0, 2) == "0x") {
-                    continue;
-                }
-                const QString key = QString::fromUtf8(it->key().c_str());
-                const QString label = QString::fromLocal8Bit(it->tagLabel().c_str());
-                std::ostringstream stream;
-                stream << *it;
-                const QString value = QString::fromLocal8Bit(stream.str().c_str());
-
-                EntryHash::iterator hashIt = hash.find(key);
-                if (hashIt != hash.end()) {
-                    hashIt.value()->appendValue(value);
-                } else {
-                    hash.insert(key, new MetaInfoGroup::Entry(key, label, value));
-                }
-            } catch (const std::out_of_range &error) {
-                // Workaround for https://bugs.launchpad.net/ubuntu/+source/exiv2/+bug/1942799
-                // which was fixed with https://github.com/Exiv2/exiv2/pull/1918/commits/8a1e949bff482f74599f60b8ab518442036b1834
-                qCWarning(GWENVIEW_LIB_LOG) << "Failed to read some meta info:" << error.what();
-            } catch (const Exiv2::Error &error) {
-                qCWarning(GWENVIEW_LIB_LOG) << "Failed to read some meta info:" << error.what();
-            }
-        }
-
-        if (hash.isEmpty()) {
-            return;
-        }
-        q->beginInsertRows(parent, 0, hash.size() - 1);
-        for (MetaInfoGroup::Entry *entry : qAsConst(hash)) {
-            group->addEntry(entry);
-        }
-        q->endInsertRows();
-    }
 };
 
 ImageMetaInfoModel::ImageMetaInfoModel()
@@ -330,6 +487,7 @@ ImageMetaInfoModel::ImageMetaInfoModel()
 
 ImageMetaInfoModel::~ImageMetaInfoModel()
 {
+    d->cancelGroupLoading();
     qDeleteAll(d->mMetaInfoGroupVector);
     delete d;
 }
@@ -427,52 +585,59 @@ void ImageMetaInfoModel::setExiv2Image(const Exiv2::Image *image)
     QModelIndex exifIndex = index(ExifGroup, 0);
     QModelIndex iptcIndex = index(IptcGroup, 0);
     QModelIndex xmpIndex = index(XmpGroup, 0);
+    d->cancelGroupLoading();
+    d->mPendingGroups.clear();
+    d->mExivDatums.clear();
     d->clearGroup(exifGroup, exifIndex);
     d->clearGroup(iptcGroup, iptcIndex);
     d->clearGroup(xmpGroup, xmpIndex);
 
+    d->mExiv2Image = image;
     if (!image) {
         return;
     }
 
     d->setGroupEntryValue(GeneralGroup, QStringLiteral("General.Comment"), QString::fromUtf8(image->comment().c_str()));
 
-    if (image->checkMode(Exiv2::mdExif) & Exiv2::amRead) {
-        const Exiv2::ExifData &exifData = image->exifData();
-        d->fillExivGroup<Exiv2::ExifData, Exiv2::ExifData::const_iterator>(exifIndex, exifGroup, exifData);
+    // Entries are only formatted when asked for, see ImageMetaInfoModelPrivate
+    if ((image->checkMode(Exiv2::mdExif) & Exiv2::amRead) && !image->exifData().empty()) {
+        d->mPendingGroups << ExifGroup;
+        addExivDatums(image->exifData(), &d->mExivDatums);
     }
-
-    if (image->checkMode(Exiv2::mdIptc) & Exiv2::amRead) {
-        const Exiv2::IptcData &iptcData = image->iptcData();
-        d->fillExivGroup<Exiv2::IptcData, Exiv2::IptcData::const_iterator>(iptcIndex, iptcGroup, iptcData);
+    if ((image->checkMode(Exiv2::mdIptc) & Exiv2::amRead) && !image->iptcData().empty()) {
+        d->mPendingGroups << IptcGroup;
+        addExivDatums(image->iptcData(), &d->mExivDatums);
     }
-
-    if (image->checkMode(Exiv2::mdXmp) & Exiv2::amRead) {
-        const Exiv2::XmpData &xmpData = image->xmpData();
-        d->fillExivGroup<Exiv2::XmpData, Exiv2::XmpData::const_iterator>(xmpIndex, xmpGroup, xmpData);
+    if ((image->checkMode(Exiv2::mdXmp) & Exiv2::amRead) && !image->xmpData().empty()) {
+        d->mPendingGroups << XmpGroup;
+        addExivDatums(image->xmpData(), &d->mExivDatums);
     }
 }
 
 void ImageMetaInfoModel::getInfoForKey(const QString &key, QString *label, QString *value) const
 {
-    MetaInfoGroup *group;
+    int groupRow;
     if (key.startsWith(QLatin1String("General"))) {
-        group = d->mMetaInfoGroupVector[GeneralGroup];
+        groupRow = GeneralGroup;
     } else if (key.startsWith(QLatin1String("Exif"))) {
-        group = d->mMetaInfoGroupVector[ExifGroup];
+        groupRow = ExifGroup;
 #ifdef HAVE_FITS
     } else if (key.startsWith(QLatin1String("Fits"))) {
-        group = d->mMetaInfoGroupVector[FitsGroup];
+        groupRow = FitsGroup;
 #endif
     } else if (key.startsWith(QLatin1String("Iptc"))) {
-        group = d->mMetaInfoGroupVector[IptcGroup];
+        groupRow = IptcGroup;
     } else if (key.startsWith(QLatin1String("Xmp"))) {
-        group = d->mMetaInfoGroupVector[XmpGroup];
+        groupRow = XmpGroup;
     } else {
         qCWarning(GWENVIEW_LIB_LOG) << "Unknown metainfo key" << key;
         return;
     }
-    group->getInfoForKey(key, label, value);
+    if (d->mPendingGroups.contains(groupRow)) {
+        d->getPendingInfoForKey(key, label, value);
+        return;
+    }
+    d->mMetaInfoGroupVector[groupRow]->getInfoForKey(key, label, value);
 }
 
 QString ImageMetaInfoModel::getValueForKey(const QString &key) const
@@ -535,6 +700,32 @@ int ImageMetaInfoModel::rowCount(const QModelIndex &parent) const
     }
 }
 
+bool ImageMetaInfoModel::hasChildren(const QModelIndex &parent) const
+{
+    if (parent.isValid() && parent.internalId() == NoGroup && d->mPendingGroups.contains(parent.row())) {
+        return true;
+    }
+    return QAbstractItemModel::hasChildren(parent);
+}
+
+bool ImageMetaInfoModel::canFetchMore(const QModelIndex &parent) const
+{
+    return parent.isValid() && parent.internalId() == NoGroup && d->mPendingGroups.contains(parent.row())
+        && !d->mGroupWatchers.contains(parent.row());
+}
+
+void ImageMetaInfoModel::fetchMore(const QModelIndex &parent)
+{
+    if (parent.isValid() && parent.internalId() == NoGroup) {
+        d->startGroupLoading(parent.row());
+    }
+}
+
+bool ImageMetaInfoModel::isLoading() const
+{
+    return !d->mGroupWatchers.isEmpty();
+}
+
 int ImageMetaInfoModel::columnCount(const QModelIndex & /*parent*/) const
 {
     return 2;
@@ -55,10 +55,19 @@ public:
     void getInfoForKey(const QString &key, QString *label, QString *value) const;
     QString getValueForKey(const QString &key) const;
 
+    /**
+     * Returns true while Exiv2 groups requested through fetchMore() are
+     * being formatted
+     */
+    bool isLoading() const;
+
     QModelIndex index(int row, int col, const QModelIndex &parent = QModelIndex()) const override;
     QModelIndex parent(const QModelIndex &) const override;
     int rowCount(const QModelIndex & = QModelIndex()) const override;
     int columnCount(const QModelIndex & = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
     QVariant data(const QModelIndex &, int role = Qt::DisplayRole) const override;
 
@@ -0,0 +1,516 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "imagescaling.h"
+
+// STL
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+// Qt
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Local
+#include "gwenview_lib_debug.h"
+
+namespace Gwenview
+{
+namespace ImageScaling
+{
+// Weights are stored as fixed point numbers with this many fractional bits.
+// It must stay below 15 for the SSE2 code, which multiplies 16 bit values.
+static const int PRECISION_BITS = 14;
+
+// Below this amount of work (output pixels times filter taps) running a pass
+// in parallel costs more than it saves
+static const qint64 MIN_PARALLEL_WORK = 256 * 1024;
+
+//------------------------------------------------------------------------
+//
+// Filters
+//
+//------------------------------------------------------------------------
+static qreal boxFilter(qreal x)
+{
+    return (x >= -0.5 && x < 0.5) ? 1. : 0.;
+}
+
+static qreal bilinearFilter(qreal x)
+{
+    x = qAbs(x);
+    return x < 1. ? 1. - x : 0.;
+}
+
+static qreal sinc(qreal x)
+{
+    if (x == 0.) {
+        return 1.;
+    }
+    x *= M_PI;
+    return std::sin(x) / x;
+}
+
+static qreal lanczos3Filter(qreal x)
+{
+    return (x > -3. && x < 3.) ? sinc(x) * sinc(x / 3.) : 0.;
+}
+
+struct FilterInfo {
+    qreal (*function)(qreal);
+    qreal support;
+};
+
+static FilterInfo filterInfo(Filter filter)
+{
+    switch (filter) {
+    case Bilinear:
+        return {bilinearFilter, 1.};
+    case Lanczos3:
+        return {lanczos3Filter, 3.};
+    case Box:
+    case Nearest:
+        break;
+    }
+    return {boxFilter, .5};
+}
+
+/**
+ * For each output pixel along one axis: the first input pixel, the number of
+ * input pixels and their fixed point weights. Weights of one output pixel
+ * always sum up to exactly 1 << PRECISION_BITS, so flat areas stay flat.
+ */
+struct Coefficients {
+    int kernelSize;
+    QVector<int> starts;
+    QVector<int> counts;
+    QVector<int> weights;
+
+    const int *weightsFor(int outIndex) const
+    {
+        return weights.constData() + outIndex * kernelSize;
+    }
+};
+
+static Coefficients computeCoefficients(int inSize, int outSize, Filter filter)
+{
+    const FilterInfo info = filterInfo(filter);
+    const qreal scale = qreal(inSize) / outSize;
+    // When downscaling, stretch the filter so that it covers all the input pixels
+    const qreal filterScale = qMax(scale, 1.);
+    const qreal support = info.support * filterScale;
+
+    Coefficients coefficients;
+    coefficients.kernelSize = int(std::ceil(support)) * 2 + 1;
+    coefficients.starts.resize(outSize);
+    coefficients.counts.resize(outSize);
+    coefficients.weights.fill(0, outSize * coefficients.kernelSize);
+
+    QVector<qreal> weights(coefficients.kernelSize);
+    for (int out = 0; out < outSize; ++out) {
+        const qreal center = (out + .5) * scale;
+        int start = qMax(int(center - support + .5), 0);
+        int count = qMin(int(center + support + .5), inSize) - start;
+        count = qMin(count, coefficients.kernelSize);
+
+        qreal total = 0;
+        for (int k = 0; k < count; ++k) {
+            weights[k] = info.function((start + k - center + .5) / filterScale);
+            total += weights[k];
+        }
+        if (count <= 0 || total == 0.) {
+            // Can happen with the box filter on exact boundaries: fall back
+            // to the nearest pixel
+            start = qBound(0, int(center), inSize - 1);
+            count = 1;
+            weights[0] = total = 1.;
+        }
+
+        int *fixedWeights = coefficients.weights.data() + out * coefficients.kernelSize;
+        int fixedTotal = 0;
+        int largest = 0;
+        for (int k = 0; k < count; ++k) {
+            fixedWeights[k] = qRound(weights[k] / total * (1 << PRECISION_BITS));
+            fixedTotal += fixedWeights[k];
+            if (fixedWeights[k] > fixedWeights[largest]) {
+                largest = k;
+            }
+        }
+        // Give the rounding error to the largest weight
+        fixedWeights[largest] += (1 << PRECISION_BITS) - fixedTotal;
+
+        coefficients.starts[out] = start;
+        coefficients.counts[out] = count;
+    }
+    return coefficients;
+}
+
+//------------------------------------------------------------------------
+//
+// Parallel execution
+//
+//------------------------------------------------------------------------
+/**
+ * Calls @p function(firstRow, endRow) on bands covering @p rowCount rows,
+ * in parallel if @p threading allows it and the amount of work is worth it.
+ */
+template<typename Function>
+static void forEachBand(Threading threading, int rowCount, qint64 workPerRow, const Function &function)
+{
+    const int threadCount = QThreadPool::globalInstance()->maxThreadCount();
+    if (threading == SingleThreaded || threadCount <= 1 || rowCount < 2 || rowCount * workPerRow < MIN_PARALLEL_WORK) {
+        function(0, rowCount);
+        return;
+    }
+
+    // Use more bands than threads so that an unlucky slow band does not
+    // leave the other threads idle
+    const int bandCount = qMin(rowCount, threadCount * 4);
+    QVector<int> bands(bandCount);
+    std::iota(bands.begin(), bands.end(), 0);
+    QtConcurrent::blockingMap(bands, [&function, rowCount, bandCount](int band) {
+        function(rowCount * band / bandCount, rowCount * (band + 1) / bandCount);
+    });
+}
+
+//------------------------------------------------------------------------
+//
+// Separable passes
+//
+//------------------------------------------------------------------------
+template<typename T>
+static inline T clampToPixel(qint64 value)
+{
+    const qint64 maxValue = std::numeric_limits<T>::max();
+    return T(value < 0 ? 0 : (value > maxValue ? maxValue : value));
+}
+
+template<typename T, int Channels, typename Acc>
+static void horizontalPass(const QImage &src, QImage *dst, const Coefficients &coefficients, int firstRow, int endRow)
+{
+    const int dstWidth = dst->width();
+    for (int y = firstRow; y < endRow; ++y) {
+        const T *in = reinterpret_cast<const T *>(src.constScanLine(y));
+        T *out = reinterpret_cast<T *>(dst->scanLine(y));
+        for (int x = 0; x < dstWidth; ++x) {
+            const T *pixels = in + coefficients.starts[x] * Channels;
+            const int *weights = coefficients.weightsFor(x);
+            const int count = coefficients.counts[x];
+
+            Acc acc[Channels];
+            for (int ch = 0; ch < Channels; ++ch) {
+                acc[ch] = Acc(1) << (PRECISION_BITS - 1);
+            }
+            for (int k = 0; k < count; ++k) {
+                for (int ch = 0; ch < Channels; ++ch) {
+                    acc[ch] += Acc(pixels[k * Channels + ch]) * weights[k];
+                }
+            }
+            for (int ch = 0; ch < Channels; ++ch) {
+                out[x * Channels + ch] = clampToPixel<T>(acc[ch] >> PRECISION_BITS);
+            }
+        }
+    }
+}
+
+template<typename T, int Channels, typename Acc>
+static void verticalPass(const QImage &src, QImage *dst, const Coefficients &coefficients, int firstRow, int endRow)
+{
+    const int valueCount = dst->width() * Channels;
+    QVector<Acc> acc(valueCount);
+    for (int y = firstRow; y < endRow; ++y) {
+        const int *weights = coefficients.weightsFor(y);
+        const int start = coefficients.starts[y];
+        const int count = coefficients.counts[y];
+
+        acc.fill(Acc(1) << (PRECISION_BITS - 1));
+        Acc *accData = acc.data();
+        // Walk the input row by row: this is cache friendly and the inner
+        // loop is trivially vectorizable
+        for (int k = 0; k < count; ++k) {
+            const T *in = reinterpret_cast<const T *>(src.constScanLine(start + k));
+            const Acc weight = weights[k];
+            for (int i = 0; i < valueCount; ++i) {
+                accData[i] += Acc(in[i]) * weight;
+            }
+        }
+
+        T *out = reinterpret_cast<T *>(dst->scanLine(y));
+        for (int i = 0; i < valueCount; ++i) {
+            out[i] = clampToPixel<T>(accData[i] >> PRECISION_BITS);
+        }
+    }
+}
+
+#ifdef __SSE2__
+// Filters one 32 bit pixel per iteration, with its 4 channels in 32 bit
+// lanes. The pixel is expanded to 16 bit lanes interleaved with zeros so that
+// _mm_madd_epi16() computes channel * weight in each 32 bit lane.
+static inline __m128i loadPixel(quint32 pixel)
+{
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(int(pixel)), zero), zero);
+}
+
+static inline quint32 storePixel(__m128i acc)
+{
+    acc = _mm_srai_epi32(acc, PRECISION_BITS);
+    acc = _mm_packs_epi32(acc, acc);
+    acc = _mm_packus_epi16(acc, acc);
+    return quint32(_mm_cvtsi128_si32(acc));
+}
+
+template<>
+void horizontalPass<quint8, 4, qint32>(const QImage &src, QImage *dst, const Coefficients &coefficients, int firstRow, int endRow)
+{
+    const int dstWidth = dst->width();
+    const __m128i half = _mm_set1_epi32(1 << (PRECISION_BITS - 1));
+    for (int y = firstRow; y < endRow; ++y) {
+        const quint32 *in = reinterpret_cast<const quint32 *>(src.constScanLine(y));
+        quint32 *out = reinterpret_cast<quint32 *>(dst->scanLine(y));
+        for (int x = 0; x < dstWidth; ++x) {
+            const quint32 *pixels = in + coefficients.starts[x];
+            const int *weights = coefficients.weightsFor(x);
+            const int count = coefficients.counts[x];
+
+            __m128i acc = half;
+            for (int k = 0; k < count; ++k) {
+                const __m128i weight = _mm_set1_epi32(weights[k] & 0xffff);
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(loadPixel(pixels[k]), weight));
+            }
+            out[x] = storePixel(acc);
+        }
+    }
+}
+
+template<>
+void verticalPass<quint8, 4, qint32>(const QImage &src, QImage *dst, const Coefficients &coefficients, int firstRow, int endRow)
+{
+    const int width = dst->width();
+    const __m128i half = _mm_set1_epi32(1 << (PRECISION_BITS - 1));
+    QVector<const quint32 *> rows(coefficients.kernelSize);
+    for (int y = firstRow; y < endRow; ++y) {
+        const int *weights = coefficients.weightsFor(y);
+        const int start = coefficients.starts[y];
+        const int count = coefficients.counts[y];
+        for (int k = 0; k < count; ++k) {
+            rows[k] = reinterpret_cast<const quint32 *>(src.constScanLine(start + k));
+        }
+
+        quint32 *out = reinterpret_cast<quint32 *>(dst->scanLine(y));
+        for (int x = 0; x < width; ++x) {
+            __m128i acc = half;
+            for (int k = 0; k < count; ++k) {
+                const __m128i weight = _mm_set1_epi32(weights[k] & 0xffff);
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(loadPixel(rows[k][x]), weight));
+            }
+            out[x] = storePixel(acc);
+        }
+    }
+}
+#endif
+
+/**
+ * Filters with negative lobes can produce color values above alpha, which
+ * are invalid in premultiplied images
+ */
+template<typename T>
+static void clampToAlpha(QImage *image, int alphaIndex, int firstRow, int endRow)
+{
+    const int width = image->width();
+    for (int y = firstRow; y < endRow; ++y) {
+        T *pixel = reinterpret_cast<T *>(image->scanLine(y));
+        for (int x = 0; x < width; ++x, pixel += 4) {
+            const T alpha = pixel[alphaIndex];
+            for (int ch = 0; ch < 4; ++ch) {
+                pixel[ch] = qMin(pixel[ch], alpha);
+            }
+        }
+    }
+}
+
+template<typename T, int Channels, typename Acc>
+static QImage scaleSeparable(const QImage &src, const QSize &size, Filter filter, Threading threading)
+{
+    QImage tmp;
+    if (size.width() == src.width()) {
+        tmp = src;
+    } else {
+        const Coefficients coefficients = computeCoefficients(src.width(), size.width(), filter);
+        tmp = QImage(size.width(), src.height(), src.format());
+        if (tmp.isNull()) {
+            return {};
+        }
+        forEachBand(threading, src.height(), qint64(size.width()) * coefficients.kernelSize, [&](int firstRow, int endRow) {
+            horizontalPass<T, Channels, Acc>(src, &tmp, coefficients, firstRow, endRow);
+        });
+    }
+
+    if (size.height() == tmp.height()) {
+        return tmp;
+    }
+    const Coefficients coefficients = computeCoefficients(tmp.height(), size.height(), filter);
+    QImage dst(size, src.format());
+    if (dst.isNull()) {
+        return {};
+    }
+    forEachBand(threading, size.height(), qint64(size.width()) * coefficients.kernelSize, [&](int firstRow, int endRow) {
+        verticalPass<T, Channels, Acc>(tmp, &dst, coefficients, firstRow, endRow);
+    });
+    return dst;
+}
+
+//------------------------------------------------------------------------
+//
+// Nearest
+//
+//------------------------------------------------------------------------
+static QImage scaleNearest(const QImage &src, const QSize &size, Threading threading)
+{
+    QImage dst(size, src.format());
+    if (dst.isNull()) {
+        return {};
+    }
+    dst.setColorTable(src.colorTable());
+
+    const int bytesPerPixel = src.depth() / 8;
+    QVector<int> offsets(size.width());
+    for (int x = 0; x < size.width(); ++x) {
+        offsets[x] = int((x + .5) * src.width() / size.width()) * bytesPerPixel;
+    }
+
+    forEachBand(threading, size.height(), size.width(), [&](int firstRow, int endRow) {
+        for (int y = firstRow; y < endRow; ++y) {
+            const uchar *in = src.constScanLine(int((y + .5) * src.height() / size.height()));
+            uchar *out = dst.scanLine(y);
+            for (int x = 0; x < size.width(); ++x, out += bytesPerPixel) {
+                memcpy(out, in + offsets[x], bytesPerPixel);
+            }
+        }
+    });
+    return dst;
+}
+
+//------------------------------------------------------------------------
+//
+// Public API
+//
+//------------------------------------------------------------------------
+static QImage::Format workingFormat(const QImage &image)
+{
+    switch (image.format()) {
+    case QImage::Format_Grayscale8:
+    case QImage::Format_Grayscale16:
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGBX64:
+    case QImage::Format_RGBA64_Premultiplied:
+        return image.format();
+    case QImage::Format_RGBA64:
+    case QImage::Format_A2BGR30_Premultiplied:
+    case QImage::Format_A2RGB30_Premultiplied:
+        return QImage::Format_RGBA64_Premultiplied;
+    case QImage::Format_BGR30:
+    case QImage::Format_RGB30:
+        return QImage::Format_RGBX64;
+    default:
+        return image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    }
+}
+
+QImage scaled(const QImage &image, const QSize &size, Filter filter, Threading threading)
+{
+    if (image.isNull() || size.isEmpty()) {
+        return {};
+    }
+    if (size == image.size()) {
+        return image;
+    }
+
+    QImage result;
+    if (filter == Nearest) {
+        result = image.depth() >= 8 ? scaleNearest(image, size, threading) : scaleNearest(image.convertToFormat(workingFormat(image)), size, threading);
+    } else {
+        const QImage::Format format = workingFormat(image);
+        const QImage src = image.format() == format ? image : image.convertToFormat(format);
+        switch (format) {
+        case QImage::Format_Grayscale8:
+            result = scaleSeparable<quint8, 1, qint32>(src, size, filter, threading);
+            break;
+        case QImage::Format_Grayscale16:
+            result = scaleSeparable<quint16, 1, qint64>(src, size, filter, threading);
+            break;
+        case QImage::Format_RGBX64:
+        case QImage::Format_RGBA64_Premultiplied:
+            result = scaleSeparable<quint16, 4, qint64>(src, size, filter, threading);
+            if (filter == Lanczos3 && format == QImage::Format_RGBA64_Premultiplied) {
+                // RGBA64 is stored as 16 bit values in R, G, B, A order
+                forEachBand(threading, result.height(), result.width(), [&result](int firstRow, int endRow) {
+                    clampToAlpha<quint16>(&result, 3, firstRow, endRow);
+                });
+            }
+            break;
+        default:
+            result = scaleSeparable<quint8, 4, qint32>(src, size, filter, threading);
+            if (filter == Lanczos3 && format == QImage::Format_ARGB32_Premultiplied) {
+                // ARGB32 is stored as 32 bit 0xAARRGGBB values
+                const int alphaIndex = Q_BYTE_ORDER == Q_LITTLE_ENDIAN ? 3 : 0;
+                forEachBand(threading, result.height(), result.width(), [&result, alphaIndex](int firstRow, int endRow) {
+                    clampToAlpha<quint8>(&result, alphaIndex, firstRow, endRow);
+                });
+            }
+            break;
+        }
+    }
+
+    if (result.isNull()) {
+        qCWarning(GWENVIEW_LIB_LOG) << "Could not allocate scaled image of size" << size;
+        return {};
+    }
+    result.setDotsPerMeterX(image.dotsPerMeterX());
+    result.setDotsPerMeterY(image.dotsPerMeterY());
+    result.setColorSpace(image.colorSpace());
+    return result;
+}
+
+QImage scaled(const QImage &image, const QSize &size, Qt::AspectRatioMode aspectRatioMode, Filter filter)
+{
+    return scaled(image, image.size().scaled(size, aspectRatioMode), filter);
+}
+
+Filter filterForTransformationMode(Qt::TransformationMode mode, const QSize &sourceSize, const QSize &targetSize)
+{
+    if (mode == Qt::FastTransformation) {
+        return Nearest;
+    }
+    const bool downScaling = targetSize.width() <= sourceSize.width() && targetSize.height() <= sourceSize.height();
+    return downScaling ? Box : Bilinear;
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,79 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef IMAGESCALING_H
+#define IMAGESCALING_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QImage>
+
+namespace Gwenview
+{
+/**
+ * Image resampling, used everywhere Gwenview scales images.
+ *
+ * Filters other than Nearest are separable: the image is resampled
+ * horizontally then vertically, and each pass is split in bands of rows
+ * which are processed in parallel on the global thread pool, unless the
+ * caller asks for SingleThreaded.
+ *
+ * Pixels are filtered in premultiplied form: 8 bit images are processed as
+ * RGB32 or ARGB32_Premultiplied, 16 bit images as RGBX64 or
+ * RGBA64_Premultiplied and grayscale images keep their single channel. The
+ * returned image is in this working format, which may not be the format of
+ * the source image. Nearest keeps the source format.
+ */
+namespace ImageScaling
+{
+enum Filter {
+    Nearest, ///< Fastest. Aliases when downscaling, pixelates when upscaling
+    Box, ///< Area averaging. Fast, and the right choice to downscale
+    Bilinear, ///< Smooth results when upscaling
+    Lanczos3, ///< Sharpest results, but the slowest
+};
+
+enum Threading {
+    Parallel, ///< Splits large images in bands processed on the global thread pool
+    SingleThreaded, ///< Stays on the calling thread, for callers which run in a thread pool themselves
+};
+
+/**
+ * Returns @p image scaled to exactly @p size
+ */
+GWENVIEWLIB_EXPORT QImage scaled(const QImage &image, const QSize &size, Filter filter, Threading threading = Parallel);
+
+/**
+ * Returns @p image scaled to @p size, following @p aspectRatioMode like
+ * QImage::scaled() does
+ */
+GWENVIEWLIB_EXPORT QImage scaled(const QImage &image, const QSize &size, Qt::AspectRatioMode aspectRatioMode, Filter filter);
+
+/**
+ * Returns the filter to use in place of QImage::scaled() with @p mode, when
+ * going from @p sourceSize to @p targetSize
+ */
+GWENVIEWLIB_EXPORT Filter filterForTransformationMode(Qt::TransformationMode mode, const QSize &sourceSize, const QSize &targetSize);
+
+} // namespace
+} // namespace
+
+#endif /* IMAGESCALING_H */
@@ -21,6 +21,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "imageutils.h"
 
 // Qt
+#include <QSize>
 #include <QTransform>
 
 namespace Gwenview
@@ -69,5 +70,15 @@ QTransform transformMatrix(Orientation orientation)
     return matrix;
 }
 
+bool haveSameAspectRatio(const QSize &size, const QSize &referenceSize)
+{
+    if (size.isEmpty() || referenceSize.isEmpty()) {
+        return false;
+    }
+    const qreal ratio = qreal(size.width()) / size.height();
+    const qreal referenceRatio = qreal(referenceSize.width()) / referenceSize.height();
+    return qAbs(ratio - referenceRatio) < 0.03 * referenceRatio;
+}
+
 } // namespace
 } // namespace
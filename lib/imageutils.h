@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <lib/gwenviewlib_export.h>
 #include <lib/orientation.h>
 
+class QSize;
 class QTransform;
 
 namespace Gwenview
@@ -32,6 +33,13 @@ namespace ImageUtils
 {
 GWENVIEWLIB_EXPORT QTransform transformMatrix(Orientation);
 
+/**
+ * Returns true if @p size and @p referenceSize have the same aspect ratio,
+ * within 3%. Embedded thumbnails and previews are sometimes letterboxed
+ * (Canon stores 160x120 ones for 3:2 images), they must not be used then.
+ */
+GWENVIEWLIB_EXPORT bool haveSameAspectRatio(const QSize &size, const QSize &referenceSize);
+
 } // namespace
 } // namespace
 
@@ -94,9 +94,15 @@ static void term_source(j_decompress_ptr)
 
 void setup(j_decompress_ptr cinfo, QIODevice *ioDevice)
 {
-    Q_ASSERT(!cinfo->src);
-    auto src = (IODeviceJpegSourceManager *)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo, JPOOL_PERMANENT, sizeof(IODeviceJpegSourceManager));
-    cinfo->src = src;
+    // If the decompressor is reused, the source manager allocated by a
+    // previous call is still there: it lives in the permanent pool
+    auto src = static_cast<IODeviceJpegSourceManager *>(cinfo->src);
+    if (!src) {
+        src = (IODeviceJpegSourceManager *)(*cinfo->mem->alloc_small)((j_common_ptr)cinfo, JPOOL_PERMANENT, sizeof(IODeviceJpegSourceManager));
+        cinfo->src = src;
+    }
+    src->next_input_byte = nullptr;
+    src->bytes_in_buffer = 0;
 
     src->init_source = init_source;
     src->fill_input_buffer = fill_input_buffer;
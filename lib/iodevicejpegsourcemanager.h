@@ -38,6 +38,8 @@ namespace Gwenview
  *
  * To use it, simply call setup() to initialize your jpeg_decompress_struct
  * with QIODevice-ready callbacks. The device should be opened for reading.
+ * setup() can be called again on the same jpeg_decompress_struct to decode
+ * another device, the source manager is then reused.
  */
 namespace IODeviceJpegSourceManager
 {
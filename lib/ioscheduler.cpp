@@ -0,0 +1,292 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "ioscheduler.h"
+
+// STL
+#include <iterator>
+#include <numeric>
+
+// Qt
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <QtConcurrent>
+
+// System
+#if defined(Q_OS_UNIX) && !defined(Q_OS_DARWIN)
+#include <fcntl.h>
+#define HAVE_FADVISE
+#endif
+
+// Local
+#include "gwenview_lib_debug.h"
+#include "mounttable.h"
+
+namespace Gwenview
+{
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+static const int PRIORITY_COUNT = IoScheduler::VisibleThumbnail + 1;
+
+static const int PREFETCH_CHUNK_SIZE = 1024 * 1024;
+
+// Waiting requests check their token at least this often, in case it has
+// been cancelled from a thread which could not wake them
+static const int CANCEL_CHECK_INTERVAL = 100;
+
+struct IoDevice {
+    int active = 0;
+    int limit = 0;
+    int limitOverride = 0;
+    int waiting[PRIORITY_COUNT] = {};
+
+    int effectiveLimit() const
+    {
+        return limitOverride > 0 ? limitOverride : limit;
+    }
+
+    bool hasHigherPriorityWaiting(IoScheduler::Priority priority) const
+    {
+        for (int i = 0; i < priority; ++i) {
+            if (waiting[i] > 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+struct IoSchedulerPrivate {
+    mutable QMutex mMutex;
+    QWaitCondition mSlotAvailable;
+    QHash<QString, IoDevice> mDevices;
+    QThreadPool mPrefetchPool;
+
+    static bool isGuiThread()
+    {
+        QCoreApplication *app = QCoreApplication::instance();
+        return app && QThread::currentThread() == app->thread();
+    }
+
+    /**
+     * Returns the key identifying the device of @p path, and its recommended
+     * concurrency in @p limit
+     */
+    static QString deviceForPath(const QString &path, int *limit)
+    {
+        const MountInfo mount = MountTable::mountForPath(path);
+        if (limit) {
+            *limit = mount.recommendedConcurrency();
+        }
+        return mount.device.isEmpty() ? mount.mountPoint : mount.device;
+    }
+
+    bool acquire(const QString &deviceKey, int limit, IoScheduler::Priority priority, const IoCancellationToken &token)
+    {
+        QMutexLocker locker(&mMutex);
+        IoDevice &device = mDevices[deviceKey];
+        device.limit = limit;
+        if (priority == IoScheduler::VisibleImage || isGuiThread()) {
+            ++device.active;
+            return true;
+        }
+        if (device.active < device.effectiveLimit() && !device.hasHigherPriorityWaiting(priority)) {
+            ++device.active;
+            return true;
+        }
+
+        LOG("Waiting for" << deviceKey << "priority" << priority);
+        ++device.waiting[priority];
+        while (true) {
+            if (token.isCancelled()) {
+                --device.waiting[priority];
+                // Lower priority requests may have been waiting for us
+                mSlotAvailable.wakeAll();
+                return false;
+            }
+            if (device.active < device.effectiveLimit() && !device.hasHigherPriorityWaiting(priority)) {
+                break;
+            }
+            mSlotAvailable.wait(&mMutex, CANCEL_CHECK_INTERVAL);
+        }
+        --device.waiting[priority];
+        ++device.active;
+        return true;
+    }
+
+    void release(const QString &deviceKey)
+    {
+        QMutexLocker locker(&mMutex);
+        auto it = mDevices.find(deviceKey);
+        Q_ASSERT(it != mDevices.end());
+        --it->active;
+        mSlotAvailable.wakeAll();
+    }
+};
+
+//// IoCancellationToken ////
+IoCancellationToken::IoCancellationToken()
+    : mCancelled(std::make_shared<std::atomic<bool>>(false))
+{
+}
+
+void IoCancellationToken::cancel()
+{
+    if (mCancelled->exchange(true)) {
+        return;
+    }
+    IoSchedulerPrivate *d = IoScheduler::instance()->d;
+    QMutexLocker locker(&d->mMutex);
+    d->mSlotAvailable.wakeAll();
+}
+
+bool IoCancellationToken::isCancelled() const
+{
+    return mCancelled->load();
+}
+
+//// IoScheduler::Request ////
+IoScheduler::Request::Request(const QString &path, Priority priority, const IoCancellationToken &token)
+{
+    int limit;
+    mDevice = IoSchedulerPrivate::deviceForPath(path, &limit);
+    mGranted = IoScheduler::instance()->d->acquire(mDevice, limit, priority, token);
+}
+
+IoScheduler::Request::~Request()
+{
+    if (mGranted) {
+        IoScheduler::instance()->d->release(mDevice);
+    }
+}
+
+bool IoScheduler::Request::isGranted() const
+{
+    return mGranted;
+}
+
+//// IoScheduler ////
+IoScheduler::IoScheduler()
+    : d(new IoSchedulerPrivate)
+{
+    // Prefetch threads mostly wait for their slot, do not let them hold the
+    // global pool
+    d->mPrefetchPool.setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+}
+
+IoScheduler::~IoScheduler()
+{
+    d->mPrefetchPool.waitForDone();
+    delete d;
+}
+
+IoScheduler *IoScheduler::instance()
+{
+    static IoScheduler scheduler;
+    return &scheduler;
+}
+
+QFuture<bool> IoScheduler::prefetch(const QString &path, Priority priority, const IoCancellationToken &token)
+{
+    return QtConcurrent::run(&d->mPrefetchPool, [path, priority, token] {
+        Request request(path, priority, token);
+        if (!request.isGranted()) {
+            return false;
+        }
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        adviseWillNeed(file.handle());
+        // Reading is what warms the cache on file systems which ignore the
+        // hint, such as network ones
+        QByteArray buffer(PREFETCH_CHUNK_SIZE, Qt::Uninitialized);
+        while (!token.isCancelled()) {
+            if (file.read(buffer.data(), buffer.size()) <= 0) {
+                return true;
+            }
+        }
+        LOG("Prefetch of" << path << "cancelled");
+        return false;
+    });
+}
+
+void IoScheduler::setConcurrencyLimit(const QString &path, int limit)
+{
+    const QString deviceKey = IoSchedulerPrivate::deviceForPath(path, nullptr);
+    QMutexLocker locker(&d->mMutex);
+    d->mDevices[deviceKey].limitOverride = limit;
+    d->mSlotAvailable.wakeAll();
+}
+
+int IoScheduler::activeCount(const QString &path) const
+{
+    const QString deviceKey = IoSchedulerPrivate::deviceForPath(path, nullptr);
+    QMutexLocker locker(&d->mMutex);
+    return d->mDevices.value(deviceKey).active;
+}
+
+int IoScheduler::waitingCount(const QString &path) const
+{
+    const QString deviceKey = IoSchedulerPrivate::deviceForPath(path, nullptr);
+    QMutexLocker locker(&d->mMutex);
+    const auto it = d->mDevices.constFind(deviceKey);
+    if (it == d->mDevices.constEnd()) {
+        return 0;
+    }
+    return std::accumulate(std::begin(it->waiting), std::end(it->waiting), 0);
+}
+
+void IoScheduler::adviseSequential(int fd)
+{
+#ifdef HAVE_FADVISE
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+#else
+    Q_UNUSED(fd);
+#endif
+}
+
+void IoScheduler::adviseWillNeed(int fd)
+{
+#ifdef HAVE_FADVISE
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    }
+#else
+    Q_UNUSED(fd);
+#endif
+}
+
+} // namespace
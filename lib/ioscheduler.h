@@ -0,0 +1,141 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef IOSCHEDULER_H
+#define IOSCHEDULER_H
+
+#include <lib/gwenviewlib_export.h>
+
+// STL
+#include <atomic>
+#include <memory>
+
+// Qt
+#include <QFuture>
+#include <QString>
+
+namespace Gwenview
+{
+/**
+ * A flag shared by all the copies of a token. Cancelling it aborts the
+ * IoScheduler requests waiting with it.
+ */
+class GWENVIEWLIB_EXPORT IoCancellationToken
+{
+public:
+    IoCancellationToken();
+
+    void cancel();
+
+    bool isCancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> mCancelled;
+};
+
+struct IoSchedulerPrivate;
+/**
+ * Orders the file reads of the loaders, the preloader and the thumbnail
+ * generator.
+ *
+ * Each device (as reported by MountTable) gets at most
+ * MountInfo::recommendedConcurrency() reads at the same time, and a read
+ * waiting for a slot lets the reads of higher priority classes go first.
+ * Reads made from the GUI thread and VisibleImage reads are never delayed,
+ * they only take their slot so that the background work backs off: lower
+ * priority classes only make sense for reads made from worker threads.
+ */
+class GWENVIEWLIB_EXPORT IoScheduler
+{
+public:
+    /**
+     * Priority classes, highest first
+     */
+    enum Priority {
+        VisibleImage,
+        Preload,
+        VisibleThumbnail,
+    };
+
+    /**
+     * Holds a read slot on the device of a file, from its construction until
+     * its destruction. The constructor blocks until a slot is available or
+     * the token is cancelled.
+     */
+    class GWENVIEWLIB_EXPORT Request
+    {
+    public:
+        Request(const QString &path, Priority priority, const IoCancellationToken &token = IoCancellationToken());
+        ~Request();
+
+        /**
+         * False if the token has been cancelled before a slot was available
+         */
+        bool isGranted() const;
+
+    private:
+        Q_DISABLE_COPY(Request)
+        QString mDevice;
+        bool mGranted;
+    };
+
+    static IoScheduler *instance();
+
+    /**
+     * Reads @p path in a scheduler thread so that a later read finds it in
+     * the page cache. The future result is false if the token has been
+     * cancelled or the file could not be read.
+     */
+    QFuture<bool> prefetch(const QString &path, Priority priority, const IoCancellationToken &token = IoCancellationToken());
+
+    /**
+     * Overrides the concurrency limit of the device holding @p path. Pass 0
+     * to go back to the limit recommended by MountTable.
+     */
+    void setConcurrencyLimit(const QString &path, int limit);
+
+    /**
+     * Number of requests currently holding a slot on the device of @p path
+     */
+    int activeCount(const QString &path) const;
+
+    /**
+     * Number of requests waiting for a slot on the device of @p path
+     */
+    int waitingCount(const QString &path) const;
+
+    /**
+     * Readahead hints for a file descriptor. They do nothing on platforms
+     * without posix_fadvise().
+     */
+    static void adviseSequential(int fd);
+    static void adviseWillNeed(int fd);
+
+private:
+    IoScheduler();
+    ~IoScheduler();
+    friend class IoCancellationToken;
+    friend struct IoSchedulerPrivate;
+    IoSchedulerPrivate *const d;
+};
+
+} // namespace
+
+#endif /* IOSCHEDULER_H */
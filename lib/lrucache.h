@@ -0,0 +1,195 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef LRUCACHE_H
+#define LRUCACHE_H
+
+// STL
+#include <list>
+
+// Qt
+#include <QHash>
+#include <QtGlobal>
+
+namespace Gwenview
+{
+/**
+ * A map holding at most capacity() entries. When it is full, inserting an
+ * entry removes the least recently used one.
+ *
+ * find() counts hits and misses, so that the capacity can be tuned. The
+ * pointers it returns stay valid until the entry is removed, which may happen
+ * on the next insert().
+ *
+ * LruCache is not thread safe.
+ */
+template<typename Key, typename Value>
+class LruCache
+{
+public:
+    struct Entry {
+        Key key;
+        Value value;
+    };
+    using const_iterator = typename std::list<Entry>::const_iterator;
+
+    explicit LruCache(int capacity)
+        : mCapacity(qMax(1, capacity))
+    {
+    }
+
+    /**
+     * Returns the value for @p key and marks it as the most recently used
+     * one, or returns nullptr
+     */
+    Value *find(const Key &key)
+    {
+        auto it = mIndex.constFind(key);
+        if (it == mIndex.constEnd()) {
+            ++mMissCount;
+            return nullptr;
+        }
+        ++mHitCount;
+        mEntries.splice(mEntries.begin(), mEntries, it.value());
+        return &it.value()->value;
+    }
+
+    /**
+     * Like find(), but neither changes the order of entries nor the counters
+     */
+    const Value *peek(const Key &key) const
+    {
+        auto it = mIndex.constFind(key);
+        return it == mIndex.constEnd() ? nullptr : &it.value()->value;
+    }
+
+    bool contains(const Key &key) const
+    {
+        return mIndex.contains(key);
+    }
+
+    /**
+     * Stores @p value for @p key, replacing the existing value if any, and
+     * returns the stored value
+     */
+    Value *insert(const Key &key, const Value &value)
+    {
+        auto it = mIndex.constFind(key);
+        if (it != mIndex.constEnd()) {
+            mEntries.splice(mEntries.begin(), mEntries, it.value());
+            it.value()->value = value;
+            return &it.value()->value;
+        }
+        mEntries.push_front({key, value});
+        mIndex.insert(key, mEntries.begin());
+        trim();
+        return &mEntries.front().value;
+    }
+
+    bool remove(const Key &key)
+    {
+        auto it = mIndex.find(key);
+        if (it == mIndex.end()) {
+            return false;
+        }
+        mEntries.erase(it.value());
+        mIndex.erase(it);
+        return true;
+    }
+
+    void clear()
+    {
+        mEntries.clear();
+        mIndex.clear();
+    }
+
+    int size() const
+    {
+        return mIndex.size();
+    }
+
+    bool isEmpty() const
+    {
+        return mIndex.isEmpty();
+    }
+
+    int capacity() const
+    {
+        return mCapacity;
+    }
+
+    void setCapacity(int capacity)
+    {
+        mCapacity = qMax(1, capacity);
+        trim();
+    }
+
+    quint64 hitCount() const
+    {
+        return mHitCount;
+    }
+
+    quint64 missCount() const
+    {
+        return mMissCount;
+    }
+
+    void resetCounters()
+    {
+        mHitCount = 0;
+        mMissCount = 0;
+    }
+
+    /**
+     * Iterates from the most recently used entry to the least recently used
+     * one
+     */
+    const_iterator begin() const
+    {
+        return mEntries.cbegin();
+    }
+
+    const_iterator end() const
+    {
+        return mEntries.cend();
+    }
+
+private:
+    using EntryList = std::list<Entry>;
+
+    // Most recently used first
+    EntryList mEntries;
+    QHash<Key, typename EntryList::iterator> mIndex;
+    int mCapacity;
+    quint64 mHitCount = 0;
+    quint64 mMissCount = 0;
+
+    void trim()
+    {
+        while (mIndex.size() > mCapacity) {
+            mIndex.remove(mEntries.back().key);
+            mEntries.pop_back();
+        }
+    }
+};
+
+} // namespace
+
+#endif /* LRUCACHE_H */
@@ -0,0 +1,235 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "memoryaccounting.h"
+
+// STL
+#include <algorithm>
+
+// Qt
+#include <QCoreApplication>
+#include <QHash>
+#include <QLocale>
+#include <QMutex>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+
+// Local
+#include "gwenview_lib_debug.h"
+#include "memoryutils.h"
+
+namespace Gwenview
+{
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+static const int PRESSURE_CHECK_INTERVAL = 5000;
+
+static const qreal DEFAULT_PRESSURE_RATIO = 0.1;
+
+struct RegisteredCache {
+    QString name;
+    MemoryAccounting::UsageFunction usage;
+    MemoryAccounting::ShedFunction shed;
+};
+
+struct MemoryAccountingPrivate {
+    mutable QMutex mMutex;
+    QHash<int, RegisteredCache> mCaches;
+    int mNextId = 1;
+    qreal mPressureRatio = DEFAULT_PRESSURE_RATIO;
+    // Owned by the application, which is deleted before this object
+    QPointer<QTimer> mPressureTimer;
+
+    QHash<int, RegisteredCache> caches() const
+    {
+        QMutexLocker locker(&mMutex);
+        return mCaches;
+    }
+
+    /**
+     * Returns how many bytes must be freed for the free memory of the system
+     * to be above the pressure ratio, 0 if there is enough
+     */
+    qint64 missingMemory() const
+    {
+        const qulonglong total = MemoryUtils::getTotalMemory();
+        if (total == 0) {
+            // Unsupported platform
+            return 0;
+        }
+        const qint64 missing = qint64(total * mPressureRatio) - qint64(MemoryUtils::getFreeMemory());
+        return qMax(missing, qint64(0));
+    }
+};
+
+MemoryAccounting::MemoryAccounting()
+    : d(new MemoryAccountingPrivate)
+{
+}
+
+MemoryAccounting::~MemoryAccounting()
+{
+    delete d;
+}
+
+MemoryAccounting *MemoryAccounting::instance()
+{
+    static MemoryAccounting accounting;
+    return &accounting;
+}
+
+int MemoryAccounting::registerCache(const QString &name, const UsageFunction &usage, const ShedFunction &shed)
+{
+    int id;
+    {
+        QMutexLocker locker(&d->mMutex);
+        id = d->mNextId++;
+        d->mCaches.insert(id, {name, usage, shed});
+    }
+    if (shed && !d->mPressureTimer) {
+        // The timer must live in the GUI thread
+        QCoreApplication *app = QCoreApplication::instance();
+        if (app && QThread::currentThread() == app->thread() && thread() == app->thread()) {
+            d->mPressureTimer = new QTimer(app);
+            d->mPressureTimer->setInterval(PRESSURE_CHECK_INTERVAL);
+            connect(d->mPressureTimer, &QTimer::timeout, this, &MemoryAccounting::checkPressure);
+            d->mPressureTimer->start();
+        }
+    }
+    return id;
+}
+
+void MemoryAccounting::unregisterCache(int id)
+{
+    QMutexLocker locker(&d->mMutex);
+    d->mCaches.remove(id);
+}
+
+QVector<MemoryAccounting::Entry> MemoryAccounting::usage() const
+{
+    QVector<Entry> entries;
+    const QHash<int, RegisteredCache> caches = d->caches();
+    for (const RegisteredCache &cache : caches) {
+        const qint64 bytes = cache.usage();
+        auto it = std::find_if(entries.begin(), entries.end(), [&cache](const Entry &entry) {
+            return entry.name == cache.name;
+        });
+        if (it == entries.end()) {
+            entries << Entry{cache.name, 1, bytes};
+        } else {
+            ++it->count;
+            it->bytes += bytes;
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.bytes > b.bytes;
+    });
+    return entries;
+}
+
+qint64 MemoryAccounting::totalUsage() const
+{
+    qint64 total = 0;
+    const QVector<Entry> entries = usage();
+    for (const Entry &entry : entries) {
+        total += entry.bytes;
+    }
+    return total;
+}
+
+QString MemoryAccounting::report() const
+{
+    const QLocale locale = QLocale::c();
+    const QVector<Entry> entries = usage();
+    QString text;
+    qint64 total = 0;
+    for (const Entry &entry : entries) {
+        text += QStringLiteral("%1 (%2): %3\n").arg(entry.name).arg(entry.count).arg(locale.formattedDataSize(entry.bytes));
+        total += entry.bytes;
+    }
+    text += QStringLiteral("Total: %1, system free: %2\n")
+                .arg(locale.formattedDataSize(total))
+                .arg(locale.formattedDataSize(qint64(MemoryUtils::getFreeMemory())));
+    return text;
+}
+
+void MemoryAccounting::shed()
+{
+    const QHash<int, RegisteredCache> caches = d->caches();
+    for (const RegisteredCache &cache : caches) {
+        if (cache.shed) {
+            cache.shed();
+        }
+    }
+}
+
+void MemoryAccounting::setPressureRatio(qreal ratio)
+{
+    d->mPressureRatio = ratio;
+}
+
+qint64 MemoryAccounting::shed(qint64 bytes)
+{
+    // Shed the largest caches first
+    QVector<QPair<qint64, RegisteredCache>> caches;
+    const QHash<int, RegisteredCache> registered = d->caches();
+    for (const RegisteredCache &cache : registered) {
+        if (cache.shed) {
+            caches << qMakePair(cache.usage(), cache);
+        }
+    }
+    std::sort(caches.begin(), caches.end(), [](const QPair<qint64, RegisteredCache> &a, const QPair<qint64, RegisteredCache> &b) {
+        return a.first > b.first;
+    });
+    qint64 freed = 0;
+    for (const auto &pair : qAsConst(caches)) {
+        if (freed >= bytes) {
+            break;
+        }
+        LOG("Shedding" << pair.second.name << pair.first);
+        pair.second.shed();
+        // The free memory of the system is only refreshed every few seconds,
+        // count what the cache reports instead
+        freed += pair.first - pair.second.usage();
+    }
+    return freed;
+}
+
+void MemoryAccounting::checkPressure()
+{
+    const qint64 missing = d->missingMemory();
+    if (missing == 0) {
+        return;
+    }
+    qCWarning(GWENVIEW_LIB_LOG) << "Low memory, shedding caches";
+    Q_EMIT memoryPressure();
+    shed(missing);
+}
+
+} // namespace
@@ -0,0 +1,127 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <lib/gwenviewlib_export.h>
+
+// STL
+#include <functional>
+
+// Qt
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+namespace Gwenview
+{
+struct MemoryAccountingPrivate;
+
+/**
+ * A central registry of the memory used by caches.
+ *
+ * Caches register a function reporting their usage, and optionally a
+ * function freeing what can be recreated. The registry checks the free
+ * memory of the system from time to time: when it runs low, the caches are
+ * asked to shed memory, largest first.
+ *
+ * Usage and shed functions are called from the GUI thread.
+ */
+class GWENVIEWLIB_EXPORT MemoryAccounting : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Returns the number of bytes used by a cache
+     */
+    using UsageFunction = std::function<qint64()>;
+
+    /**
+     * Frees the memory of a cache which can be recreated
+     */
+    using ShedFunction = std::function<void()>;
+
+    struct Entry {
+        QString name;
+        // Number of registered caches with this name
+        int count;
+        qint64 bytes;
+    };
+
+    static MemoryAccounting *instance();
+
+    /**
+     * Registers a cache. Caches of the same kind should use the same
+     * @p name, they are reported together. Returns an id for
+     * unregisterCache().
+     */
+    int registerCache(const QString &name, const UsageFunction &usage, const ShedFunction &shed = ShedFunction());
+
+    void unregisterCache(int id);
+
+    /**
+     * Returns the usage of the registered caches, largest first
+     */
+    QVector<Entry> usage() const;
+
+    qint64 totalUsage() const;
+
+    /**
+     * Returns a human readable report of the usage
+     */
+    QString report() const;
+
+    /**
+     * Asks all caches to shed memory
+     */
+    void shed();
+
+    /**
+     * Asks the caches to shed memory, largest first, until their usage has
+     * dropped by @p bytes. Returns the number of bytes freed.
+     */
+    qint64 shed(qint64 bytes);
+
+    /**
+     * Caches are asked to shed memory when the free memory of the system
+     * drops below @p ratio of the total memory
+     */
+    void setPressureRatio(qreal ratio);
+
+Q_SIGNALS:
+    /**
+     * Emitted when the free memory of the system is low, before the caches
+     * shed memory
+     */
+    void memoryPressure();
+
+private Q_SLOTS:
+    void checkPressure();
+
+private:
+    MemoryAccounting();
+    ~MemoryAccounting() override;
+    MemoryAccountingPrivate *const d;
+};
+
+} // namespace
+
+#endif /* MEMORYACCOUNTING_H */
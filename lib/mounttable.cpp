@@ -0,0 +1,337 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "mounttable.h"
+
+// STL
+#include <algorithm>
+#include <memory>
+
+// Qt
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSocketNotifier>
+#include <QThread>
+#include <QUrl>
+
+// KF
+#include <KMountPoint>
+
+// System
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Local
+#include "gwenview_lib_debug.h"
+
+namespace Gwenview
+{
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+int MountInfo::recommendedConcurrency() const
+{
+    switch (deviceClass) {
+    case SolidStateDevice:
+        return qMax(2, QThread::idealThreadCount());
+    case RotationalDevice:
+    case RemovableDevice:
+        return 1;
+    case NetworkDevice:
+    case UnknownDevice:
+        break;
+    }
+    return 2;
+}
+
+namespace MountTable
+{
+using MountList = std::shared_ptr<const QVector<MountInfo>>;
+
+// Same list as KMountPoint::probablySlow(), plus FUSE network file systems
+static bool isNetworkFileSystem(const QString &fsType)
+{
+    static const QStringList types = {
+        QStringLiteral("nfs"),
+        QStringLiteral("nfs4"),
+        QStringLiteral("cifs"),
+        QStringLiteral("smbfs"),
+        QStringLiteral("smb3"),
+        QStringLiteral("autofs"),
+        QStringLiteral("subfs"),
+        QStringLiteral("ncpfs"),
+        QStringLiteral("afs"),
+        QStringLiteral("9p"),
+        QStringLiteral("ceph"),
+        QStringLiteral("glusterfs"),
+        QStringLiteral("davfs"),
+        QStringLiteral("fuse.sshfs"),
+        QStringLiteral("fuse.rclone"),
+        QStringLiteral("fuse.glusterfs"),
+    };
+    return types.contains(fsType);
+}
+
+static QByteArray readSysFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.readAll().trimmed();
+}
+
+/**
+ * Reads the sysfs attribute @p name of a block device, looking at the parent
+ * disk for partitions
+ */
+static QByteArray readBlockAttribute(const QString &sysPath, const QString &name)
+{
+    QByteArray value = readSysFile(sysPath + QLatin1Char('/') + name);
+    if (value.isEmpty()) {
+        value = readSysFile(sysPath + QStringLiteral("/../") + name);
+    }
+    return value;
+}
+
+static MountInfo::DeviceClass blockDeviceClass(const QString &majorMinor, const QString &device)
+{
+    QString sysPath;
+    if (!majorMinor.startsWith(QLatin1String("0:"))) {
+        sysPath = QFileInfo(QStringLiteral("/sys/dev/block/") + majorMinor).canonicalFilePath();
+    } else if (device.startsWith(QLatin1String("/dev/"))) {
+        // btrfs and others use anonymous device numbers, go through the
+        // device name. /dev/mapper entries are links to /dev/dm-N.
+        const QString name = QFileInfo(QFileInfo(device).canonicalFilePath()).fileName();
+        sysPath = QFileInfo(QStringLiteral("/sys/class/block/") + name).canonicalFilePath();
+    }
+    if (sysPath.isEmpty()) {
+        return MountInfo::UnknownDevice;
+    }
+    if (sysPath.contains(QLatin1String("/usb")) || readBlockAttribute(sysPath, QStringLiteral("removable")) == "1") {
+        return MountInfo::RemovableDevice;
+    }
+    const QByteArray rotational = readBlockAttribute(sysPath, QStringLiteral("queue/rotational"));
+    if (rotational == "1") {
+        return MountInfo::RotationalDevice;
+    } else if (rotational == "0") {
+        return MountInfo::SolidStateDevice;
+    }
+    return MountInfo::UnknownDevice;
+}
+
+/**
+ * Mount points escape spaces, tabs, new lines and backslashes as octal
+ */
+static QString unescape(const QByteArray &field)
+{
+    QByteArray result;
+    result.reserve(field.size());
+    for (int i = 0; i < field.size(); ++i) {
+        if (field[i] == '\\' && i + 3 < field.size()) {
+            bool ok;
+            const int value = field.mid(i + 1, 3).toInt(&ok, 8);
+            if (ok) {
+                result += char(value);
+                i += 3;
+                continue;
+            }
+        }
+        result += field[i];
+    }
+    return QFile::decodeName(result);
+}
+
+static void sortMounts(QVector<MountInfo> *mounts)
+{
+    // When a path is mounted over, the last mount is the visible one
+    std::reverse(mounts->begin(), mounts->end());
+    std::stable_sort(mounts->begin(), mounts->end(), [](const MountInfo &mount1, const MountInfo &mount2) {
+        return mount1.mountPoint.length() > mount2.mountPoint.length();
+    });
+}
+
+QVector<MountInfo> parseMountInfo(const QByteArray &data)
+{
+    QVector<MountInfo> mounts;
+    const QList<QByteArray> lines = data.split('\n');
+    for (const QByteArray &line : lines) {
+        // 36 35 98:0 /mnt1 /mnt2 rw,noatime master:1 - ext3 /dev/root rw,errors=continue
+        const QList<QByteArray> fields = line.split(' ');
+        const int separator = fields.indexOf("-");
+        if (fields.count() < 6 || separator < 6 || separator + 2 >= fields.count()) {
+            continue;
+        }
+        MountInfo mount;
+        mount.mountPoint = unescape(fields[4]);
+        mount.readOnly = fields[5].split(',').contains("ro");
+        mount.fsType = QString::fromLatin1(fields[separator + 1]);
+        mount.device = unescape(fields[separator + 2]);
+        if (isNetworkFileSystem(mount.fsType)) {
+            mount.deviceClass = MountInfo::NetworkDevice;
+        } else if (mount.fsType == QLatin1String("tmpfs") || mount.fsType == QLatin1String("ramfs")) {
+            mount.deviceClass = MountInfo::SolidStateDevice;
+        } else {
+            mount.deviceClass = blockDeviceClass(QString::fromLatin1(fields[2]), mount.device);
+        }
+        mounts << mount;
+    }
+    sortMounts(&mounts);
+    return mounts;
+}
+
+MountInfo findMount(const QVector<MountInfo> &mounts, const QString &path)
+{
+    for (const MountInfo &mount : mounts) {
+        const QString &mountPoint = mount.mountPoint;
+        if (path.startsWith(mountPoint)
+            && (path.length() == mountPoint.length() || mountPoint.endsWith(QLatin1Char('/')) || path.at(mountPoint.length()) == QLatin1Char('/'))) {
+            return mount;
+        }
+    }
+    return {};
+}
+
+/**
+ * Owns the current mount list and keeps it up to date
+ */
+class MountTableWatcher
+{
+public:
+    static MountTableWatcher *instance()
+    {
+        static MountTableWatcher watcher;
+        return &watcher;
+    }
+
+    MountList mounts()
+    {
+        if (mFd < 0 && mFallbackMutex.tryLock()) {
+            // Without change notifications, refresh from time to time
+            if (mFallbackTimer.hasExpired(FALLBACK_REFRESH_INTERVAL)) {
+                loadFromKMountPoint();
+            }
+            mFallbackMutex.unlock();
+        }
+        return std::atomic_load(&mMounts);
+    }
+
+private:
+    enum { FALLBACK_REFRESH_INTERVAL = 5000 };
+
+    MountTableWatcher()
+    {
+#ifdef Q_OS_LINUX
+        mFd = ::open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC);
+        if (mFd >= 0) {
+            refresh();
+            watch();
+            return;
+        }
+#endif
+        loadFromKMountPoint();
+    }
+
+#ifdef Q_OS_LINUX
+    void refresh()
+    {
+        // Reading the file from the watched descriptor also acknowledges the
+        // change notification
+        QByteArray data;
+        char buffer[4096];
+        ::lseek(mFd, 0, SEEK_SET);
+        ssize_t size;
+        while ((size = ::read(mFd, buffer, sizeof(buffer))) > 0) {
+            data.append(buffer, size);
+        }
+        std::atomic_store(&mMounts, MountList(new QVector<MountInfo>(parseMountInfo(data))));
+        LOG("Mount table loaded");
+    }
+
+    void watch()
+    {
+        // The kernel reports changes as an exceptional condition on the file.
+        // The notifier must live in a thread with an event loop.
+        QCoreApplication *app = QCoreApplication::instance();
+        if (!app) {
+            return;
+        }
+        QMetaObject::invokeMethod(app, [this, app] {
+            auto notifier = new QSocketNotifier(mFd, QSocketNotifier::Exception, app);
+            QObject::connect(notifier, &QSocketNotifier::activated, app, [this] {
+                refresh();
+            });
+        });
+    }
+#endif
+
+    void loadFromKMountPoint()
+    {
+        QVector<MountInfo> mounts;
+        const KMountPoint::List list = KMountPoint::currentMountPoints();
+        for (const KMountPoint::Ptr &mountPoint : list) {
+            MountInfo mount;
+            mount.mountPoint = mountPoint->mountPoint();
+            mount.device = mountPoint->mountedFrom();
+            mount.fsType = mountPoint->mountType();
+            mount.readOnly = mountPoint->mountOptions().contains(QLatin1String("ro"));
+            mount.deviceClass = mountPoint->probablySlow() ? MountInfo::NetworkDevice : MountInfo::UnknownDevice;
+            mounts << mount;
+        }
+        sortMounts(&mounts);
+        std::atomic_store(&mMounts, MountList(new QVector<MountInfo>(mounts)));
+        mFallbackTimer.start();
+    }
+
+    int mFd = -1;
+    MountList mMounts;
+    QMutex mFallbackMutex;
+    QElapsedTimer mFallbackTimer;
+};
+
+MountInfo mountForPath(const QString &path)
+{
+    const MountList mounts = MountTableWatcher::instance()->mounts();
+    return mounts ? findMount(*mounts, path) : MountInfo();
+}
+
+MountInfo mountForUrl(const QUrl &url)
+{
+    if (!url.isLocalFile()) {
+        return {};
+    }
+    return mountForPath(url.toLocalFile());
+}
+
+} // namespace
+
+} // namespace
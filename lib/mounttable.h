@@ -0,0 +1,117 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef MOUNTTABLE_H
+#define MOUNTTABLE_H
+
+#include <lib/gwenviewlib_export.h>
+
+// Qt
+#include <QString>
+#include <QVector>
+
+class QUrl;
+
+namespace Gwenview
+{
+/**
+ * What Gwenview knows about a mounted file system
+ */
+struct GWENVIEWLIB_EXPORT MountInfo {
+    enum DeviceClass {
+        UnknownDevice,
+        SolidStateDevice, ///< SSD, NVMe, or memory backed (tmpfs)
+        RotationalDevice,
+        RemovableDevice, ///< USB disks, SD cards
+        NetworkDevice,
+    };
+
+    QString mountPoint;
+    QString device;
+    QString fsType;
+    bool readOnly = false;
+    DeviceClass deviceClass = UnknownDevice;
+
+    bool isValid() const
+    {
+        return !mountPoint.isEmpty();
+    }
+
+    bool isNetwork() const
+    {
+        return deviceClass == NetworkDevice;
+    }
+
+    bool isRemovable() const
+    {
+        return deviceClass == RemovableDevice;
+    }
+
+    /**
+     * Number of files which should be read concurrently from this file
+     * system: high for solid state devices, low for rotational, removable
+     * and network devices where parallel reads compete for a slow link or
+     * cause seeks
+     */
+    int recommendedConcurrency() const;
+};
+
+/**
+ * A cache of the mount table, shared by all threads.
+ *
+ * On Linux the table is parsed from /proc/self/mountinfo once, and parsed
+ * again when the kernel reports a change in it. Queries take a reference to
+ * an immutable snapshot and search it without holding any lock, so they can
+ * be made from loading and thumbnail threads for every file. Taking the
+ * reference is not lock-free: libstdc++ implements std::atomic_load() on a
+ * shared_ptr with a small pool of mutexes, held for the time of the reference
+ * count update.
+ */
+namespace MountTable
+{
+/**
+ * Returns the mount containing @p path, or an invalid MountInfo if there is
+ * none (for example in a chroot)
+ */
+GWENVIEWLIB_EXPORT MountInfo mountForPath(const QString &path);
+
+/**
+ * Returns the mount containing @p url, or an invalid MountInfo if @p url is
+ * not local
+ */
+GWENVIEWLIB_EXPORT MountInfo mountForUrl(const QUrl &url);
+
+/**
+ * Parses the content of /proc/self/mountinfo. The mounts are sorted so that
+ * findMount() finds the innermost mount first.
+ */
+GWENVIEWLIB_EXPORT QVector<MountInfo> parseMountInfo(const QByteArray &data);
+
+/**
+ * Returns the mount of @p mounts, as sorted by parseMountInfo(), which
+ * contains @p path
+ */
+GWENVIEWLIB_EXPORT MountInfo findMount(const QVector<MountInfo> &mounts, const QString &path);
+
+} // namespace
+
+} // namespace
+
+#endif /* MOUNTTABLE_H */
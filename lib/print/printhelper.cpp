@@ -31,16 +31,159 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include <QPrintDialog>
 #include <QPrintPreviewDialog>
 #include <QPrinter>
+#include <QSysInfo>
 #include <QUrl>
 
 // KF
 #include <KLocalizedString>
 
 // Local
+#include "gwenview_lib_debug.h"
+#include "gwenviewconfig.h"
+#include "imagescaling.h"
 #include "printoptionspage.h"
+#include <lib/cms/cmsprofile.h>
+
+// lcms
+#include <lcms2.h>
 
 namespace Gwenview
 {
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+/**
+ * Number of printed rows color managed and sent to the printer at once.
+ * Keeps the memory used by a band around 8 MB for a page printed at 600 dpi.
+ */
+static const int BAND_HEIGHT = 512;
+
+/**
+ * The lcms format matching QImage::Format_RGB32 and QImage::Format_ARGB32,
+ * which store pixels as native 32 bit integers
+ */
+static const cmsUInt32Number CMS_ARGB32_FORMAT = QSysInfo::ByteOrder == QSysInfo::LittleEndian ? TYPE_BGRA_8 : TYPE_ARGB_8;
+
+static bool isGrayProfile(const Cms::Profile::Ptr &profile)
+{
+    return profile && cmsGetColorSpace(profile->handle()) == cmsSigGrayData;
+}
+
+/**
+ * Converts bands from the profile of the document to sRGB, which is what
+ * print engines expect
+ */
+class PrintColorTransform
+{
+public:
+    PrintColorTransform(const Cms::Profile::Ptr &profile, QImage::Format format)
+    {
+        // Unmarked images are assumed to be sRGB already
+        if (!profile) {
+            return;
+        }
+        const Cms::Profile::Ptr sRgbProfile = Cms::Profile::getSRgbProfile();
+        if (!sRgbProfile) {
+            return;
+        }
+        cmsUInt32Number inputFormat = 0;
+        cmsUInt32Number outputFormat = 0;
+        switch (format) {
+        case QImage::Format_RGB32:
+        case QImage::Format_ARGB32:
+            inputFormat = outputFormat = CMS_ARGB32_FORMAT;
+            break;
+        case QImage::Format_RGBA64:
+        case QImage::Format_RGBX64:
+            inputFormat = outputFormat = TYPE_RGBA_16;
+            break;
+        // Gray bands only come with gray profiles, see bandFormat(). They
+        // are transformed into new RGB images.
+        case QImage::Format_Grayscale8:
+            inputFormat = TYPE_GRAY_8;
+            outputFormat = CMS_ARGB32_FORMAT;
+            mOutputFormat = QImage::Format_RGB32;
+            break;
+        case QImage::Format_Grayscale16:
+            inputFormat = TYPE_GRAY_16;
+            outputFormat = TYPE_RGBA_16;
+            mOutputFormat = QImage::Format_RGBX64;
+            break;
+        default:
+            qCWarning(GWENVIEW_LIB_LOG) << "Cannot apply color profile on" << format << "images when printing";
+            return;
+        }
+        mTransform = cmsCreateTransform(profile->handle(),
+                                        inputFormat,
+                                        sRgbProfile->handle(),
+                                        outputFormat,
+                                        GwenviewConfig::renderingIntent(),
+                                        cmsFLAGS_BLACKPOINTCOMPENSATION);
+    }
+
+    ~PrintColorTransform()
+    {
+        if (mTransform) {
+            cmsDeleteTransform(mTransform);
+        }
+    }
+
+    void apply(QImage *image) const
+    {
+        if (!mTransform) {
+            return;
+        }
+        if (mOutputFormat == QImage::Format_Invalid) {
+            // Rows may be padded, transform them one by one
+            for (int y = 0; y < image->height(); ++y) {
+                uchar *line = image->scanLine(y);
+                cmsDoTransform(mTransform, line, line, image->width());
+            }
+            return;
+        }
+        QImage output(image->size(), mOutputFormat);
+        // The transform does not write the padding channel
+        output.fill(Qt::white);
+        for (int y = 0; y < image->height(); ++y) {
+            cmsDoTransform(mTransform, image->constScanLine(y), output.scanLine(y), image->width());
+        }
+        *image = output;
+    }
+
+private:
+    Q_DISABLE_COPY(PrintColorTransform)
+    cmsHTRANSFORM mTransform = nullptr;
+    // Set when the transform does not work in place
+    QImage::Format mOutputFormat = QImage::Format_Invalid;
+};
+
+/**
+ * Returns the format bands are converted to before being color managed: the
+ * color engine does not support premultiplied formats, and gray images can
+ * only be transformed as gray with a gray profile
+ */
+static QImage::Format bandFormat(QImage::Format scaledFormat, const Cms::Profile::Ptr &profile)
+{
+    switch (scaledFormat) {
+    case QImage::Format_ARGB32_Premultiplied:
+        return QImage::Format_ARGB32;
+    case QImage::Format_RGBA64_Premultiplied:
+        return QImage::Format_RGBA64;
+    case QImage::Format_Grayscale8:
+        return isGrayProfile(profile) ? scaledFormat : QImage::Format_RGB32;
+    case QImage::Format_Grayscale16:
+        return isGrayProfile(profile) ? scaledFormat : QImage::Format_RGBX64;
+    default:
+        return scaledFormat;
+    }
+}
+
 struct PrintHelperPrivate {
     QWidget *mParent = nullptr;
 
@@ -141,9 +284,73 @@ struct PrintHelperPrivate {
             delete optionsPage;
         }
 
-        const QImage image = doc->image();
-        painter.setWindow(image.rect());
-        painter.drawImage(0, 0, image);
+        printImage(&painter, doc, size);
+    }
+
+    /**
+     * Returns the smallest image of the document which has at least
+     * @p size pixels, reusing the down sampled images which are ready
+     */
+    QImage sourceImage(Document::Ptr doc, const QSize &size)
+    {
+        const QSize docSize = doc->size();
+        const qreal zoom = qMax(qreal(size.width()) / docSize.width(), qreal(size.height()) / docSize.height());
+        if (zoom < Document::maxDownSampledZoom()) {
+            const QImage image = doc->downSampledImageForZoom(zoom);
+            if (!image.isNull()) {
+                return image;
+            }
+        }
+        return doc->image();
+    }
+
+    /**
+     * Resamples the image once to @p printSize, the size in printer pixels
+     * computed by adjustSize(), then color manages it and sends it to the
+     * printer in bands of BAND_HEIGHT rows: the printer does not have to
+     * hold a full page rasterized at printer resolution.
+     *
+     * Images smaller than the printed size are sent at their own resolution
+     * and enlarged by the print engine, which is cheaper than sending more
+     * pixels which carry no more detail. The resampled image is thus never
+     * larger than the document image.
+     */
+    void printImage(QPainter *painter, Document::Ptr doc, const QSize &printSize)
+    {
+        if (printSize.isEmpty()) {
+            return;
+        }
+        const QImage source = sourceImage(doc, printSize);
+        if (source.isNull()) {
+            return;
+        }
+        const QSize docSize = doc->size();
+        QSize outputSize = printSize;
+        if (printSize.width() > docSize.width() || printSize.height() > docSize.height()) {
+            outputSize = docSize.scaled(printSize, Qt::KeepAspectRatio);
+        }
+        const int outputWidth = outputSize.width();
+        const int outputHeight = outputSize.height();
+        painter->setWindow(0, 0, outputWidth, outputHeight);
+
+        QImage output = source;
+        if (source.size() != outputSize) {
+            const ImageScaling::Filter filter = ImageScaling::filterForTransformationMode(Qt::SmoothTransformation, source.size(), outputSize);
+            output = ImageScaling::scaled(source, outputSize, filter);
+        }
+
+        const Cms::Profile::Ptr profile = doc->cmsProfile();
+        const QImage::Format format = bandFormat(output.format(), profile);
+        const PrintColorTransform transform(profile, format);
+        LOG("Printing" << source.size() << "image as" << outputSize << "in bands of" << BAND_HEIGHT << "rows");
+
+        for (int top = 0; top < outputHeight; top += BAND_HEIGHT) {
+            const int height = qMin(BAND_HEIGHT, outputHeight - top);
+            QImage band = output.copy(0, top, outputWidth, height);
+            band.convertTo(format);
+            transform.apply(&band);
+            painter->drawImage(0, top, band);
+        }
     }
 };
 
@@ -26,7 +26,6 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 
 // Qt
 #include <QImage>
-#include <QPainter>
 
 // KF
 #include <KLocalizedString>
@@ -35,6 +34,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "document/abstractdocumenteditor.h"
 #include "document/document.h"
 #include "document/documentjob.h"
+#include "document/tiledimage.h"
 #include "gwenview_lib_debug.h"
 #include "paintutils.h"
 #include "ramp.h"
@@ -44,8 +44,9 @@ namespace Gwenview
 class RedEyeReductionJob : public ThreadedDocumentJob
 {
 public:
-    RedEyeReductionJob(const QRectF &rectF)
+    RedEyeReductionJob(const QRectF &rectF, TiledImage *tiles)
         : mRectF(rectF)
+        , mTiles(tiles)
     {
     }
 
@@ -54,19 +55,27 @@ public:
         if (!checkDocumentEditor()) {
             return;
         }
-        QImage img = document()->image();
-        RedEyeReductionImageOperation::apply(&img, mRectF);
-        document()->editor()->setImage(img);
+        // Only work on the tiles covered by the rect, the rest of the image
+        // is neither copied nor touched
+        *mTiles = TiledImage(document()->image(), mRectF.toAlignedRect());
+        QImage img = mTiles->toImage();
+        RedEyeReductionImageOperation::apply(&img, mRectF.translated(-mTiles->boundingRect().topLeft()));
+        mTiles->setImage(img);
+        // The edited tiles are swapped into the document image by
+        // RedEyeReductionImageOperation::redo(), on the GUI thread
         setError(NoError);
     }
 
 private:
     QRectF mRectF;
+    TiledImage *mTiles;
 };
 
 struct RedEyeReductionImageOperationPrivate {
     QRectF mRectF;
-    QImage mOriginalImage;
+    // The pixels which are not in the document: the original ones after
+    // redo(), the edited ones after undo()
+    TiledImage mTiles;
 };
 
 RedEyeReductionImageOperation::RedEyeReductionImageOperation(const QRectF &rectF)
@@ -83,10 +92,22 @@ RedEyeReductionImageOperation::~RedEyeReductionImageOperation()
 
 void RedEyeReductionImageOperation::redo()
 {
-    const QImage img = document()->image();
-    const QRect rect = d->mRectF.toAlignedRect();
-    d->mOriginalImage = img.copy(rect);
-    redoAsDocumentJob(new RedEyeReductionJob(d->mRectF));
+    if (!d->mTiles.isEmpty() && document()->editor()) {
+        // Redo after undo: the edited tiles are still around
+        document()->editor()->swapImageTiles(&d->mTiles);
+        finish(true);
+        return;
+    }
+    auto job = new RedEyeReductionJob(d->mRectF, &d->mTiles);
+    // Connected before redoAsDocumentJob() so that the image is updated
+    // before the operation is finished
+    connect(job, &KJob::result, this, [this](KJob *job) {
+        if (job->error() == KJob::NoError && document()->editor()) {
+            // After the swap, mTiles contains the original pixels, ready for undo
+            document()->editor()->swapImageTiles(&d->mTiles);
+        }
+    });
+    redoAsDocumentJob(job);
 }
 
 void RedEyeReductionImageOperation::undo()
@@ -95,14 +116,7 @@ void RedEyeReductionImageOperation::undo()
         qCWarning(GWENVIEW_LIB_LOG) << "!document->editor()";
         return;
     }
-    QImage img = document()->image();
-    {
-        QPainter painter(&img);
-        painter.setCompositionMode(QPainter::CompositionMode_Source);
-        const QRect rect = d->mRectF.toAlignedRect();
-        painter.drawImage(rect.topLeft(), d->mOriginalImage);
-    }
-    document()->editor()->setImage(img);
+    document()->editor()->swapImageTiles(&d->mTiles);
     finish(true);
 }
 
@@ -35,6 +35,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Local
 #include <lib/gwenviewconfig.h>
+#include <lib/imagescaling.h>
 #include <ui_resizeimagewidget.h>
 
 namespace Gwenview
@@ -236,7 +237,7 @@ qint64 ResizeImageDialog::calculateEstimatedImageSize()
         QString suffix = fileInfo.suffix();
 
         buffer.open(QIODevice::ReadWrite);
-        image = image.scaled(size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        image = ImageScaling::scaled(image, size(), ImageScaling::Lanczos3);
 
         if (QString::compare(suffix, QStringLiteral("jpg"), Qt::CaseInsensitive) == 0
             || QString::compare(suffix, QStringLiteral("jpeg"), Qt::CaseInsensitive) == 0
@@ -32,6 +32,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
 #include "document/document.h"
 #include "document/documentjob.h"
 #include "gwenview_lib_debug.h"
+#include "imagescaling.h"
 
 namespace Gwenview
 {
@@ -54,7 +55,7 @@ public:
             return;
         }
         QImage image = document()->image();
-        image = image.scaled(mSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        image = ImageScaling::scaled(image, mSize, ImageScaling::Lanczos3);
         document()->editor()->setImage(image);
         setError(NoError);
     }
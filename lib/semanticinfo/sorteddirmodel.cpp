@@ -32,6 +32,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "gwenview_lib_debug.h"
 #include <lib/archiveutils.h>
 #include <lib/timeutils.h>
+#include <lib/urllistdirlister.h>
 #ifndef GWENVIEW_SEMANTICINFO_BACKEND_NONE
 #include "abstractsemanticinfobackend.h"
 #include "semanticinfodirmodel.h"
@@ -66,6 +67,14 @@ struct SortedDirModelPrivate {
     QList<AbstractSortedDirModelFilter *> mFilters;
     QTimer mDelayedApplyFiltersTimer;
     MimeTypeUtils::Kinds mKindFilter;
+    // Number of items of the source model, as reported to TimeUtils
+    int mListedItemCount = 0;
+
+    void updateListedItemCount(int delta)
+    {
+        mListedItemCount += delta;
+        TimeUtils::updateListedItemCount(delta);
+    }
 };
 
 SortedDirModel::SortedDirModel(QObject *parent)
@@ -77,6 +86,7 @@ SortedDirModel::SortedDirModel(QObject *parent)
 #else
     d->mSourceModel = new SemanticInfoDirModel(this);
 #endif
+    d->mSourceModel->setDirLister(new UrlListDirLister(d->mSourceModel));
     setSourceModel(d->mSourceModel);
 
     d->mSourceModel->dirLister()->setRequestMimeTypeWhileListing(true);
@@ -84,10 +94,24 @@ SortedDirModel::SortedDirModel(QObject *parent)
     d->mDelayedApplyFiltersTimer.setInterval(0);
     d->mDelayedApplyFiltersTimer.setSingleShot(true);
     connect(&d->mDelayedApplyFiltersTimer, &QTimer::timeout, this, &SortedDirModel::doApplyFilters);
+
+    // Lets the date cache hold the dates of all the listed items. Counted
+    // before the rows are inserted, because sorting them may need the dates.
+    connect(d->mSourceModel, &QAbstractItemModel::rowsAboutToBeInserted, this, [this](const QModelIndex &, int first, int last) {
+        d->updateListedItemCount(last - first + 1);
+    });
+    connect(d->mSourceModel, &QAbstractItemModel::rowsAboutToBeRemoved, this, [this](const QModelIndex &, int first, int last) {
+        d->updateListedItemCount(-(last - first + 1));
+    });
+    connect(d->mSourceModel, &QAbstractItemModel::modelAboutToBeReset, this, [this] {
+        d->updateListedItemCount(-d->mListedItemCount);
+    });
 }
 
 SortedDirModel::~SortedDirModel()
 {
+    d->mSourceModel->disconnect(this);
+    TimeUtils::updateListedItemCount(-d->mListedItemCount);
     delete d;
 }
 
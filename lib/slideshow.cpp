@@ -25,6 +25,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 // Qt
 #include <QAction>
+#include <QHash>
 #include <QTimer>
 
 // KF
@@ -74,13 +75,18 @@ private:
 };
 
 struct SlideShowPrivate {
+    SlideShow *q = nullptr;
     QTimer *mTimer = nullptr;
     State mState;
     QVector<QUrl> mUrls;
+    // Position of each url in mUrls
+    QHash<QUrl, int> mUrlIndexes;
+    // Urls still to show in random mode, the next one is the last one. May
+    // contain the following rounds when looping.
     QVector<QUrl> mShuffledUrls;
-    QVector<QUrl>::ConstIterator mStartIt;
+    int mStartIndex = -1;
     QUrl mCurrentUrl;
-    QUrl mLastShuffledUrl;
+    RandomNumberGenerator mRandomNumberGenerator;
 
     QAction *mLoopAction = nullptr;
     QAction *mRandomAction = nullptr;
@@ -90,57 +96,76 @@ struct SlideShowPrivate {
         if (GwenviewConfig::random()) {
             return findNextRandomUrl();
         } else {
-            return findNextOrderedUrl();
+            const int index = mUrlIndexes.value(mCurrentUrl, -1);
+            GV_RETURN_VALUE_IF_FAIL2(index != -1, QUrl(), "Current url not found in list.");
+            return orderedUrlAfter(index);
         }
     }
 
-    QUrl findNextOrderedUrl()
+    /**
+     * Returns the url following the one at @p index, or an invalid url if
+     * the slideshow ends there
+     */
+    QUrl orderedUrlAfter(int index) const
     {
-        QVector<QUrl>::ConstIterator it = std::find(mUrls.constBegin(), mUrls.constEnd(), mCurrentUrl);
-        GV_RETURN_VALUE_IF_FAIL2(it != mUrls.constEnd(), QUrl(), "Current url not found in list.");
-
-        ++it;
+        ++index;
         if (GwenviewConfig::loop()) {
             // Looping, if we reach the end, start again
-            if (it == mUrls.constEnd()) {
-                it = mUrls.constBegin();
+            if (index == mUrls.count()) {
+                index = 0;
             }
         } else {
             // Not looping, have we reached the end?
             // FIXME: stopAtEnd
-            if (/*(it==mUrls.end() && GwenviewConfig::stopAtEnd()) ||*/ it == mStartIt) {
-                it = mUrls.constEnd();
+            if (/*(index == mUrls.count() && GwenviewConfig::stopAtEnd()) ||*/ index == mStartIndex) {
+                index = mUrls.count();
             }
         }
 
-        if (it != mUrls.constEnd()) {
-            return *it;
+        if (index < mUrls.count()) {
+            return mUrls.at(index);
         } else {
             return {};
         }
     }
 
+    /**
+     * Returns the urls of mUrls in random order. @p previousUrl is the url
+     * shown before this round: make sure it is not the first one of the
+     * round, so that it does not stay visible twice longer than usual.
+     */
+    QVector<QUrl> createShuffledRound(const QUrl &previousUrl)
+    {
+        QVector<QUrl> urls = mUrls;
+        std::random_shuffle(urls.begin(), urls.end(), mRandomNumberGenerator);
+        if (urls.count() > 1 && urls.last() == previousUrl) {
+            qSwap(urls.first(), urls.last());
+        }
+        return urls;
+    }
+
     void initShuffledUrls()
     {
-        mShuffledUrls = mUrls;
-        RandomNumberGenerator generator;
-        std::random_shuffle(mShuffledUrls.begin(), mShuffledUrls.end(), generator);
-        // Ensure the first url is different from the previous last one, so that
-        // last url does not stay visible twice longer than usual
-        if (mLastShuffledUrl == mShuffledUrls.first() && mShuffledUrls.count() > 1) {
-            qSwap(mShuffledUrls[0], mShuffledUrls[1]);
+        mShuffledUrls = createShuffledRound(mCurrentUrl);
+    }
+
+    /**
+     * When looping, shuffles the next rounds ahead of time so that at least
+     * @p count urls are known
+     */
+    void planShuffledUrls(int count)
+    {
+        while (mShuffledUrls.count() < count && GwenviewConfig::loop() && !mUrls.isEmpty()) {
+            const QUrl previousUrl = mShuffledUrls.isEmpty() ? mCurrentUrl : mShuffledUrls.first();
+            mShuffledUrls = createShuffledRound(previousUrl) + mShuffledUrls;
         }
-        mLastShuffledUrl = mShuffledUrls.last();
     }
 
     QUrl findNextRandomUrl()
     {
+        planShuffledUrls(1);
         if (mShuffledUrls.empty()) {
-            if (GwenviewConfig::loop()) {
-                initShuffledUrls();
-            } else {
-                return {};
-            }
+            return {};
         }
 
         const QUrl url = mShuffledUrls.last();
@@ -166,6 +191,7 @@ struct SlideShowPrivate {
             mTimer->start();
             mState = Started;
         }
+        Q_EMIT q->scheduleChanged();
     }
 };
 
@@ -173,6 +199,7 @@ SlideShow::SlideShow(QObject *parent)
     : QObject(parent)
     , d(new SlideShowPrivate)
 {
+    d->q = this;
     d->mState = Paused;
 
     d->mTimer = new QTimer(this);
@@ -213,9 +240,14 @@ void SlideShow::start(const QList<QUrl> &urls)
 {
     d->mUrls.resize(urls.size());
     std::copy(urls.begin(), urls.end(), d->mUrls.begin());
+    d->mUrlIndexes.clear();
+    d->mUrlIndexes.reserve(d->mUrls.count());
+    for (int i = 0; i < d->mUrls.count(); ++i) {
+        d->mUrlIndexes.insert(d->mUrls.at(i), i);
+    }
 
-    d->mStartIt = std::find(d->mUrls.constBegin(), d->mUrls.constEnd(), d->mCurrentUrl);
-    if (d->mStartIt == d->mUrls.constEnd()) {
+    d->mStartIndex = d->mUrlIndexes.value(d->mCurrentUrl, -1);
+    if (d->mStartIndex == -1) {
         qCWarning(GWENVIEW_LIB_LOG) << "Current url not found in list, aborting.\n";
         return;
     }
@@ -235,6 +267,7 @@ void SlideShow::setInterval(int intervalInSeconds)
     GwenviewConfig::setInterval(double(intervalInSeconds));
     d->updateTimerInterval();
     Q_EMIT intervalChanged(intervalInSeconds);
+    Q_EMIT scheduleChanged();
 }
 
 int SlideShow::interval() const
@@ -242,6 +275,47 @@ int SlideShow::interval() const
     return GwenviewConfig::interval();
 }
 
+QUrl SlideShow::currentUrl() const
+{
+    return d->mCurrentUrl;
+}
+
+int SlideShow::remainingTime() const
+{
+    if (d->mState == Started && d->mTimer->isActive()) {
+        return d->mTimer->remainingTime();
+    }
+    return -1;
+}
+
+QList<QUrl> SlideShow::upcomingUrls(int count) const
+{
+    QList<QUrl> urls;
+    if (GwenviewConfig::random()) {
+        d->planShuffledUrls(count);
+        for (int i = d->mShuffledUrls.count() - 1; i >= 0 && urls.count() < count; --i) {
+            const QUrl &url = d->mShuffledUrls.at(i);
+            if (urls.contains(url)) {
+                // Short list, we went around it
+                break;
+            }
+            urls << url;
+        }
+        return urls;
+    }
+
+    int index = d->mUrlIndexes.value(d->mCurrentUrl, -1);
+    while (index != -1 && urls.count() < count) {
+        const QUrl url = d->orderedUrlAfter(index);
+        if (!url.isValid() || url == d->mCurrentUrl || urls.contains(url)) {
+            break;
+        }
+        urls << url;
+        index = d->mUrlIndexes.value(url, -1);
+    }
+    return urls;
+}
+
 int SlideShow::position() const
 {
     // TODO: also support videos
@@ -266,6 +340,7 @@ void SlideShow::pause()
     d->mTimer->stop();
     d->mState = Paused;
     Q_EMIT stateChanged(false);
+    Q_EMIT scheduleChanged();
 }
 
 void SlideShow::resumeAndGoToNextUrl()
@@ -318,6 +393,7 @@ void SlideShow::slotRandomActionToggled(bool on)
     if (on && d->mState != Paused) {
         d->initShuffledUrls();
     }
+    Q_EMIT scheduleChanged();
 }
 
 } // namespace
@@ -66,6 +66,20 @@ public:
      */
     int position() const;
 
+    QUrl currentUrl() const;
+
+    /**
+     * @return time left in milliseconds before going to the next url, or -1
+     * if it is not known (paused, or waiting for the end of a video)
+     */
+    int remainingTime() const;
+
+    /**
+     * @return the next @p count urls the slideshow will show, in order. Fewer
+     * urls are returned when the slideshow ends before.
+     */
+    QList<QUrl> upcomingUrls(int count) const;
+
 public Q_SLOTS:
     void setInterval(int);
     void setCurrentUrl(const QUrl &url);
@@ -87,6 +101,12 @@ Q_SIGNALS:
      */
     void intervalChanged(int interval);
 
+    /**
+     * Emitted when the timer has been restarted, or something changed what
+     * upcomingUrls() or remainingTime() return
+     */
+    void scheduleChanged();
+
 private Q_SLOTS:
     void goToNextUrl();
     void updateConfig();
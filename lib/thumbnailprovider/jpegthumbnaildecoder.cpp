@@ -0,0 +1,422 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "jpegthumbnaildecoder.h"
+
+// System
+#include <cstdio>
+#include <cstring>
+
+// Qt
+#include <QFile>
+#include <QtEndian>
+
+// Local
+#include "gwenview_lib_debug.h"
+#include "gwenviewconfig.h"
+#include "imageutils.h"
+#include "iodevicejpegsourcemanager.h"
+#include "jpegerrormanager.h"
+#include "orientation.h"
+
+namespace Gwenview
+{
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+static const int EXIF_HEADER_SIZE = 6;
+
+/**
+ * Minimal reader for the TIFF structure of an APP1 Exif marker. We only need
+ * the orientation and the location of the embedded thumbnail, so there is no
+ * point in handing the whole file to Exiv2 for that.
+ */
+class ExifReader
+{
+public:
+    ExifReader(const uchar *data, int size)
+        : mData(data)
+        , mSize(size)
+    {
+    }
+
+    bool parse()
+    {
+        if (mSize < 8) {
+            return false;
+        }
+        if (mData[0] == 'I' && mData[1] == 'I') {
+            mBigEndian = false;
+        } else if (mData[0] == 'M' && mData[1] == 'M') {
+            mBigEndian = true;
+        } else {
+            return false;
+        }
+        if (readShort(2) != 42) {
+            return false;
+        }
+
+        const quint32 ifd0 = readLong(4);
+        const quint32 ifd1 = readIfd(ifd0);
+        if (ifd1 != 0) {
+            readIfd(ifd1);
+        }
+        return true;
+    }
+
+    Orientation orientation() const
+    {
+        return mOrientation;
+    }
+
+    QByteArray thumbnail() const
+    {
+        if (mThumbnailLength == 0 || !isInRange(mThumbnailOffset, mThumbnailLength)) {
+            return QByteArray();
+        }
+        return QByteArray(reinterpret_cast<const char *>(mData + mThumbnailOffset), mThumbnailLength);
+    }
+
+private:
+    const uchar *mData;
+    const int mSize;
+    bool mBigEndian = false;
+    Orientation mOrientation = NOT_AVAILABLE;
+    quint32 mThumbnailOffset = 0;
+    quint32 mThumbnailLength = 0;
+
+    bool isInRange(quint32 offset, quint32 length) const
+    {
+        return offset <= quint32(mSize) && length <= quint32(mSize) - offset;
+    }
+
+    quint16 readShort(quint32 offset) const
+    {
+        if (!isInRange(offset, 2)) {
+            return 0;
+        }
+        return mBigEndian ? qFromBigEndian<quint16>(mData + offset) : qFromLittleEndian<quint16>(mData + offset);
+    }
+
+    quint32 readLong(quint32 offset) const
+    {
+        if (!isInRange(offset, 4)) {
+            return 0;
+        }
+        return mBigEndian ? qFromBigEndian<quint32>(mData + offset) : qFromLittleEndian<quint32>(mData + offset);
+    }
+
+    // Reads the entries we care about and returns the offset of the next IFD
+    quint32 readIfd(quint32 offset)
+    {
+        const quint16 count = readShort(offset);
+        if (!isInRange(offset + 2, count * 12 + 4)) {
+            return 0;
+        }
+        for (int idx = 0; idx < count; ++idx) {
+            const quint32 entry = offset + 2 + idx * 12;
+            switch (readShort(entry)) {
+            case 0x0112: { // Orientation
+                const quint16 value = readShort(entry + 8);
+                if (value >= NORMAL && value <= ROT_270) {
+                    mOrientation = Orientation(value);
+                }
+                break;
+            }
+            case 0x0201: // JPEGInterchangeFormat
+                mThumbnailOffset = readLong(entry + 8);
+                break;
+            case 0x0202: // JPEGInterchangeFormatLength
+                mThumbnailLength = readLong(entry + 8);
+                break;
+            default:
+                break;
+            }
+        }
+        const quint32 next = readLong(offset + 2 + count * 12);
+        // Guard against loops
+        return next > offset ? next : 0;
+    }
+};
+
+static bool isTransposed(Orientation orientation)
+{
+    return orientation == TRANSPOSE || orientation == ROT_90 || orientation == TRANSVERSE || orientation == ROT_270;
+}
+
+/**
+ * Area-averages @p src (which must be RGB32 or ARGB32_Premultiplied) down to
+ * @p dstSize while applying @p orientation. @p dstSize is expressed in the
+ * oriented coordinate system.
+ *
+ * Each destination pixel is mapped back to an axis-aligned box of source
+ * pixels, flips and transpositions only change how the box is computed, so
+ * the orientation comes for free.
+ */
+static QImage resampleOriented(const QImage &src, const QSize &dstSize, Orientation orientation)
+{
+    const bool transposed = isTransposed(orientation);
+    const bool flipSrcX = orientation == HFLIP || orientation == ROT_180 || orientation == TRANSVERSE || orientation == ROT_270;
+    const bool flipSrcY = orientation == ROT_180 || orientation == VFLIP || orientation == ROT_90 || orientation == TRANSVERSE;
+
+    const int srcWidth = src.width();
+    const int srcHeight = src.height();
+    const int orientedWidth = transposed ? srcHeight : srcWidth;
+    const int orientedHeight = transposed ? srcWidth : srcHeight;
+    const int dstWidth = dstSize.width();
+    const int dstHeight = dstSize.height();
+
+    QImage dst(dstSize, src.format());
+    for (int dy = 0; dy < dstHeight; ++dy) {
+        const int oy0 = dy * orientedHeight / dstHeight;
+        const int oy1 = qMax(oy0 + 1, (dy + 1) * orientedHeight / dstHeight);
+        auto *out = reinterpret_cast<QRgb *>(dst.scanLine(dy));
+
+        for (int dx = 0; dx < dstWidth; ++dx) {
+            const int ox0 = dx * orientedWidth / dstWidth;
+            const int ox1 = qMax(ox0 + 1, (dx + 1) * orientedWidth / dstWidth);
+
+            int sx0 = transposed ? oy0 : ox0;
+            int sx1 = transposed ? oy1 : ox1;
+            int sy0 = transposed ? ox0 : oy0;
+            int sy1 = transposed ? ox1 : oy1;
+            if (flipSrcX) {
+                const int tmp = srcWidth - sx1;
+                sx1 = srcWidth - sx0;
+                sx0 = tmp;
+            }
+            if (flipSrcY) {
+                const int tmp = srcHeight - sy1;
+                sy1 = srcHeight - sy0;
+                sy0 = tmp;
+            }
+
+            quint32 a = 0, r = 0, g = 0, b = 0;
+            for (int sy = sy0; sy < sy1; ++sy) {
+                const auto *line = reinterpret_cast<const QRgb *>(src.constScanLine(sy));
+                for (int sx = sx0; sx < sx1; ++sx) {
+                    const QRgb pixel = line[sx];
+                    a += qAlpha(pixel);
+                    r += qRed(pixel);
+                    g += qGreen(pixel);
+                    b += qBlue(pixel);
+                }
+            }
+            const quint32 count = (sx1 - sx0) * (sy1 - sy0);
+            const quint32 half = count / 2;
+            out[dx] = qRgba((r + half) / count, (g + half) / count, (b + half) / count, (a + half) / count);
+        }
+    }
+    return dst;
+}
+
+struct JpegThumbnailDecoderPrivate {
+    jpeg_decompress_struct mCinfo;
+    JPEGErrorManager mErrorManager;
+    QFile mFile;
+    QImage mImage;
+    QSize mOriginalSize;
+
+    JpegThumbnailDecoderPrivate()
+    {
+        mCinfo.err = &mErrorManager;
+        jpeg_create_decompress(&mCinfo);
+    }
+
+    ~JpegThumbnailDecoderPrivate()
+    {
+        jpeg_destroy_decompress(&mCinfo);
+    }
+
+    // Returns the largest libjpeg scale denominator which still produces an
+    // image covering pixelSize. Only 1/1, 1/2, 1/4 and 1/8 are supported by
+    // all the libjpeg versions we build against.
+    int scaleDenominator(int pixelSize) const
+    {
+        const int maxSide = qMax(mCinfo.image_width, mCinfo.image_height);
+        int denom = 8;
+        while (denom > 1 && (maxSide + denom - 1) / denom < pixelSize) {
+            denom /= 2;
+        }
+        return denom;
+    }
+
+    bool decode(int pixelSize)
+    {
+        QImage::Format format;
+        switch (mCinfo.jpeg_color_space) {
+        case JCS_CMYK:
+        case JCS_YCCK:
+            // Leave Adobe inverted CMYK handling to QImageReader
+            return false;
+        case JCS_GRAYSCALE:
+            mCinfo.out_color_space = JCS_GRAYSCALE;
+            format = QImage::Format_Grayscale8;
+            break;
+        default:
+#ifdef JCS_EXTENSIONS
+            // libjpeg-turbo can write directly in the QImage memory layout
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+            mCinfo.out_color_space = JCS_EXT_BGRX;
+#else
+            mCinfo.out_color_space = JCS_EXT_XRGB;
+#endif
+            format = QImage::Format_RGB32;
+#else
+            mCinfo.out_color_space = JCS_RGB;
+            format = QImage::Format_RGB888;
+#endif
+            break;
+        }
+
+        mCinfo.scale_num = 1;
+        mCinfo.scale_denom = scaleDenominator(pixelSize);
+        mCinfo.dct_method = JDCT_IFAST;
+        mCinfo.do_fancy_upsampling = false;
+        LOG("Decoding at 1 /" << mCinfo.scale_denom);
+
+        jpeg_start_decompress(&mCinfo);
+        mImage = QImage(mCinfo.output_width, mCinfo.output_height, format);
+        if (mImage.isNull()) {
+            return false;
+        }
+        while (mCinfo.output_scanline < mCinfo.output_height) {
+            JSAMPROW row = mImage.scanLine(mCinfo.output_scanline);
+            jpeg_read_scanlines(&mCinfo, &row, 1);
+        }
+        jpeg_finish_decompress(&mCinfo);
+        return true;
+    }
+};
+
+JpegThumbnailDecoder::JpegThumbnailDecoder()
+    : d(new JpegThumbnailDecoderPrivate)
+{
+}
+
+JpegThumbnailDecoder::~JpegThumbnailDecoder()
+{
+    delete d;
+}
+
+bool JpegThumbnailDecoder::load(const QString &path, int pixelSize)
+{
+    d->mImage = QImage();
+    d->mOriginalSize = QSize();
+    d->mFile.close();
+    d->mFile.setFileName(path);
+    if (!d->mFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    jpeg_decompress_struct *cinfo = &d->mCinfo;
+    if (setjmp(d->mErrorManager.jmp_buffer)) {
+        qCWarning(GWENVIEW_LIB_LOG) << "libjpeg error while generating thumbnail for" << path;
+        jpeg_abort_decompress(cinfo);
+        d->mImage = QImage();
+        d->mFile.close();
+        return false;
+    }
+
+    IODeviceJpegSourceManager::setup(cinfo, &d->mFile);
+    jpeg_save_markers(cinfo, JPEG_APP0 + 1, 0xffff);
+    if (jpeg_read_header(cinfo, true) != JPEG_HEADER_OK) {
+        jpeg_abort_decompress(cinfo);
+        d->mFile.close();
+        return false;
+    }
+
+    Orientation orientation = NOT_AVAILABLE;
+    QByteArray thumbnailData;
+    for (jpeg_saved_marker_ptr marker = cinfo->marker_list; marker; marker = marker->next) {
+        if (marker->marker != JPEG_APP0 + 1 || marker->data_length <= EXIF_HEADER_SIZE || memcmp(marker->data, "Exif\0\0", EXIF_HEADER_SIZE) != 0) {
+            continue;
+        }
+        ExifReader reader(marker->data + EXIF_HEADER_SIZE, marker->data_length - EXIF_HEADER_SIZE);
+        if (reader.parse()) {
+            orientation = reader.orientation();
+            thumbnailData = reader.thumbnail();
+        }
+        break;
+    }
+    if (!GwenviewConfig::applyExifOrientation()) {
+        orientation = NORMAL;
+    }
+
+    const QSize storedSize(cinfo->image_width, cinfo->image_height);
+    d->mOriginalSize = isTransposed(orientation) ? storedSize.transposed() : storedSize;
+
+    // Use the embedded thumbnail if it is good enough, with the same rules as
+    // ThumbnailContext::load()
+    if (!thumbnailData.isEmpty()) {
+        const QImage thumbnail = QImage::fromData(thumbnailData, "JPEG");
+        if (ImageUtils::haveSameAspectRatio(thumbnail.size(), storedSize)
+            && (GwenviewConfig::lowResourceUsageMode() || qMax(thumbnail.width(), thumbnail.height()) >= pixelSize)) {
+            LOG("Using embedded thumbnail");
+            jpeg_abort_decompress(cinfo);
+            d->mFile.close();
+            const QImage rgbThumbnail = thumbnail.convertToFormat(QImage::Format_RGB32);
+            const QSize size = isTransposed(orientation) ? rgbThumbnail.size().transposed() : rgbThumbnail.size();
+            d->mImage = resampleOriented(rgbThumbnail, size, orientation);
+            return true;
+        }
+    }
+
+    if (!d->decode(pixelSize)) {
+        jpeg_abort_decompress(cinfo);
+        d->mImage = QImage();
+        d->mFile.close();
+        return false;
+    }
+    d->mFile.close();
+
+    // Final resample: scale down to pixelSize and apply the orientation in a
+    // single pass
+    if (d->mImage.format() != QImage::Format_RGB32) {
+        d->mImage = d->mImage.convertToFormat(QImage::Format_RGB32);
+    }
+    QSize size = isTransposed(orientation) ? d->mImage.size().transposed() : d->mImage.size();
+    if (qMax(size.width(), size.height()) > pixelSize) {
+        size.scale(pixelSize, pixelSize, Qt::KeepAspectRatio);
+    }
+    if (size != d->mImage.size() || (orientation != NORMAL && orientation != NOT_AVAILABLE)) {
+        d->mImage = resampleOriented(d->mImage, size.expandedTo(QSize(1, 1)), orientation);
+    }
+    return true;
+}
+
+QImage JpegThumbnailDecoder::image() const
+{
+    return d->mImage;
+}
+
+QSize JpegThumbnailDecoder::originalSize() const
+{
+    return d->mOriginalSize;
+}
+
+} // namespace
@@ -0,0 +1,74 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef JPEGTHUMBNAILDECODER_H
+#define JPEGTHUMBNAILDECODER_H
+
+// Local
+
+// KF
+
+// Qt
+#include <QImage>
+
+namespace Gwenview
+{
+struct JpegThumbnailDecoderPrivate;
+
+/**
+ * Fast path to generate thumbnails from JPEG files.
+ *
+ * The file header is parsed only once: the Exif orientation and the embedded
+ * thumbnail are read from the APP1 marker saved by libjpeg, then the image is
+ * decoded with the largest DCT scale factor which still covers the requested
+ * size, straight into the QImage. The orientation is applied while doing the
+ * final resample.
+ *
+ * The libjpeg decompressor is kept between calls, so each thumbnail thread
+ * should use its own instance.
+ */
+class JpegThumbnailDecoder
+{
+public:
+    JpegThumbnailDecoder();
+    ~JpegThumbnailDecoder();
+
+    /**
+     * Decodes @p path so that it fits in a @p pixelSize square. Returns false
+     * if this path cannot handle the file, in which case the caller should
+     * fall back to QImageReader.
+     */
+    bool load(const QString &path, int pixelSize);
+
+    QImage image() const;
+
+    /**
+     * The size of the full image, with the Exif orientation applied
+     */
+    QSize originalSize() const;
+
+private:
+    JpegThumbnailDecoderPrivate *const d;
+    Q_DISABLE_COPY(JpegThumbnailDecoder)
+};
+
+} // namespace
+
+#endif /* JPEGTHUMBNAILDECODER_H */
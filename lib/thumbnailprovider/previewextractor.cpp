@@ -0,0 +1,140 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "previewextractor.h"
+
+// Exiv2
+#include <exiv2/exiv2.hpp>
+
+// KDCRAW
+#ifdef KDCRAW_FOUND
+#include <KDCRAW/KDcraw>
+#endif
+
+// Qt
+
+// Local
+#include "exiv2imageloader.h"
+#include "gwenview_lib_debug.h"
+#include "imageutils.h"
+
+namespace Gwenview
+{
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+bool PreviewExtractor::isPreviewFormat(const QByteArray &formatHint)
+{
+    if (formatHint == "heic" || formatHint == "heif" || formatHint == "avif") {
+        return true;
+    }
+#ifdef KDCRAW_FOUND
+    return KDcrawIface::KDcraw::rawFilesList().contains(QString::fromLatin1(formatHint));
+#else
+    return false;
+#endif
+}
+
+bool PreviewExtractor::load(const QString &path, int pixelSize, bool acceptSmaller)
+{
+    mData.clear();
+    mPreviewSize = QSize();
+    mImageSize = QSize();
+    mOrientation = NOT_AVAILABLE;
+
+    Exiv2ImageLoader loader;
+    if (!loader.load(path)) {
+        LOG("Could not load" << path << ":" << loader.errorMessage());
+        return false;
+    }
+    std::unique_ptr<Exiv2::Image> image = loader.popImage();
+
+    try {
+        const Exiv2::ExifData &exifData = image->exifData();
+        auto it = exifData.findKey(Exiv2::ExifKey("Exif.Image.Orientation"));
+        if (it != exifData.end() && it->count() > 0 && it->typeId() == Exiv2::unsignedShort) {
+            const long value = it->toLong();
+            if (value >= NORMAL && value <= ROT_270) {
+                mOrientation = Orientation(value);
+            }
+        }
+        if (image->pixelWidth() > 0 && image->pixelHeight() > 0) {
+            mImageSize = QSize(image->pixelWidth(), image->pixelHeight());
+        }
+
+        // The list is sorted by size, smallest first
+        Exiv2::PreviewManager manager(*image);
+        const Exiv2::PreviewPropertiesList list = manager.getPreviewProperties();
+        const Exiv2::PreviewProperties *chosen = nullptr;
+        for (const Exiv2::PreviewProperties &properties : list) {
+            const QSize size(properties.width_, properties.height_);
+            if (size.isEmpty() || (mImageSize.isValid() && !ImageUtils::haveSameAspectRatio(size, mImageSize))) {
+                continue;
+            }
+            chosen = &properties;
+            if (qMax(size.width(), size.height()) >= pixelSize) {
+                break;
+            }
+        }
+        if (!chosen || (!acceptSmaller && qMax<int>(chosen->width_, chosen->height_) < pixelSize)) {
+            LOG("No preview large enough in" << path);
+            return false;
+        }
+
+        const Exiv2::PreviewImage preview = manager.getPreviewImage(*chosen);
+        mData = QByteArray(reinterpret_cast<const char *>(preview.pData()), preview.size());
+        mPreviewSize = QSize(chosen->width_, chosen->height_);
+    } catch (const Exiv2::Error &error) {
+        qCWarning(GWENVIEW_LIB_LOG) << "Could not extract preview from" << path << ":" << error.what();
+        return false;
+    }
+
+    LOG("Using" << mPreviewSize << "preview for" << path);
+    return !mData.isEmpty();
+}
+
+QByteArray PreviewExtractor::data() const
+{
+    return mData;
+}
+
+QSize PreviewExtractor::previewSize() const
+{
+    return mPreviewSize;
+}
+
+QSize PreviewExtractor::imageSize() const
+{
+    return mImageSize;
+}
+
+Orientation PreviewExtractor::orientation() const
+{
+    return mOrientation;
+}
+
+} // namespace
@@ -0,0 +1,86 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef PREVIEWEXTRACTOR_H
+#define PREVIEWEXTRACTOR_H
+
+// Local
+#include <lib/orientation.h>
+
+// KF
+
+// Qt
+#include <QByteArray>
+#include <QSize>
+
+namespace Gwenview
+{
+/**
+ * Picks the best embedded preview of an image to generate a thumbnail from.
+ *
+ * RAW files and HEIF/AVIF containers usually carry one or more previews
+ * (JPEG previews of various sizes for RAW files, the Exif thumbnail for
+ * HEIF). Decoding the smallest one which is at least as large as the
+ * thumbnail is much cheaper than demosaicing or decoding the real image.
+ */
+class PreviewExtractor
+{
+public:
+    /**
+     * Returns true if @p formatHint, a lower-case file extension, is a format
+     * for which looking for embedded previews is worth it
+     */
+    static bool isPreviewFormat(const QByteArray &formatHint);
+
+    /**
+     * Looks for the smallest preview of @p path covering a @p pixelSize
+     * square. If @p acceptSmaller is true and no preview is large enough, the
+     * largest one is used. Returns false if there is no suitable preview.
+     */
+    bool load(const QString &path, int pixelSize, bool acceptSmaller);
+
+    /**
+     * The encoded preview, usually JPEG data
+     */
+    QByteArray data() const;
+
+    QSize previewSize() const;
+
+    /**
+     * The size of the full image, as stored (orientation is not applied).
+     * Invalid if the container does not say.
+     */
+    QSize imageSize() const;
+
+    /**
+     * The orientation of the full image, which applies to the preview as well
+     */
+    Orientation orientation() const;
+
+private:
+    QByteArray mData;
+    QSize mPreviewSize;
+    QSize mImageSize;
+    Orientation mOrientation = NOT_AVAILABLE;
+};
+
+} // namespace
+
+#endif /* PREVIEWEXTRACTOR_H */
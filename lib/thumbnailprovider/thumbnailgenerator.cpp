@@ -21,11 +21,20 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Self
 #include "thumbnailgenerator.h"
 
+// STL
+#include <algorithm>
+
 // Local
 #include "exiv2imageloader.h"
 #include "gwenview_lib_debug.h"
 #include "gwenviewconfig.h"
+#include "imagescaling.h"
+#include "imageutils.h"
 #include "jpegcontent.h"
+#include "jpegthumbnaildecoder.h"
+#include "previewextractor.h"
+#include "thumbnailprovider.h"
+#include "tracing.h"
 
 // KDCRAW
 #ifdef KDCRAW_FOUND
@@ -37,6 +46,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Qt
 #include <QBuffer>
 #include <QCoreApplication>
+#include <QFileInfo>
 #include <QImageReader>
 #include <QTransform>
 
@@ -51,6 +61,21 @@ namespace Gwenview
 #define LOG(x) ;
 #endif
 
+static const QList<ThumbnailGroup::Enum> s_allThumbnailGroups = {
+    ThumbnailGroup::Normal,
+    ThumbnailGroup::Large,
+    ThumbnailGroup::XLarge,
+    ThumbnailGroup::XXLarge,
+};
+
+/**
+ * Area-averages @p image down to fit in a @p pixelSize square
+ */
+static QImage downScale(const QImage &image, int pixelSize)
+{
+    return ImageScaling::scaled(image, QSize(pixelSize, pixelSize), Qt::KeepAspectRatio, ImageScaling::Box);
+}
+
 //------------------------------------------------------------------------
 //
 // ThumbnailContext
@@ -58,6 +83,7 @@ namespace Gwenview
 //------------------------------------------------------------------------
 bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
 {
+    GV_TRACE_SPAN("thumbnailDecode", "thumbnail");
     mImage = QImage();
     mNeedCaching = true;
     QImage originalImage;
@@ -72,9 +98,19 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
     QBuffer buffer;
     int previewRatio = 1;
 
+    // Prefer the smallest embedded preview which is large enough over decoding
+    // the real image
+    PreviewExtractor previewExtractor;
+    const bool usePreview = PreviewExtractor::isPreviewFormat(formatHint) && previewExtractor.load(pixPath, pixelSize, GwenviewConfig::lowResourceUsageMode());
+
+    if (usePreview) {
+        data = previewExtractor.data();
+        buffer.setBuffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        reader.setDevice(&buffer);
 #ifdef KDCRAW_FOUND
-    // raw images deserve special treatment
-    if (KDcrawIface::KDcraw::rawFilesList().contains(QString::fromLatin1(formatHint))) {
+    } else if (KDcrawIface::KDcraw::rawFilesList().contains(QString::fromLatin1(formatHint))) {
+        // raw images deserve special treatment
         // use KDCraw to extract the preview
         bool ret = KDcrawIface::KDcraw::loadEmbeddedPreview(data, pixPath);
 
@@ -101,7 +137,7 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
         reader.setFormat(formatHint);
     } else {
 #else
-    {
+    } else {
 #endif
         if (!reader.canRead()) {
             reader.setDecideFormatFromContent(true);
@@ -109,6 +145,16 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
             reader.setFileName(pixPath);
         }
 
+        if (reader.format() == "jpeg" && mJpegDecoder && ThumbnailProvider::isJpegFastPathEnabled()) {
+            if (mJpegDecoder->load(pixPath, pixelSize)) {
+                mImage = mJpegDecoder->image();
+                mOriginalWidth = mJpegDecoder->originalSize().width();
+                mOriginalHeight = mJpegDecoder->originalSize().height();
+                return true;
+            }
+            // Not handled by the fast path, carry on with QImageReader
+        }
+
         if (reader.format() == "jpeg" && GwenviewConfig::applyExifOrientation()) {
             content.load(pixPath);
         }
@@ -138,8 +184,9 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
         }
     }
 
-    // Rotate if necessary
-    if (GwenviewConfig::applyExifOrientation()) {
+    // Rotate if necessary. Embedded previews follow the orientation of the
+    // full image, which is applied below.
+    if (GwenviewConfig::applyExifOrientation() && !usePreview) {
         reader.setAutoTransform(true);
     }
 
@@ -159,16 +206,49 @@ bool ThumbnailContext::load(const QString &pixPath, int pixelSize)
         mImage = originalImage;
         mNeedCaching = format != "png";
     } else {
-        mImage = originalImage.scaled(pixelSize, pixelSize, Qt::KeepAspectRatio);
+        mImage = downScale(originalImage, pixelSize);
     }
 
     if (reader.autoTransform() && (reader.transformation() & QImageIOHandler::TransformationRotate90)) {
         qSwap(mOriginalWidth, mOriginalHeight);
     }
 
+    if (usePreview) {
+        if (previewExtractor.imageSize().isValid()) {
+            mOriginalWidth = previewExtractor.imageSize().width();
+            mOriginalHeight = previewExtractor.imageSize().height();
+        }
+        const Orientation orientation = previewExtractor.orientation();
+        if (GwenviewConfig::applyExifOrientation() && orientation != NORMAL && orientation != NOT_AVAILABLE) {
+            mImage = mImage.transformed(ImageUtils::transformMatrix(orientation));
+            if (orientation == TRANSPOSE || orientation == ROT_90 || orientation == TRANSVERSE || orientation == ROT_270) {
+                qSwap(mOriginalWidth, mOriginalHeight);
+            }
+        }
+    }
+
     return true;
 }
 
+QMap<ThumbnailGroup::Enum, QImage> ThumbnailContext::generateLevels(const QList<ThumbnailGroup::Enum> &groups) const
+{
+    QList<ThumbnailGroup::Enum> sortedGroups = groups;
+    std::sort(sortedGroups.begin(), sortedGroups.end(), [](ThumbnailGroup::Enum a, ThumbnailGroup::Enum b) {
+        return ThumbnailGroup::pixelSize(a) > ThumbnailGroup::pixelSize(b);
+    });
+
+    QMap<ThumbnailGroup::Enum, QImage> levels;
+    QImage level = mImage;
+    for (ThumbnailGroup::Enum group : qAsConst(sortedGroups)) {
+        const int pixelSize = ThumbnailGroup::pixelSize(group);
+        if (qMax(level.width(), level.height()) > pixelSize) {
+            level = downScale(level, pixelSize);
+        }
+        levels.insert(group, level);
+    }
+    return levels;
+}
+
 //------------------------------------------------------------------------
 //
 // ThumbnailGenerator
@@ -247,13 +327,19 @@ void ThumbnailGenerator::cancel()
     QMutexLocker lock(&mMutex);
     mCancel = true;
     mCond.wakeOne();
+    mIoToken.cancel();
 }
 
 void ThumbnailGenerator::run()
 {
+    // Kept for the whole life of the thread so that the libjpeg
+    // decompressor is reused from one thumbnail to the next
+    JpegThumbnailDecoder jpegDecoder;
+
     while (!testCancel()) {
         QString pixPath;
         int pixelSize;
+        bool multiResolution;
         {
             QMutexLocker lock(&mMutex);
             // empty mPixPath means nothing to do
@@ -267,22 +353,47 @@ void ThumbnailGenerator::run()
         {
             QMutexLocker lock(&mMutex);
             pixPath = mPixPath;
+            // In multi-resolution mode, decode once at the displayed group, the
+            // smallest one covering the thumbnail size of the view, and derive
+            // the smaller groups from it
+            multiResolution = GwenviewConfig::generateAllThumbnailSizes() && mThumbnailGroup > ThumbnailGroup::Normal
+                && mThumbnailGroup <= ThumbnailGroup::XXLarge;
             pixelSize = ThumbnailGroup::pixelSize(mThumbnailGroup);
         }
 
         Q_ASSERT(!pixPath.isNull());
         LOG("Loading" << pixPath);
         ThumbnailContext context;
-        bool ok = context.load(pixPath, pixelSize);
+        context.mJpegDecoder = &jpegDecoder;
+        bool ok;
+        {
+            IoScheduler::Request request(pixPath, IoScheduler::VisibleThumbnail, mIoToken);
+            if (!request.isGranted()) {
+                break;
+            }
+            ok = context.load(pixPath, pixelSize);
+        }
 
         {
             QMutexLocker lock(&mMutex);
             if (ok) {
-                mImage = context.mImage;
                 mOriginalWidth = context.mOriginalWidth;
                 mOriginalHeight = context.mOriginalHeight;
-                if (context.mNeedCaching && mThumbnailGroup <= ThumbnailGroup::XXLarge) {
-                    cacheThumbnail();
+                if (multiResolution) {
+                    QList<ThumbnailGroup::Enum> groups;
+                    for (ThumbnailGroup::Enum group : s_allThumbnailGroups) {
+                        if (group <= mThumbnailGroup) {
+                            groups << group;
+                        }
+                    }
+                    const QMap<ThumbnailGroup::Enum, QImage> levels = context.generateLevels(groups);
+                    mImage = levels.value(mThumbnailGroup);
+                    cacheThumbnails(levels, context.mNeedCaching);
+                } else {
+                    mImage = context.mImage;
+                    if (context.mNeedCaching && mThumbnailGroup <= ThumbnailGroup::XXLarge) {
+                        cacheThumbnail();
+                    }
                 }
             } else {
                 // avoid emitting the thumb from the previous successful run
@@ -310,17 +421,48 @@ void ThumbnailGenerator::run()
     deleteLater();
 }
 
+void ThumbnailGenerator::setThumbnailTexts(QImage *image) const
+{
+    image->setText(QStringLiteral("Thumb::URI"), mOriginalUri);
+    image->setText(QStringLiteral("Thumb::MTime"), QString::number(mOriginalTime));
+    image->setText(QStringLiteral("Thumb::Size"), QString::number(mOriginalFileSize));
+    image->setText(QStringLiteral("Thumb::Mimetype"), mOriginalMimeType);
+    image->setText(QStringLiteral("Thumb::Image::Width"), QString::number(mOriginalWidth));
+    image->setText(QStringLiteral("Thumb::Image::Height"), QString::number(mOriginalHeight));
+    image->setText(QStringLiteral("Software"), QStringLiteral("Gwenview"));
+}
+
 void ThumbnailGenerator::cacheThumbnail()
 {
-    mImage.setText(QStringLiteral("Thumb::URI"), mOriginalUri);
-    mImage.setText(QStringLiteral("Thumb::MTime"), QString::number(mOriginalTime));
-    mImage.setText(QStringLiteral("Thumb::Size"), QString::number(mOriginalFileSize));
-    mImage.setText(QStringLiteral("Thumb::Mimetype"), mOriginalMimeType);
-    mImage.setText(QStringLiteral("Thumb::Image::Width"), QString::number(mOriginalWidth));
-    mImage.setText(QStringLiteral("Thumb::Image::Height"), QString::number(mOriginalHeight));
-    mImage.setText(QStringLiteral("Software"), QStringLiteral("Gwenview"));
+    setThumbnailTexts(&mImage);
 
     Q_EMIT thumbnailReadyToBeCached(mThumbnailPath, mImage);
 }
 
+void ThumbnailGenerator::cacheThumbnails(const QMap<ThumbnailGroup::Enum, QImage> &levels, bool needCachingLargest)
+{
+    // All groups share the same file name, only the base dir changes
+    const QString fileName = QFileInfo(mThumbnailPath).fileName();
+    const QSize decodedSize = levels.last().size();
+
+    QHash<QString, QImage> thumbnails;
+    for (auto it = levels.constBegin(); it != levels.constEnd(); ++it) {
+        QImage image = it.value();
+        // Levels which are the decoded image itself are only worth caching
+        // if the single-resolution path would have cached them
+        if (image.size() == decodedSize && !needCachingLargest) {
+            continue;
+        }
+        setThumbnailTexts(&image);
+        if (it.key() == mThumbnailGroup) {
+            mImage = image;
+        }
+        thumbnails.insert(ThumbnailProvider::thumbnailBaseDir(it.key()) + fileName, image);
+    }
+
+    if (!thumbnails.isEmpty()) {
+        Q_EMIT thumbnailsReadyToBeCached(thumbnails);
+    }
+}
+
 } // namespace
@@ -22,26 +22,40 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #define THUMBNAILGENERATOR_H
 
 // Local
+#include <lib/ioscheduler.h>
 #include <lib/thumbnailgroup.h>
 
 // KF
 #include <KFileItem>
 
 // Qt
+#include <QHash>
 #include <QImage>
+#include <QMap>
 #include <QMutex>
 #include <QThread>
 #include <QWaitCondition>
 
 namespace Gwenview
 {
+class JpegThumbnailDecoder;
+
 struct ThumbnailContext {
     QImage mImage;
     int mOriginalWidth;
     int mOriginalHeight;
     bool mNeedCaching;
+    // If set, used to decode JPEG files instead of QImageReader
+    JpegThumbnailDecoder *mJpegDecoder = nullptr;
 
     bool load(const QString &pixPath, int pixelSize);
+
+    /**
+     * Produces one thumbnail per group in @p groups out of mImage. Levels are
+     * computed from the largest to the smallest, each one by area-averaging
+     * the previous one, so the source is decoded only once.
+     */
+    QMap<ThumbnailGroup::Enum, QImage> generateLevels(const QList<ThumbnailGroup::Enum> &groups) const;
 };
 
 class ThumbnailGenerator : public QThread
@@ -75,10 +89,13 @@ protected:
 Q_SIGNALS:
     void done(const QImage &, const QSize &);
     void thumbnailReadyToBeCached(const QString &thumbnailPath, const QImage &);
+    void thumbnailsReadyToBeCached(const QHash<QString, QImage> &thumbnails);
 
 private:
     bool testCancel();
     void cacheThumbnail();
+    void cacheThumbnails(const QMap<ThumbnailGroup::Enum, QImage> &levels, bool needCachingLargest);
+    void setThumbnailTexts(QImage *image) const;
     QImage mImage;
     QString mPixPath;
     QString mThumbnailPath;
@@ -92,6 +109,7 @@ private:
     QWaitCondition mCond;
     ThumbnailGroup::Enum mThumbnailGroup;
     bool mCancel;
+    IoCancellationToken mIoToken;
     bool mStopped = false;
 };
 
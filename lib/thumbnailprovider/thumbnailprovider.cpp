@@ -42,6 +42,7 @@
 
 // Local
 #include "gwenview_lib_debug.h"
+#include "imagescaling.h"
 #include "mimetypeutils.h"
 #include "thumbnailgenerator.h"
 #include "thumbnailwriter.h"
@@ -81,6 +82,16 @@ static QString generateThumbnailPath(const QString &uri, ThumbnailGroup::Enum gr
     return baseDir + QFile::encodeName(QString::fromLatin1(md5.result().toHex())) + QStringLiteral(".png");
 }
 
+/**
+ * The preview plugins are the same for all providers: list them once per
+ * process rather than once per provider
+ */
+static const QStringList &previewPlugins()
+{
+    static const QStringList plugins = KIO::PreviewJob::availablePlugins();
+    return plugins;
+}
+
 //------------------------------------------------------------------------
 //
 // ThumbnailProvider static methods
@@ -105,6 +116,17 @@ void ThumbnailProvider::setThumbnailBaseDir(const QString &dir)
     sThumbnailBaseDir = dir;
 }
 
+static bool sJpegFastPathEnabled = true;
+void ThumbnailProvider::setJpegFastPathEnabled(bool enabled)
+{
+    sJpegFastPathEnabled = enabled;
+}
+
+bool ThumbnailProvider::isJpegFastPathEnabled()
+{
+    return sJpegFastPathEnabled;
+}
+
 QString ThumbnailProvider::thumbnailBaseDir(ThumbnailGroup::Enum group)
 {
     QString dir = thumbnailBaseDir();
@@ -284,6 +306,7 @@ void ThumbnailProvider::createNewThumbnailGenerator()
             sThumbnailWriter,
             SLOT(queueThumbnail(QString, QImage)),
             Qt::QueuedConnection);
+    connect(mThumbnailGenerator, &ThumbnailGenerator::thumbnailsReadyToBeCached, sThumbnailWriter, &ThumbnailWriter::queueThumbnails, Qt::QueuedConnection);
 }
 
 void ThumbnailProvider::abortSubjob()
@@ -413,7 +436,7 @@ QImage ThumbnailProvider::loadThumbnailFromCache() const
         const QImage largeImage(largeThumbnailPath);
         if (!largeImage.isNull()) {
             const int size = ThumbnailGroup::pixelSize(mThumbnailGroup);
-            image = largeImage.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            image = ImageScaling::scaled(largeImage, QSize(size, size), Qt::KeepAspectRatio, ImageScaling::Box);
             const QStringList textKeys = largeImage.textKeys();
             for (const QString &key : textKeys) {
                 QString text = largeImage.text(key);
@@ -510,10 +533,7 @@ void ThumbnailProvider::checkThumbnail()
         KFileItemList list;
         list.append(mCurrentItem);
         const int pixelSize = ThumbnailGroup::pixelSize(mThumbnailGroup);
-        if (mPreviewPlugins.isEmpty()) {
-            mPreviewPlugins = KIO::PreviewJob::availablePlugins();
-        }
-        KIO::Job *job = KIO::filePreview(list, QSize(pixelSize, pixelSize), &mPreviewPlugins);
+        KIO::Job *job = KIO::filePreview(list, QSize(pixelSize, pixelSize), &previewPlugins());
         // KJobWidgets::setWindow(job, qApp->activeWindow());
         connect(job, SIGNAL(gotPreview(KFileItem, QPixmap)), this, SLOT(slotGotPreview(KFileItem, QPixmap)));
         connect(job, SIGNAL(failed(KFileItem)), this, SLOT(emitThumbnailLoadingFailed()));
@@ -576,4 +596,9 @@ bool ThumbnailProvider::isThumbnailWriterEmpty()
     return sThumbnailWriter->isEmpty();
 }
 
+int ThumbnailProvider::thumbnailWriterBacklog()
+{
+    return sThumbnailWriter->size();
+}
+
 } // namespace
@@ -92,6 +92,14 @@ public:
      */
     static void setThumbnailBaseDir(const QString &);
 
+    /**
+     * Enables or disables the dedicated JPEG decoding path. It is enabled by
+     * default, disabling it is useful to benchmark it against QImageReader.
+     */
+    static void setJpegFastPathEnabled(bool enabled);
+
+    static bool isJpegFastPathEnabled();
+
     /**
      * Returns the thumbnail base dir, for the @p group
      */
@@ -113,6 +121,11 @@ public:
      */
     static bool isThumbnailWriterEmpty();
 
+    /**
+     * Returns the number of thumbnails waiting to be written to disk
+     */
+    static int thumbnailWriterBacklog();
+
 Q_SIGNALS:
     /**
      * Emitted when the thumbnail for the @p item has been loaded
@@ -171,8 +184,6 @@ private:
     ThumbnailGenerator *mThumbnailGenerator;
     QPointer<ThumbnailGenerator> mPreviousThumbnailGenerator;
 
-    QStringList mPreviewPlugins;
-
     void createNewThumbnailGenerator();
     void abortSubjob();
     void startCreatingThumbnail(const QString &path);
@@ -24,6 +24,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Local
 #include "gwenview_lib_debug.h"
 #include "gwenviewconfig.h"
+#include "memoryaccounting.h"
+#include "tracing.h"
 
 // Qt
 #include <QImage>
@@ -47,6 +49,7 @@ static void storeThumbnailToDiskCache(const QString &path, const QImage &image)
     }
 
     LOG(path);
+    GV_TRACE_SPAN("thumbnailWrite", "thumbnail");
     QTemporaryFile tmp(path + QStringLiteral(".gwenview.tmpXXXXXX.png"));
     if (!tmp.open()) {
         qCWarning(GWENVIEW_LIB_LOG) << "Could not create a temporary file.";
@@ -61,6 +64,24 @@ static void storeThumbnailToDiskCache(const QString &path, const QImage &image)
     QFile::rename(tmp.fileName(), path);
 }
 
+ThumbnailWriter::ThumbnailWriter()
+{
+    // Queued thumbnails cannot be shed: they would never be written
+    mMemoryAccountingId = MemoryAccounting::instance()->registerCache(QStringLiteral("Thumbnail writer queue"), [this] {
+        QMutexLocker locker(&mMutex);
+        qint64 usage = 0;
+        for (const QImage &image : qAsConst(mCache)) {
+            usage += image.sizeInBytes();
+        }
+        return usage;
+    });
+}
+
+ThumbnailWriter::~ThumbnailWriter()
+{
+    MemoryAccounting::instance()->unregisterCache(mMemoryAccountingId);
+}
+
 void ThumbnailWriter::queueThumbnail(const QString &path, const QImage &image)
 {
     if (GwenviewConfig::lowResourceUsageMode()) {
@@ -73,6 +94,20 @@ void ThumbnailWriter::queueThumbnail(const QString &path, const QImage &image)
     start();
 }
 
+void ThumbnailWriter::queueThumbnails(const QHash<QString, QImage> &thumbnails)
+{
+    if (GwenviewConfig::lowResourceUsageMode()) {
+        return;
+    }
+
+    QMutexLocker locker(&mMutex);
+    for (auto it = thumbnails.constBegin(); it != thumbnails.constEnd(); ++it) {
+        LOG(it.key());
+        mCache.insert(it.key(), it.value());
+    }
+    start();
+}
+
 void ThumbnailWriter::run()
 {
     QMutexLocker locker(&mMutex);
@@ -104,4 +139,10 @@ bool ThumbnailWriter::isEmpty() const
     return mCache.isEmpty();
 }
 
+int ThumbnailWriter::size() const
+{
+    QMutexLocker locker(&mMutex);
+    return mCache.size();
+}
+
 } // namespace
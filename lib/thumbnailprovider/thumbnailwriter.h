@@ -41,14 +41,28 @@ class ThumbnailWriter : public QThread
 {
     Q_OBJECT
 public:
+    ThumbnailWriter();
+    ~ThumbnailWriter() override;
+
     // Return thumbnail if it has still not been stored
     QImage value(const QString &) const;
 
     bool isEmpty() const;
 
+    /**
+     * Number of thumbnails waiting to be stored
+     */
+    int size() const;
+
 public Q_SLOTS:
     void queueThumbnail(const QString &, const QImage &);
 
+    /**
+     * Queue several thumbnails at once, used when all the thumbnail groups of
+     * an image have been generated from a single decode
+     */
+    void queueThumbnails(const QHash<QString, QImage> &);
+
 protected:
     void run() override;
 
@@ -56,6 +70,7 @@ private:
     using Cache = QHash<QString, QImage>;
     Cache mCache;
     mutable QMutex mMutex;
+    int mMemoryAccountingId;
 };
 
 } // namespace
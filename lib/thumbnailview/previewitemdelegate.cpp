@@ -50,6 +50,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "archiveutils.h"
 #include "gwenview_lib_debug.h"
 #include "itemeditor.h"
+#include "lrucache.h"
+#include "memoryaccounting.h"
 #include "paintutils.h"
 #include "thumbnailview.h"
 #include "timeutils.h"
@@ -93,6 +95,12 @@ const int SHADOW_STRENGTH_DELEGATE = 128;
 /** How many pixels around the thumbnail are shadowed */
 const int SHADOW_SIZE_DELEGATE = 4;
 
+/** How many elided texts are kept, a few screens of thumbnails */
+const int ELIDED_TEXT_CACHE_SIZE = 2000;
+
+/** How many shadow pixmaps are kept */
+const int SHADOW_CACHE_SIZE = 64;
+
 static KFileItem fileItemForIndexThumbnailView(const QModelIndex &index)
 {
     Q_ASSERT(index.isValid());
@@ -110,11 +118,26 @@ struct PreviewItemDelegatePrivate {
     /**
      * Maps full text to elided text.
      */
-    mutable QHash<QString, QString> mElidedTextCache;
+    mutable LruCache<QString, QString> mElidedTextCache{ELIDED_TEXT_CACHE_SIZE};
+
+    // Key is height * 1000 + width. Thumbnails of images with many different
+    // aspect ratios produce many keys.
+    using ShadowCache = LruCache<int, QPixmap>;
+    mutable ShadowCache mShadowCache{SHADOW_CACHE_SIZE};
 
-    // Key is height * 1000 + width
-    using ShadowCache = QHash<int, QPixmap>;
-    mutable ShadowCache mShadowCache;
+    int mMemoryAccountingId;
+
+    qint64 memoryUsage() const
+    {
+        qint64 usage = 0;
+        for (const auto &entry : mElidedTextCache) {
+            usage += (entry.key.size() + entry.value.size()) * qint64(sizeof(QChar));
+        }
+        for (const auto &entry : mShadowCache) {
+            usage += qint64(entry.value.width()) * entry.value.height() * entry.value.depth() / 8;
+        }
+        return usage;
+    }
 
     PreviewItemDelegate *q;
     QPointer<ThumbnailView> mView;
@@ -313,15 +336,15 @@ struct PreviewItemDelegatePrivate {
         const auto dpr = painter->device()->devicePixelRatioF();
         int key = qRound((rect.height() * 1000 + rect.width()) * dpr);
 
-        ShadowCache::Iterator it = mShadowCache.find(key);
-        if (it == mShadowCache.end()) {
+        const QPixmap *shadow = mShadowCache.find(key);
+        if (!shadow) {
             QSize size = QSize(rect.width() + 2 * SHADOW_SIZE_DELEGATE, rect.height() + 2 * SHADOW_SIZE_DELEGATE);
             QColor color(0, 0, 0, SHADOW_STRENGTH_DELEGATE);
-            QPixmap shadow = PaintUtils::generateFuzzyRect(size * dpr, color, qRound(SHADOW_SIZE_DELEGATE * dpr));
-            shadow.setDevicePixelRatio(dpr);
-            it = mShadowCache.insert(key, shadow);
+            QPixmap pix = PaintUtils::generateFuzzyRect(size * dpr, color, qRound(SHADOW_SIZE_DELEGATE * dpr));
+            pix.setDevicePixelRatio(dpr);
+            shadow = mShadowCache.insert(key, pix);
         }
-        painter->drawPixmap(rect.topLeft() + shadowOffset, it.value());
+        painter->drawPixmap(rect.topLeft() + shadowOffset, *shadow);
     }
 
     void drawText(QPainter *painter, const QRect &rect, const QColor &fgColor, const QString &fullText) const
@@ -330,12 +353,12 @@ struct PreviewItemDelegatePrivate {
 
         // Elide text
         QString text;
-        QHash<QString, QString>::const_iterator it = mElidedTextCache.constFind(fullText);
-        if (it == mElidedTextCache.constEnd()) {
+        const QString *cachedText = mElidedTextCache.find(fullText);
+        if (!cachedText) {
             text = fm.elidedText(fullText, mTextElideMode, rect.width());
-            mElidedTextCache[fullText] = text;
+            mElidedTextCache.insert(fullText, text);
         } else {
-            text = it.value();
+            text = *cachedText;
         }
 
         // Compute x pos
@@ -365,11 +388,11 @@ struct PreviewItemDelegatePrivate {
 
     bool isTextElided(const QString &text) const
     {
-        QHash<QString, QString>::const_iterator it = mElidedTextCache.constFind(text);
-        if (it == mElidedTextCache.constEnd()) {
+        const QString *elidedText = mElidedTextCache.peek(text);
+        if (!elidedText) {
             return false;
         }
-        return it.value().length() < text.length();
+        return elidedText->length() < text.length();
     }
 
     /**
@@ -634,10 +657,21 @@ PreviewItemDelegate::PreviewItemDelegate(ThumbnailView *view)
     d->mSaveButton->setIcon(QIcon::fromTheme(QStringLiteral("document-save")));
     d->mSaveButton->hide();
     connect(d->mSaveButton, &QToolButton::clicked, this, &PreviewItemDelegate::slotSaveClicked);
+
+    d->mMemoryAccountingId = MemoryAccounting::instance()->registerCache(
+        QStringLiteral("Thumbnail delegate caches"),
+        [this] {
+            return d->memoryUsage();
+        },
+        [this] {
+            d->mElidedTextCache.clear();
+            d->mShadowCache.clear();
+        });
 }
 
 PreviewItemDelegate::~PreviewItemDelegate()
 {
+    MemoryAccounting::instance()->unregisterCache(d->mMemoryAccountingId);
     delete d;
 }
 
@@ -43,6 +43,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 #include "gwenview_lib_debug.h"
 #include "gwenviewconfig.h"
 #include "lib/hud/hudtheme.h"
+#include "lib/lrucache.h"
 #include "lib/paintutils.h"
 #include "lib/thumbnailview/abstractthumbnailviewhelper.h"
 
@@ -65,10 +66,13 @@ const int SHADOW_STRENGTH = 127;
 /** How many pixels around the thumbnail are shadowed */
 const int SHADOW_SIZE = 4;
 
+/** How many shadow pixmaps are kept */
+const int SHADOW_CACHE_SIZE = 64;
+
 struct ThumbnailBarItemDelegatePrivate {
     // Key is height * 1000 + width
-    using ShadowCache = QMap<int, QPixmap>;
-    mutable ShadowCache mShadowCache;
+    using ShadowCache = LruCache<int, QPixmap>;
+    mutable ShadowCache mShadowCache{SHADOW_CACHE_SIZE};
 
     ThumbnailBarItemDelegate *q = nullptr;
     ThumbnailView *mView = nullptr;
@@ -103,15 +107,15 @@ struct ThumbnailBarItemDelegatePrivate {
         const auto dpr = painter->device()->devicePixelRatioF();
         int key = qRound((rect.height() * 1000 + rect.width()) * dpr);
 
-        ShadowCache::Iterator it = mShadowCache.find(key);
-        if (it == mShadowCache.end()) {
+        const QPixmap *shadow = mShadowCache.find(key);
+        if (!shadow) {
             QSize size = QSize(rect.width() + 2 * SHADOW_SIZE, rect.height() + 2 * SHADOW_SIZE);
             QColor color(0, 0, 0, SHADOW_STRENGTH);
-            QPixmap shadow = PaintUtils::generateFuzzyRect(size * dpr, color, qRound(SHADOW_SIZE * dpr));
-            shadow.setDevicePixelRatio(dpr);
-            it = mShadowCache.insert(key, shadow);
+            QPixmap pix = PaintUtils::generateFuzzyRect(size * dpr, color, qRound(SHADOW_SIZE * dpr));
+            pix.setDevicePixelRatio(dpr);
+            shadow = mShadowCache.insert(key, pix);
         }
-        painter->drawPixmap(rect.topLeft() + shadowOffset, it.value());
+        painter->drawPixmap(rect.topLeft() + shadowOffset, *shadow);
     }
 
     bool hoverEventFilter(QHoverEvent *event)
@@ -51,6 +51,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include "dragpixmapgenerator.h"
 #include "gwenview_lib_debug.h"
 #include "gwenviewconfig.h"
+#include "imagescaling.h"
+#include "memoryaccounting.h"
 #include "mimetypeutils.h"
 #include "urlutils.h"
 #include <lib/gvdebug.h>
@@ -196,6 +198,47 @@ struct ThumbnailViewPrivate {
     QScroller *mScroller;
     Touch *mTouch;
 
+    int mMemoryAccountingId;
+
+    static qint64 pixmapBytes(const QPixmap &pix)
+    {
+        return qint64(pix.width()) * pix.height() * pix.depth() / 8;
+    }
+
+    qint64 memoryUsage() const
+    {
+        qint64 usage = 0;
+        for (const Thumbnail &thumbnail : mThumbnailForUrl) {
+            usage += pixmapBytes(thumbnail.mGroupPix) + pixmapBytes(thumbnail.mAdjustedPix);
+        }
+        return usage;
+    }
+
+    /**
+     * Forgets the thumbnails of the items which are not visible. They are
+     * loaded again when they become visible.
+     */
+    void discardInvisibleThumbnails()
+    {
+        const QRect visibleRect = q->viewport()->rect();
+        KFileItemList discardedItems;
+        for (auto it = mThumbnailForUrl.begin(); it != mThumbnailForUrl.end();) {
+            const QModelIndex index = it.value().mIndex;
+            if (index.isValid() && q->visualRect(index).intersects(visibleRect)) {
+                ++it;
+                continue;
+            }
+            if (index.isValid()) {
+                discardedItems << fileItemForIndex(index);
+            }
+            mSmoothThumbnailQueue.removeAll(it.key());
+            it = mThumbnailForUrl.erase(it);
+        }
+        if (mThumbnailProvider && !discardedItems.isEmpty()) {
+            mThumbnailProvider->removeItems(discardedItems);
+        }
+    }
+
     void setupBusyAnimation()
     {
         mBusySequence = KIconLoader::global()->loadPixmapSequence(QStringLiteral("process-working"), 22);
@@ -268,22 +311,34 @@ struct ThumbnailViewPrivate {
 
     QPixmap scale(const QPixmap &pix, Qt::TransformationMode transformationMode)
     {
+        if (pix.isNull()) {
+            return {};
+        }
+        QImage image = pix.toImage();
+        QSize size;
         switch (mScaleMode) {
         case ThumbnailView::ScaleToFit:
-            return pix.scaled(mThumbnailSize.width(), mThumbnailSize.height(), Qt::KeepAspectRatio, transformationMode);
+            size = image.size().scaled(mThumbnailSize, Qt::KeepAspectRatio);
+            break;
         case ThumbnailView::ScaleToSquare: {
-            int minSize = qMin(pix.width(), pix.height());
-            QPixmap pix2 = pix.copy((pix.width() - minSize) / 2, (pix.height() - minSize) / 2, minSize, minSize);
-            return pix2.scaled(mThumbnailSize.width(), mThumbnailSize.height(), Qt::KeepAspectRatio, transformationMode);
+            int minSize = qMin(image.width(), image.height());
+            image = image.copy((image.width() - minSize) / 2, (image.height() - minSize) / 2, minSize, minSize);
+            size = image.size().scaled(mThumbnailSize, Qt::KeepAspectRatio);
+            break;
         }
         case ThumbnailView::ScaleToHeight:
-            return pix.scaledToHeight(mThumbnailSize.height(), transformationMode);
+            size = QSize(qMax(1, qRound(qreal(image.width()) * mThumbnailSize.height() / image.height())), mThumbnailSize.height());
+            break;
         case ThumbnailView::ScaleToWidth:
-            return pix.scaledToWidth(mThumbnailSize.width(), transformationMode);
+            size = QSize(mThumbnailSize.width(), qMax(1, qRound(qreal(image.height()) * mThumbnailSize.width() / image.width())));
+            break;
         }
-        // Keep compiler happy
-        Q_ASSERT(0);
-        return {};
+        if (size.isEmpty()) {
+            return {};
+        }
+        QImage scaled = ImageScaling::scaled(image, size, ImageScaling::filterForTransformationMode(transformationMode, image.size(), size));
+        scaled.setDevicePixelRatio(pix.devicePixelRatio());
+        return QPixmap::fromImage(scaled);
     }
 };
 
@@ -342,10 +397,20 @@ ThumbnailView::ThumbnailView(QWidget *parent)
 
     verticalScrollBar()->setSingleStep(singleStep);
     horizontalScrollBar()->setSingleStep(singleStep);
+
+    d->mMemoryAccountingId = MemoryAccounting::instance()->registerCache(
+        QStringLiteral("Thumbnail view pixmaps"),
+        [this] {
+            return d->memoryUsage();
+        },
+        [this] {
+            d->discardInvisibleThumbnails();
+        });
 }
 
 ThumbnailView::~ThumbnailView()
 {
+    MemoryAccounting::instance()->unregisterCache(d->mMemoryAccountingId);
     delete d->mTouch;
     delete d;
 }
@@ -37,6 +37,8 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // Local
 #include "gwenview_lib_debug.h"
 #include <lib/exiv2imageloader.h>
+#include <lib/lrucache.h>
+#include <lib/memoryaccounting.h>
 #include <lib/urlutils.h>
 
 namespace Gwenview
@@ -119,7 +121,34 @@ struct CacheItem {
     }
 };
 
-using Cache = QHash<QUrl, CacheItem>;
+using Cache = LruCache<QUrl, CacheItem>;
+
+// Dates kept when few items are listed, so that going back to a folder
+// recently left does not read all its dates again. The cache grows to hold
+// all the listed items, see updateListedItemCount().
+static const int MIN_CACHE_SIZE = 5000;
+
+static int sListedItemCount = 0;
+
+static Cache &cache()
+{
+    static Cache sCache(MIN_CACHE_SIZE);
+    static const int memoryAccountingId = MemoryAccounting::instance()->registerCache(
+        QStringLiteral("Date cache"),
+        [] {
+            // Rough estimate: the url, the list node and the hash node
+            qint64 usage = 0;
+            for (const auto &entry : sCache) {
+                usage += entry.key.toString().size() * qint64(sizeof(QChar)) + qint64(sizeof(Cache::Entry)) + 6 * qint64(sizeof(void *));
+            }
+            return usage;
+        },
+        [] {
+            sCache.clear();
+        });
+    Q_UNUSED(memoryAccountingId);
+    return sCache;
+}
 
 QDateTime dateTimeForFileItem(const KFileItem &fileItem, CachePolicy cachePolicy)
 {
@@ -129,16 +158,24 @@ QDateTime dateTimeForFileItem(const KFileItem &fileItem, CachePolicy cachePolicy
         return item.realTime;
     }
 
-    static Cache cache;
+    Cache &cache = TimeUtils::cache();
     const QUrl url = fileItem.targetUrl();
 
-    Cache::iterator it = cache.find(url);
-    if (it == cache.end()) {
-        it = cache.insert(url, CacheItem());
+    CacheItem *item = cache.find(url);
+    if (!item) {
+        item = cache.insert(url, CacheItem());
     }
 
-    it.value().update(fileItem);
-    return it.value().realTime;
+    item->update(fileItem);
+    return item->realTime;
+}
+
+void updateListedItemCount(int delta)
+{
+    sListedItemCount = qMax(0, sListedItemCount + delta);
+    // Shrinking evicts the least recently used dates, those of the items
+    // which are no longer listed
+    cache().setCapacity(qMax(MIN_CACHE_SIZE, sListedItemCount));
 }
 
 } // namespace
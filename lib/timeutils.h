@@ -38,6 +38,13 @@ enum CachePolicy {
 
 QDateTime GWENVIEWLIB_EXPORT dateTimeForFileItem(const KFileItem &fileItem, Gwenview::TimeUtils::CachePolicy cachePolicy = UseCache);
 
+/**
+ * Models listing file items report how many items they add (positive
+ * @p delta) or remove, so that the date cache can hold the dates of all the
+ * listed items. Must be called from the GUI thread.
+ */
+void GWENVIEWLIB_EXPORT updateListedItemCount(int delta);
+
 } // namespace
 
 } // namespace
@@ -0,0 +1,265 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "tracing.h"
+
+// STL
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// Qt
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+
+// Local
+#include "gwenview_lib_debug.h"
+
+namespace Gwenview
+{
+namespace Tracing
+{
+namespace Detail
+{
+std::atomic<bool> sEnabled(false);
+}
+
+struct TraceEvent {
+    const char *name;
+    const char *category;
+    qint64 start;
+    qint64 end;
+};
+
+/**
+ * Holds the events written at the same index of a ring buffer. The sequence
+ * is odd while an event is being written, and goes up by two with each
+ * event, so that readers can tell which event they copied and whether it
+ * changed during the copy.
+ */
+struct TraceSlot {
+    std::atomic<quint64> mSequence{0};
+    std::atomic<const char *> mName{nullptr};
+    std::atomic<const char *> mCategory{nullptr};
+    std::atomic<qint64> mStart{0};
+    std::atomic<qint64> mEnd{0};
+};
+
+/**
+ * The spans of one thread. Only the owning thread writes to it: it bumps
+ * mWritten after writing an event, so readers know which events have been
+ * written.
+ */
+struct ThreadBuffer {
+    enum { Capacity = 8192 };
+
+    TraceSlot mSlots[Capacity];
+    std::atomic<quint64> mWritten{0};
+    // Events before this one have been cleared
+    std::atomic<quint64> mCleared{0};
+    int mId = 0;
+    QString mName;
+};
+
+// Threads which are gone keep their buffer until there are more than this
+// many buffers
+static const size_t MAX_BUFFER_COUNT = 64;
+
+static QMutex sBuffersMutex;
+static std::vector<std::shared_ptr<ThreadBuffer>> sBuffers;
+static int sNextThreadId = 1;
+
+static thread_local std::shared_ptr<ThreadBuffer> tBuffer;
+
+static ThreadBuffer *createThreadBuffer()
+{
+    auto buffer = std::make_shared<ThreadBuffer>();
+    QThread *thread = QThread::currentThread();
+    QCoreApplication *app = QCoreApplication::instance();
+    if (app && thread == app->thread()) {
+        buffer->mName = QStringLiteral("GUI");
+    } else {
+        buffer->mName = thread->objectName();
+    }
+
+    QMutexLocker locker(&sBuffersMutex);
+    buffer->mId = sNextThreadId++;
+    if (buffer->mName.isEmpty()) {
+        buffer->mName = QStringLiteral("Thread %1").arg(buffer->mId);
+    }
+    if (sBuffers.size() >= MAX_BUFFER_COUNT) {
+        // Drop the oldest buffer of a finished thread
+        for (auto it = sBuffers.begin(); it != sBuffers.end(); ++it) {
+            if (it->use_count() == 1) {
+                sBuffers.erase(it);
+                break;
+            }
+        }
+    }
+    sBuffers.push_back(buffer);
+    tBuffer = buffer;
+    return buffer.get();
+}
+
+void setEnabled(bool enabled)
+{
+    Detail::sEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void record(const char *name, const char *category, qint64 start, qint64 end)
+{
+    ThreadBuffer *buffer = tBuffer ? tBuffer.get() : createThreadBuffer();
+    const quint64 index = buffer->mWritten.load(std::memory_order_relaxed);
+    TraceSlot &slot = buffer->mSlots[index % ThreadBuffer::Capacity];
+    const quint64 sequence = slot.mSequence.load(std::memory_order_relaxed);
+    slot.mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.mName.store(name, std::memory_order_relaxed);
+    slot.mCategory.store(category, std::memory_order_relaxed);
+    slot.mStart.store(start, std::memory_order_relaxed);
+    slot.mEnd.store(end, std::memory_order_relaxed);
+    slot.mSequence.store(sequence + 2, std::memory_order_release);
+    buffer->mWritten.store(index + 1, std::memory_order_release);
+}
+
+void clear()
+{
+    QMutexLocker locker(&sBuffersMutex);
+    for (const auto &buffer : sBuffers) {
+        buffer->mCleared.store(buffer->mWritten.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Copies the complete events of @p buffer. The owning thread may keep
+ * writing: events it overwrites before or during their copy are dropped.
+ */
+static std::vector<TraceEvent> readEvents(const ThreadBuffer &buffer)
+{
+    const quint64 written = buffer.mWritten.load(std::memory_order_acquire);
+    quint64 first = qMax(buffer.mCleared.load(std::memory_order_relaxed), written > ThreadBuffer::Capacity ? written - ThreadBuffer::Capacity : 0);
+    std::vector<TraceEvent> events;
+    events.reserve(written - first);
+    for (quint64 index = first; index < written; ++index) {
+        const TraceSlot &slot = buffer.mSlots[index % ThreadBuffer::Capacity];
+        // The sequence of the slot once event number index has been written
+        const quint64 sequence = 2 * (index / ThreadBuffer::Capacity + 1);
+        if (slot.mSequence.load(std::memory_order_acquire) != sequence) {
+            continue;
+        }
+        const TraceEvent event = {
+            slot.mName.load(std::memory_order_relaxed),
+            slot.mCategory.load(std::memory_order_relaxed),
+            slot.mStart.load(std::memory_order_relaxed),
+            slot.mEnd.load(std::memory_order_relaxed),
+        };
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.mSequence.load(std::memory_order_relaxed) != sequence) {
+            continue;
+        }
+        events.push_back(event);
+    }
+    return events;
+}
+
+QByteArray chromeTraceJson()
+{
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        QMutexLocker locker(&sBuffersMutex);
+        buffers = sBuffers;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+    for (const auto &buffer : buffers) {
+        const std::vector<TraceEvent> events = readEvents(*buffer);
+        if (events.empty()) {
+            continue;
+        }
+        traceEvents.append(QJsonObject{
+            {QStringLiteral("name"), QStringLiteral("thread_name")},
+            {QStringLiteral("ph"), QStringLiteral("M")},
+            {QStringLiteral("pid"), pid},
+            {QStringLiteral("tid"), buffer->mId},
+            {QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), buffer->mName}}},
+        });
+        for (const TraceEvent &event : events) {
+            // Complete events, in microseconds
+            traceEvents.append(QJsonObject{
+                {QStringLiteral("name"), QString::fromLatin1(event.name)},
+                {QStringLiteral("cat"), QString::fromLatin1(event.category)},
+                {QStringLiteral("ph"), QStringLiteral("X")},
+                {QStringLiteral("ts"), event.start / 1000.},
+                {QStringLiteral("dur"), (event.end - event.start) / 1000.},
+                {QStringLiteral("pid"), pid},
+                {QStringLiteral("tid"), buffer->mId},
+            });
+        }
+    }
+
+    const QJsonObject root{
+        {QStringLiteral("traceEvents"), traceEvents},
+        {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")},
+    };
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+bool writeChromeTrace(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(GWENVIEW_LIB_LOG) << "Could not write trace to" << path << ":" << file.errorString();
+        return false;
+    }
+    file.write(chromeTraceJson());
+    return true;
+}
+
+void initFromEnvironment()
+{
+    const QString path = qEnvironmentVariable("GV_TRACE_FILE");
+    if (path.isEmpty()) {
+        return;
+    }
+    setEnabled(true);
+    QCoreApplication *app = QCoreApplication::instance();
+    if (!app) {
+        qCWarning(GWENVIEW_LIB_LOG) << "No application, the trace will not be written to" << path;
+        return;
+    }
+    QObject::connect(app, &QCoreApplication::aboutToQuit, [path] {
+        writeChromeTrace(path);
+    });
+}
+
+} // namespace
+} // namespace
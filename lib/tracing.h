@@ -0,0 +1,132 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <lib/gwenviewlib_export.h>
+
+// STL
+#include <atomic>
+
+// Qt
+#include <QByteArray>
+#include <QString>
+
+namespace Gwenview
+{
+/**
+ * Runtime tracing of the document pipeline.
+ *
+ * Spans are recorded in a ring buffer owned by the recording thread, without
+ * locking, and can be exported in the Chrome trace event format (open it in
+ * chrome://tracing or https://ui.perfetto.dev). When tracing is disabled a
+ * span costs one relaxed atomic load.
+ *
+ * Tracing is enabled by setting the GV_TRACE_FILE environment variable to the
+ * file the trace is written to on exit, or at runtime over D-Bus.
+ */
+namespace Tracing
+{
+namespace Detail
+{
+extern GWENVIEWLIB_EXPORT std::atomic<bool> sEnabled;
+}
+
+inline bool isEnabled()
+{
+    return Detail::sEnabled.load(std::memory_order_relaxed);
+}
+
+GWENVIEWLIB_EXPORT void setEnabled(bool enabled);
+
+/**
+ * Current time in nanoseconds, on the clock used by spans
+ */
+GWENVIEWLIB_EXPORT qint64 now();
+
+/**
+ * Records a span which started at @p start and ended at @p end, as returned
+ * by now(). @p name and @p category must be string literals: only the
+ * pointers are stored.
+ */
+GWENVIEWLIB_EXPORT void record(const char *name, const char *category, qint64 start, qint64 end);
+
+/**
+ * Forgets the recorded spans
+ */
+GWENVIEWLIB_EXPORT void clear();
+
+/**
+ * Returns the recorded spans of all threads as a Chrome trace event JSON
+ * document
+ */
+GWENVIEWLIB_EXPORT QByteArray chromeTraceJson();
+
+GWENVIEWLIB_EXPORT bool writeChromeTrace(const QString &path);
+
+/**
+ * Enables tracing if GV_TRACE_FILE is set, and writes the trace to this file
+ * when the application quits. Must be called after the application object
+ * has been created.
+ */
+GWENVIEWLIB_EXPORT void initFromEnvironment();
+
+/**
+ * Records the time spent in a scope. Use GV_TRACE_SPAN() rather than this
+ * class.
+ */
+class Span
+{
+public:
+    Span(const char *name, const char *category)
+        : mName(isEnabled() ? name : nullptr)
+        , mCategory(category)
+        , mStart(mName ? now() : 0)
+    {
+    }
+
+    ~Span()
+    {
+        if (mName) {
+            record(mName, mCategory, mStart, now());
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(Span)
+    const char *const mName;
+    const char *const mCategory;
+    const qint64 mStart;
+};
+
+} // namespace
+
+} // namespace
+
+#define GV_TRACE_CONCAT_(a, b) a##b
+#define GV_TRACE_CONCAT(a, b) GV_TRACE_CONCAT_(a, b)
+
+/**
+ * Records the time spent until the end of the current scope
+ */
+#define GV_TRACE_SPAN(name, category) const Gwenview::Tracing::Span GV_TRACE_CONCAT(gvTraceSpan, __LINE__)(name, category)
+
+#endif /* TRACING_H */
@@ -0,0 +1,231 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Self
+#include "urllistdirlister.h"
+
+// Qt
+#include <QHash>
+#include <QScopedPointer>
+#include <QSet>
+#include <QTemporaryDir>
+#include <QUrl>
+
+// KF
+#include <KDirWatch>
+#include <KIO/StatJob>
+
+// Local
+#include "gwenview_lib_debug.h"
+
+namespace Gwenview
+{
+#undef ENABLE_LOG
+#undef LOG
+//#define ENABLE_LOG
+#ifdef ENABLE_LOG
+#define LOG(x) qCDebug(GWENVIEW_LIB_LOG) << x
+#else
+#define LOG(x) ;
+#endif
+
+// Items found while populating the list are passed on by batches of this size
+static const int ITEMS_ADDED_BATCH_SIZE = 100;
+
+struct UrlListDirListerPrivate {
+    UrlListDirLister *q = nullptr;
+    // Empty folder standing as the root of the list
+    QScopedPointer<QTemporaryDir> mRootDir;
+    QSet<QUrl> mUrls;
+    // The items which have been passed on, by url
+    QHash<QUrl, KFileItem> mItems;
+    // Items found while populating, not passed on yet
+    KFileItemList mPendingItems;
+    QSet<KJob *> mStatJobs;
+    // Watches the local files of the list, created once the root folder has
+    // been listed
+    KDirWatch *mDirWatch = nullptr;
+    bool mPopulating = false;
+
+    void stat(const QUrl &url)
+    {
+        KIO::StatJob *job = KIO::stat(url, KIO::StatJob::SourceSide, KIO::StatDefaultDetails, KIO::HideProgressInfo);
+        mStatJobs.insert(job);
+        QObject::connect(job, &KJob::result, q, &UrlListDirLister::slotStatResult);
+    }
+
+    void flushPendingItems()
+    {
+        if (!mPendingItems.isEmpty()) {
+            Q_EMIT q->itemsAdded(q->url(), mPendingItems);
+            mPendingItems.clear();
+        }
+    }
+
+    void clear()
+    {
+        for (KJob *job : qAsConst(mStatJobs)) {
+            job->kill();
+        }
+        mStatJobs.clear();
+        delete mDirWatch;
+        mDirWatch = nullptr;
+        mRootDir.reset();
+        mUrls.clear();
+        mItems.clear();
+        mPendingItems.clear();
+        mPopulating = false;
+    }
+};
+
+UrlListDirLister::UrlListDirLister(QObject *parent)
+    : KDirLister(parent)
+    , d(new UrlListDirListerPrivate)
+{
+    d->q = this;
+    connect(this, &KDirLister::started, this, &UrlListDirLister::slotStarted);
+    connect(this, QOverload<>::of(&KDirLister::completed), this, &UrlListDirLister::slotCompleted);
+}
+
+UrlListDirLister::~UrlListDirLister()
+{
+    d->clear();
+    delete d;
+}
+
+void UrlListDirLister::openUrlList(const QList<QUrl> &urls)
+{
+    d->clear();
+    d->mRootDir.reset(new QTemporaryDir);
+    if (!d->mRootDir->isValid()) {
+        qCWarning(GWENVIEW_LIB_LOG) << "Could not create the root folder of the url list:" << d->mRootDir->errorString();
+        d->mRootDir.reset();
+        return;
+    }
+
+    d->mUrls.reserve(urls.count());
+    for (const QUrl &url : urls) {
+        d->mUrls.insert(url.adjusted(QUrl::NormalizePathSegments | QUrl::StripTrailingSlash));
+    }
+    LOG(d->mUrls.count() << "urls");
+
+    // The urls are stat-ed once the root folder has been listed, see
+    // slotCompleted(), so that their items are not cleared with it
+    d->mPopulating = true;
+    KDirLister::openUrl(QUrl::fromLocalFile(d->mRootDir->path()));
+}
+
+bool UrlListDirLister::isListingUrlList() const
+{
+    return !d->mRootDir.isNull();
+}
+
+bool UrlListDirLister::isPopulatingUrlList() const
+{
+    return d->mPopulating;
+}
+
+void UrlListDirLister::slotStarted(const QUrl &url)
+{
+    if (d->mRootDir && url.adjusted(QUrl::StripTrailingSlash) != QUrl::fromLocalFile(d->mRootDir->path())) {
+        LOG("Leaving the url list for" << url);
+        d->clear();
+    }
+}
+
+void UrlListDirLister::slotCompleted()
+{
+    if (!d->mPopulating || d->mDirWatch) {
+        return;
+    }
+    if (d->mUrls.isEmpty()) {
+        d->mPopulating = false;
+        Q_EMIT completed();
+        return;
+    }
+
+    d->mDirWatch = new KDirWatch(this);
+    connect(d->mDirWatch, &KDirWatch::dirty, this, &UrlListDirLister::slotFileChanged);
+    connect(d->mDirWatch, &KDirWatch::created, this, &UrlListDirLister::slotFileChanged);
+    connect(d->mDirWatch, &KDirWatch::deleted, this, &UrlListDirLister::slotFileDeleted);
+    for (const QUrl &url : qAsConst(d->mUrls)) {
+        if (url.isLocalFile()) {
+            d->mDirWatch->addFile(url.toLocalFile());
+        }
+        d->stat(url);
+    }
+}
+
+void UrlListDirLister::slotStatResult(KJob *job)
+{
+    d->mStatJobs.remove(job);
+    const auto statJob = static_cast<KIO::StatJob *>(job);
+    const QUrl url = statJob->url().adjusted(QUrl::NormalizePathSegments | QUrl::StripTrailingSlash);
+    if (job->error()) {
+        LOG("Could not stat" << url << job->errorString());
+    } else {
+        const KFileItem item(statJob->statResult(), url, !requestMimeTypeWhileListing());
+        const KFileItem oldItem = d->mItems.value(url);
+        d->mItems.insert(url, item);
+        if (oldItem.isNull()) {
+            if (d->mPopulating) {
+                d->mPendingItems << item;
+                if (d->mPendingItems.count() >= ITEMS_ADDED_BATCH_SIZE) {
+                    d->flushPendingItems();
+                }
+            } else {
+                Q_EMIT itemsAdded(this->url(), {item});
+            }
+        } else {
+            const int pendingIndex = d->mPendingItems.indexOf(oldItem);
+            if (pendingIndex != -1) {
+                d->mPendingItems[pendingIndex] = item;
+            } else {
+                Q_EMIT refreshItems({qMakePair(oldItem, item)});
+            }
+        }
+    }
+
+    if (d->mPopulating && d->mStatJobs.isEmpty()) {
+        d->flushPendingItems();
+        d->mPopulating = false;
+        Q_EMIT completed();
+    }
+}
+
+void UrlListDirLister::slotFileChanged(const QString &path)
+{
+    const QUrl url = QUrl::fromLocalFile(path);
+    if (d->mUrls.contains(url)) {
+        d->stat(url);
+    }
+}
+
+void UrlListDirLister::slotFileDeleted(const QString &path)
+{
+    // Urls are kept, so that an item which comes back, for example because it
+    // has been saved by replacing it, is listed again
+    const KFileItem item = d->mItems.take(QUrl::fromLocalFile(path));
+    if (!item.isNull() && !d->mPendingItems.removeOne(item)) {
+        Q_EMIT itemsDeleted({item});
+    }
+}
+
+} // namespace
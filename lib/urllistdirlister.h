@@ -0,0 +1,84 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+#ifndef URLLISTDIRLISTER_H
+#define URLLISTDIRLISTER_H
+
+// Local
+#include <lib/gwenviewlib_export.h>
+
+// KF
+#include <KDirLister>
+
+// Qt
+#include <QList>
+
+class KJob;
+class QUrl;
+
+namespace Gwenview
+{
+struct UrlListDirListerPrivate;
+/**
+ * A dir lister which can also list a set of urls, spread over any number of
+ * folders, as if they were the content of a single folder.
+ *
+ * Each url is stat-ed on its own, so the size of the folders containing the
+ * urls does not matter. Local files are watched, so changes made to them are
+ * tracked like in any other folder. KDirModel needs a root folder to attach
+ * the items to: an empty temporary folder is listed for this.
+ *
+ * Opening any other url with openUrl() leaves the url list.
+ */
+class GWENVIEWLIB_EXPORT UrlListDirLister : public KDirLister
+{
+    Q_OBJECT
+public:
+    explicit UrlListDirLister(QObject *parent = nullptr);
+    ~UrlListDirLister() override;
+
+    /**
+     * Lists @p urls. url() returns the root folder of the list afterwards.
+     */
+    void openUrlList(const QList<QUrl> &urls);
+
+    bool isListingUrlList() const;
+
+    /**
+     * Returns true until the items of the url list have been added. The
+     * completed() signal emitted for the root folder before that can be
+     * ignored.
+     */
+    bool isPopulatingUrlList() const;
+
+private Q_SLOTS:
+    void slotStarted(const QUrl &url);
+    void slotCompleted();
+    void slotStatResult(KJob *job);
+    void slotFileChanged(const QString &path);
+    void slotFileDeleted(const QString &path);
+
+private:
+    UrlListDirListerPrivate *const d;
+};
+
+} // namespace
+
+#endif /* URLLISTDIRLISTER_H */
@@ -30,12 +30,12 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 // KF
 #include <KIO/StatJob>
 #include <KJobWidgets>
-#include <KMountPoint>
 #include <KProtocolManager>
 
 // Local
 #include <archiveutils.h>
 #include <mimetypeutils.h>
+#include <mounttable.h>
 
 namespace Gwenview
 {
@@ -47,26 +47,14 @@ bool urlIsFastLocalFile(const QUrl &url)
         return false;
     }
 
-    // Only query the mountpoint when we haven't queried it for this folder before
-    static QString lastFolder;
-    static KMountPoint::Ptr lastMountPoint;
-
-    const QString fileName = url.toLocalFile();
-    const QString currentFolder = fileName.left(fileName.lastIndexOf(QLatin1Char('/')));
-
-    if (currentFolder != lastFolder) {
-        lastFolder = currentFolder;
-        KMountPoint::List list = KMountPoint::currentMountPoints();
-        lastMountPoint = list.findByPath(url.toLocalFile());
-    }
-
-    if (!lastMountPoint) {
+    const MountInfo mount = MountTable::mountForUrl(url);
+    if (!mount.isValid()) {
         // We couldn't find a mount point for the url. We are probably in a
         // chroot. Assume everything is fast then.
         return true;
     }
 
-    return !lastMountPoint->probablySlow();
+    return !mount.isNetwork();
 }
 
 bool urlIsDirectory(const QUrl &url)
@@ -37,7 +37,7 @@ namespace UrlUtils
 {
 /**
  * Returns whether the url is a local file, and it's not on a slow device like
- * an nfs export.
+ * an nfs export. Safe to call from any thread.
  */
 GWENVIEWLIB_EXPORT bool urlIsFastLocalFile(const QUrl &url);
 
@@ -0,0 +1,110 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "animationenginetest.h"
+
+// Qt
+#include <QFile>
+#include <QSignalSpy>
+#include <QTest>
+
+// Local
+#include "../lib/document/animationengine.h"
+#include "testutils.h"
+
+QTEST_MAIN(AnimationEngineTest)
+
+using namespace Gwenview;
+
+static QByteArray readTestFile(const QString &name)
+{
+    QFile file(pathForTestFile(name));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.readAll();
+}
+
+void AnimationEngineTest::testCachedMode()
+{
+    const QByteArray data = readTestFile(QStringLiteral("4frames.gif"));
+    QVERIFY(!data.isEmpty());
+    AnimationEngine engine(data);
+    QCOMPARE(engine.mode(), AnimationEngine::Cached);
+    QCOMPARE(engine.frameCount(), 4);
+    QVERIFY(engine.currentFrame().isNull());
+
+    QSignalSpy spy(&engine, &AnimationEngine::frameChanged);
+    engine.start();
+    QVERIFY(engine.isRunning());
+
+    // Play more than one loop: the file loops forever
+    QTRY_VERIFY_WITH_TIMEOUT(spy.count() >= 6, 10000);
+    const QImage frame = engine.currentFrame();
+    QCOMPARE(frame.size(), QSize(40, 30));
+    QVERIFY(frame.format() == QImage::Format_RGB32 || frame.format() == QImage::Format_ARGB32);
+}
+
+void AnimationEngineTest::testStreamingMode()
+{
+    const QByteArray data = readTestFile(QStringLiteral("40frames.gif"));
+    QVERIFY(!data.isEmpty());
+    // A budget too small for all the frames
+    AnimationEngine engine(data, 40 * 30 * 4 * 10);
+    QCOMPARE(engine.mode(), AnimationEngine::Streaming);
+
+    QSignalSpy spy(&engine, &AnimationEngine::frameChanged);
+    engine.start();
+    QTRY_VERIFY_WITH_TIMEOUT(spy.count() >= 45, 20000);
+    QCOMPARE(engine.currentFrame().size(), QSize(40, 30));
+}
+
+void AnimationEngineTest::testStop()
+{
+    const QByteArray data = readTestFile(QStringLiteral("4frames.gif"));
+    AnimationEngine engine(data);
+    QSignalSpy spy(&engine, &AnimationEngine::frameChanged);
+    engine.start();
+    QTRY_VERIFY_WITH_TIMEOUT(spy.count() >= 1, 5000);
+    engine.stop();
+    QVERIFY(!engine.isRunning());
+    const int count = spy.count();
+    QTest::qWait(500);
+    QCOMPARE(spy.count(), count);
+}
+
+void AnimationEngineTest::testScaledSize()
+{
+    const QByteArray data = readTestFile(QStringLiteral("40frames.gif"));
+    AnimationEngine engine(data, 40 * 30 * 4 * 10);
+    QSignalSpy spy(&engine, &AnimationEngine::frameChanged);
+    engine.start();
+    QTRY_VERIFY_WITH_TIMEOUT(spy.count() >= 2, 5000);
+
+    // Playback goes on at the new size
+    engine.setScaledSize(QSize(20, 15));
+    const int count = spy.count();
+    QTRY_VERIFY_WITH_TIMEOUT(spy.count() >= count + AnimationEngine::StreamingFrameCount + 2, 10000);
+    QCOMPARE(engine.currentFrame().size(), QSize(20, 15));
+
+    engine.setScaledSize(QSize());
+    const int count2 = spy.count();
+    QTRY_VERIFY_WITH_TIMEOUT(spy.count() >= count2 + AnimationEngine::StreamingFrameCount + 2, 10000);
+    QCOMPARE(engine.currentFrame().size(), QSize(40, 30));
+}
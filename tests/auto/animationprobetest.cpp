@@ -0,0 +1,145 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "animationprobetest.h"
+
+// Qt
+#include <QFile>
+#include <QTest>
+#include <QtEndian>
+
+// Local
+#include "../lib/animationprobe.h"
+#include "testutils.h"
+
+QTEST_MAIN(AnimationProbeTest)
+
+using namespace Gwenview;
+
+static QByteArray readTestFile(const QString &name)
+{
+    QFile file(pathForTestFile(name));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.readAll();
+}
+
+static QByteArray le32(quint32 value)
+{
+    QByteArray data(4, 0);
+    qToLittleEndian(value, data.data());
+    return data;
+}
+
+static QByteArray be32(quint32 value)
+{
+    QByteArray data(4, 0);
+    qToBigEndian(value, data.data());
+    return data;
+}
+
+static QByteArray riffChunk(const QByteArray &type, const QByteArray &payload)
+{
+    QByteArray chunk = type + le32(payload.size()) + payload;
+    if (payload.size() % 2) {
+        chunk += '\0';
+    }
+    return chunk;
+}
+
+static QByteArray pngChunk(const QByteArray &type, const QByteArray &payload)
+{
+    // The CRC is not checked
+    return be32(payload.size()) + type + payload + be32(0);
+}
+
+static QByteArray box(const QByteArray &type, const QByteArray &content)
+{
+    return be32(content.size() + 8) + type + content;
+}
+
+void AnimationProbeTest::testGif_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<int>("maxCount");
+    QTest::addColumn<int>("expected");
+
+    QTest::newRow("1frame") << "1frame.gif" << 2 << 1;
+    // A Graphic Control Extension does not make an animation (bug 185523)
+    QTest::newRow("185523") << "185523_1frame_with_graphic_control_extension.gif" << 2 << 1;
+    QTest::newRow("4frames") << "4frames.gif" << 100 << 4;
+    QTest::newRow("40frames") << "40frames.gif" << 100 << 40;
+    QTest::newRow("40frames-limited") << "40frames.gif" << 2 << 2;
+}
+
+void AnimationProbeTest::testGif()
+{
+    QFETCH(QString, fileName);
+    QFETCH(int, maxCount);
+    QFETCH(int, expected);
+    const QByteArray data = readTestFile(fileName);
+    QVERIFY(!data.isEmpty());
+    QCOMPARE(AnimationProbe::frameCount(data, maxCount), expected);
+}
+
+void AnimationProbeTest::testWebp()
+{
+    const QByteArray header = QByteArray("RIFF") + le32(0) + QByteArray("WEBP");
+
+    const QByteArray still = header + riffChunk("VP8L", QByteArray(13, 0));
+    QCOMPARE(AnimationProbe::frameCount(still), 1);
+
+    QByteArray animated = header + riffChunk("VP8X", QByteArray(1, 0x02) + QByteArray(9, 0)) + riffChunk("ANIM", QByteArray(6, 0));
+    for (int i = 0; i < 3; ++i) {
+        animated += riffChunk("ANMF", QByteArray(17, 0));
+    }
+    QCOMPARE(AnimationProbe::frameCount(animated, 10), 3);
+    QCOMPARE(AnimationProbe::frameCount(animated), 2);
+}
+
+void AnimationProbeTest::testApng()
+{
+    const QByteArray still = readTestFile(QStringLiteral("test.png"));
+    QVERIFY(!still.isEmpty());
+    QCOMPARE(AnimationProbe::frameCount(still), 1);
+
+    const QByteArray signature("\x89PNG\r\n\x1a\n", 8);
+    const QByteArray animated = signature + pngChunk("IHDR", QByteArray(13, 0)) + pngChunk("acTL", be32(5) + be32(0)) + pngChunk("IDAT", QByteArray(4, 0));
+    QCOMPARE(AnimationProbe::frameCount(animated, 10), 5);
+}
+
+void AnimationProbeTest::testAvifSequence()
+{
+    const QByteArray still = box("ftyp", QByteArray("avif") + be32(0) + QByteArray("avifmif1miaf"));
+    QCOMPARE(AnimationProbe::frameCount(still), 1);
+
+    // Version and flags, sample size, sample count
+    const QByteArray stsz = box("stsz", be32(0) + be32(0) + be32(7));
+    const QByteArray moov = box("moov", box("mvhd", QByteArray(20, 0)) + box("trak", box("mdia", box("minf", box("stbl", stsz)))));
+    const QByteArray sequence = box("ftyp", QByteArray("avis") + be32(0) + QByteArray("avisavifmsf1")) + moov;
+    QCOMPARE(AnimationProbe::frameCount(sequence, 10), 7);
+}
+
+void AnimationProbeTest::testUnknownFormat()
+{
+    const QByteArray data = readTestFile(QStringLiteral("orient6.jpg"));
+    QVERIFY(!data.isEmpty());
+    QCOMPARE(AnimationProbe::frameCount(data), -1);
+}
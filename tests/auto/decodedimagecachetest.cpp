@@ -0,0 +1,198 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "decodedimagecachetest.h"
+
+// Qt
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+// Local
+#include "../lib/document/decodedimagecache.h"
+
+QTEST_MAIN(DecodedImageCacheTest)
+
+using namespace Gwenview;
+
+static const qint64 CAPACITY = 1024 * 1024;
+
+static QImage createTestImage(QImage::Format format, const QSize &size = QSize(37, 23))
+{
+    QImage image(size, QImage::Format_ARGB32);
+    for (int y = 0; y < size.height(); ++y) {
+        for (int x = 0; x < size.width(); ++x) {
+            image.setPixel(x, y, qRgba(x * 7, y * 11, (x + y) * 3, 128 + x));
+        }
+    }
+    return image.convertToFormat(format);
+}
+
+static void writeFile(const QString &path, const QByteArray &content)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(content);
+}
+
+void DecodedImageCacheTest::testKey()
+{
+    QTemporaryDir dir;
+    const QString path = dir.filePath(QStringLiteral("image.png"));
+    QVERIFY(DecodedImageCache::key(path, "2").isEmpty());
+
+    writeFile(path, "content");
+    const QByteArray key = DecodedImageCache::key(path, "2");
+    QVERIFY(!key.isEmpty());
+    QCOMPARE(DecodedImageCache::key(path, "2"), key);
+    QVERIFY(DecodedImageCache::key(path, "4") != key);
+
+    // Modifying the file changes the key
+    writeFile(path, "other content");
+    QVERIFY(DecodedImageCache::key(path, "2") != key);
+}
+
+void DecodedImageCacheTest::testImageRoundTrip_data()
+{
+    QTest::addColumn<QImage>("image");
+    QTest::newRow("argb32") << createTestImage(QImage::Format_ARGB32);
+    QTest::newRow("rgb32") << createTestImage(QImage::Format_RGB32);
+    QTest::newRow("rgb888") << createTestImage(QImage::Format_RGB888);
+    QTest::newRow("grayscale8") << createTestImage(QImage::Format_Grayscale8);
+    QTest::newRow("rgba64") << createTestImage(QImage::Format_RGBA64);
+}
+
+void DecodedImageCacheTest::testImageRoundTrip()
+{
+    QFETCH(QImage, image);
+    QTemporaryDir dir;
+    DecodedImageCache cache(dir.path(), CAPACITY);
+
+    QVERIFY(cache.find("key").isNull());
+    cache.insert("key", image);
+    QVERIFY(cache.size() > image.sizeInBytes());
+
+    const QImage found = cache.find("key");
+    QCOMPARE(found.format(), image.format());
+    QCOMPARE(found.size(), image.size());
+    QCOMPARE(found, image);
+}
+
+void DecodedImageCacheTest::testProfileRoundTrip()
+{
+    QTemporaryDir dir;
+    DecodedImageCache cache(dir.path(), CAPACITY);
+    QByteArray profile;
+    QVERIFY(!cache.findProfile("icc", &profile));
+
+    cache.insertProfile("icc", "fake icc data");
+    QVERIFY(cache.findProfile("icc", &profile));
+    QCOMPARE(profile, QByteArray("fake icc data"));
+
+    // A profile entry is not an image
+    QVERIFY(cache.find("icc").isNull());
+
+    // The absence of a profile is remembered too
+    cache.insertProfile("none", QByteArray());
+    profile = "not empty";
+    QVERIFY(cache.findProfile("none", &profile));
+    QVERIFY(profile.isEmpty());
+}
+
+void DecodedImageCacheTest::testTrim()
+{
+    QTemporaryDir dir;
+    DecodedImageCache cache(dir.path(), CAPACITY);
+    // About a tenth of the capacity each
+    const QImage image = createTestImage(QImage::Format_ARGB32, QSize(160, 160));
+
+    for (int i = 0; i < 8; ++i) {
+        cache.insert(QByteArray::number(i), image);
+    }
+    // Use the first entry so that it becomes the most recent one. File times
+    // may have a coarse resolution: wait a bit.
+    QTest::qWait(1100);
+    QVERIFY(!cache.find("0").isNull());
+
+    for (int i = 8; i < 12; ++i) {
+        cache.insert(QByteArray::number(i), image);
+    }
+    QVERIFY(cache.size() <= CAPACITY);
+    QVERIFY(!cache.find("0").isNull());
+    QVERIFY(!cache.find("11").isNull());
+    int removed = 0;
+    for (int i = 1; i < 8; ++i) {
+        if (cache.find(QByteArray::number(i)).isNull()) {
+            ++removed;
+        }
+    }
+    QVERIFY(removed > 0);
+}
+
+void DecodedImageCacheTest::testTooLarge()
+{
+    QTemporaryDir dir;
+    DecodedImageCache cache(dir.path(), CAPACITY);
+    cache.insert("key", createTestImage(QImage::Format_ARGB32, QSize(512, 512)));
+    QVERIFY(cache.find("key").isNull());
+    QCOMPARE(cache.size(), 0);
+}
+
+void DecodedImageCacheTest::testCorruptedEntry()
+{
+    QTemporaryDir dir;
+    DecodedImageCache cache(dir.path(), CAPACITY);
+    cache.insert("key", createTestImage(QImage::Format_ARGB32));
+
+    // Truncate the entry
+    QFile file(dir.filePath(QStringLiteral("key")));
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.resize(file.size() - 1));
+    file.close();
+    QVERIFY(cache.find("key").isNull());
+}
+
+void DecodedImageCacheTest::testInvalidBytesPerLine_data()
+{
+    const QImage image = createTestImage(QImage::Format_ARGB32);
+    QTest::addColumn<qint32>("bytesPerLine");
+    // Shorter than a row of pixels
+    QTest::newRow("too short") << qint32(image.width() * 4 - 4);
+    // Rows go past the end of the file
+    QTest::newRow("too long") << qint32(image.bytesPerLine() * 2);
+    QTest::newRow("negative") << qint32(-image.bytesPerLine());
+}
+
+void DecodedImageCacheTest::testInvalidBytesPerLine()
+{
+    QFETCH(qint32, bytesPerLine);
+    QTemporaryDir dir;
+    DecodedImageCache cache(dir.path(), CAPACITY);
+    cache.insert("key", createTestImage(QImage::Format_ARGB32));
+    QVERIFY(!cache.find("key").isNull());
+
+    // Overwrite the bytesPerLine field of the header, which comes after the
+    // magic, the version, the format, the width and the height
+    QFile file(dir.filePath(QStringLiteral("key")));
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.seek(5 * 4));
+    QCOMPARE(file.write(reinterpret_cast<const char *>(&bytesPerLine), sizeof(bytesPerLine)), qint64(sizeof(bytesPerLine)));
+    file.close();
+    QVERIFY(cache.find("key").isNull());
+}
@@ -252,6 +252,106 @@ void DocumentTest::testLoadDownSampledPng()
     QCOMPARE(stateSpy.mState, Document::Loaded);
 }
 
+/**
+ * Once the image is loaded, down sampled images are generated from it, and
+ * partial edits update them instead of dropping them
+ */
+void DocumentTest::testDownSampleLoadedImage()
+{
+    Document::Ptr doc = DocumentFactory::instance()->load(urlForTestFile("test.png"));
+    doc->waitUntilLoaded();
+    QCOMPARE(doc->loadingState(), Document::Loaded);
+
+    QSignalSpy downSampledImageReadySpy(doc.data(), SIGNAL(downSampledImageReady()));
+    bool ready = doc->prepareDownSampledImageForZoom(0.2);
+    QVERIFY2(!ready, "There should not be a down sampled image at this point");
+    QVERIFY(downSampledImageReadySpy.wait());
+
+    const QImage downSampledImage = doc->downSampledImageForZoom(0.2);
+    QCOMPARE(downSampledImage.size(), doc->size() / 2);
+
+    QImage image = doc->image();
+    const QRect rect(20, 20, 20, 20);
+    {
+        QPainter painter(&image);
+        painter.fillRect(rect, Qt::blue);
+    }
+    doc->editor()->updateImage(image, rect);
+
+    QVERIFY(doc->prepareDownSampledImageForZoom(0.2));
+    const QImage updatedImage = doc->downSampledImageForZoom(0.2);
+    QCOMPARE(updatedImage.size(), downSampledImage.size());
+    QCOMPARE(QColor(updatedImage.pixel(15, 15)), QColor(Qt::blue));
+    QCOMPARE(updatedImage.pixel(60, 40), downSampledImage.pixel(60, 40));
+}
+
+/**
+ * The image is decoded at the size asked for, and the full image is only
+ * loaded when a larger size is asked for
+ */
+void DocumentTest::testPrepareImageForSize()
+{
+    Document::Ptr doc = DocumentFactory::instance()->load(urlForTestFile("orient6.jpg"));
+    while (doc->loadingState() < Document::MetaInfoLoaded) {
+        QTest::qWait(100);
+    }
+    QCOMPARE(doc->loadingState(), Document::MetaInfoLoaded);
+    QVERIFY(doc->imageForSize(doc->size()).isNull());
+
+    QSignalSpy downSampledImageReadySpy(doc.data(), SIGNAL(downSampledImageReady()));
+    const QSize smallSize = doc->size() * 0.3;
+    bool ready = doc->prepareImageForSize(smallSize);
+    QVERIFY2(!ready, "There should not be a decoded image at this point");
+    QVERIFY(downSampledImageReadySpy.wait());
+
+    QVERIFY(doc->prepareImageForSize(smallSize));
+    const QImage smallImage = doc->imageForSize(smallSize);
+    QVERIFY(smallImage.width() >= smallSize.width() - 1);
+    QVERIFY(smallImage.height() >= smallSize.height() - 1);
+    QVERIFY(smallImage.width() < doc->width());
+    QCOMPARE(doc->loadingState(), Document::MetaInfoLoaded);
+
+    // Until it is loaded, the largest image is returned for larger sizes
+    QCOMPARE(doc->imageForSize(doc->size()).cacheKey(), smallImage.cacheKey());
+
+    QSignalSpy loadedSpy(doc.data(), SIGNAL(loaded(QUrl)));
+    ready = doc->prepareImageForSize(doc->size() * 2);
+    QVERIFY2(!ready, "The full image should not be loaded at this point");
+    QVERIFY(loadedSpy.wait());
+    QCOMPARE(doc->loadingState(), Document::Loaded);
+    QCOMPARE(doc->imageForSize(smallSize).size(), doc->size());
+}
+
+/**
+ * Zooming out reuses the image decoded for a larger size instead of decoding
+ * a smaller one
+ */
+void DocumentTest::testPrepareSmallerImageForSize()
+{
+    Document::Ptr doc = DocumentFactory::instance()->load(urlForTestFile("orient6.jpg"));
+    while (doc->loadingState() < Document::MetaInfoLoaded) {
+        QTest::qWait(100);
+    }
+    QCOMPARE(doc->loadingState(), Document::MetaInfoLoaded);
+
+    QSignalSpy downSampledImageReadySpy(doc.data(), SIGNAL(downSampledImageReady()));
+    const QSize largeSize = doc->size() * 0.6;
+    QVERIFY(!doc->prepareImageForSize(largeSize));
+    QVERIFY(downSampledImageReadySpy.wait());
+    const QImage largeImage = doc->imageForSize(largeSize);
+    QVERIFY(largeImage.width() < doc->width());
+
+    downSampledImageReadySpy.clear();
+    const QSize smallSize = doc->size() * 0.3;
+    QVERIFY(doc->prepareImageForSize(smallSize));
+    QCOMPARE(doc->imageForSize(smallSize).cacheKey(), largeImage.cacheKey());
+
+    // Nothing else gets decoded
+    QVERIFY(!downSampledImageReadySpy.wait(500));
+    QCOMPARE(doc->loadingState(), Document::MetaInfoLoaded);
+    QCOMPARE(doc->imageForSize(smallSize).cacheKey(), largeImage.cacheKey());
+}
+
 void DocumentTest::testLoadRemote()
 {
     QUrl url = setUpRemoteTestDir("test.png");
@@ -109,6 +109,9 @@ private Q_SLOTS:
     void testLoadDownSampled();
     void testLoadDownSampled_data();
     void testLoadDownSampledPng();
+    void testDownSampleLoadedImage();
+    void testPrepareImageForSize();
+    void testPrepareSmallerImageForSize();
     void testLoadRemote();
     void testLoadAnimated();
     void testPrepareDownSampledAfterFailure();
@@ -0,0 +1,122 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+
+*/
+#include "imageblendingtest.h"
+
+// Qt
+#include <QImage>
+#include <QRandomGenerator>
+#include <QTest>
+
+// Local
+#include "../lib/imageblending.h"
+
+QTEST_MAIN(ImageBlendingTest)
+
+using namespace Gwenview;
+
+static QImage randomImage(const QSize &size, QImage::Format format, quint32 seed)
+{
+    QRandomGenerator generator(seed);
+    QImage image(size, format);
+    for (int y = 0; y < size.height(); ++y) {
+        quint32 *line = reinterpret_cast<quint32 *>(image.scanLine(y));
+        for (int x = 0; x < size.width(); ++x) {
+            const quint32 alpha = format == QImage::Format_RGB32 ? 255 : generator.bounded(256);
+            // Premultiplied channels are not above alpha
+            const quint32 red = generator.bounded(alpha + 1);
+            const quint32 green = generator.bounded(alpha + 1);
+            const quint32 blue = generator.bounded(alpha + 1);
+            line[x] = (alpha << 24) | (red << 16) | (green << 8) | blue;
+        }
+    }
+    return image;
+}
+
+void ImageBlendingTest::testEnds()
+{
+    const QImage from = randomImage(QSize(37, 11), QImage::Format_ARGB32_Premultiplied, 1);
+    const QImage to = randomImage(QSize(37, 11), QImage::Format_ARGB32_Premultiplied, 2);
+    QImage dst;
+    QVERIFY(ImageBlending::crossFade(from, to, 0, &dst));
+    QCOMPARE(dst, from);
+    QVERIFY(ImageBlending::crossFade(from, to, 1, &dst));
+    QCOMPARE(dst, to);
+}
+
+void ImageBlendingTest::testCrossFade_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<qreal>("progress");
+
+    // Widths which are not a multiple of 4 exercise the scalar tail of the
+    // vectorized loop
+    QTest::newRow("aligned") << 64 << 0.5;
+    QTest::newRow("tail") << 67 << 0.25;
+    QTest::newRow("narrow") << 3 << 0.75;
+    QTest::newRow("almost-done") << 33 << 0.99;
+}
+
+void ImageBlendingTest::testCrossFade()
+{
+    QFETCH(int, width);
+    QFETCH(qreal, progress);
+    const QImage from = randomImage(QSize(width, 5), QImage::Format_ARGB32_Premultiplied, 3);
+    const QImage to = randomImage(QSize(width, 5), QImage::Format_ARGB32_Premultiplied, 4);
+    QImage dst;
+    QVERIFY(ImageBlending::crossFade(from, to, progress, &dst));
+    QCOMPARE(dst.size(), from.size());
+    QCOMPARE(dst.format(), QImage::Format_ARGB32_Premultiplied);
+
+    const int weight = qRound(progress * 256);
+    for (int y = 0; y < from.height(); ++y) {
+        const quint32 *a = reinterpret_cast<const quint32 *>(from.constScanLine(y));
+        const quint32 *b = reinterpret_cast<const quint32 *>(to.constScanLine(y));
+        const quint32 *out = reinterpret_cast<const quint32 *>(dst.constScanLine(y));
+        for (int x = 0; x < width; ++x) {
+            for (int shift = 0; shift < 32; shift += 8) {
+                const int ca = (a[x] >> shift) & 0xff;
+                const int cb = (b[x] >> shift) & 0xff;
+                const int expected = (ca * (256 - weight) + cb * weight) >> 8;
+                QCOMPARE(int((out[x] >> shift) & 0xff), expected);
+            }
+        }
+    }
+}
+
+void ImageBlendingTest::testMixedFormats()
+{
+    const QImage from = randomImage(QSize(10, 10), QImage::Format_RGB32, 5);
+    const QImage to = randomImage(QSize(10, 10), QImage::Format_ARGB32_Premultiplied, 6);
+    QImage dst;
+    QVERIFY(ImageBlending::crossFade(from, to, 0.5, &dst));
+    QCOMPARE(dst.format(), QImage::Format_ARGB32_Premultiplied);
+
+    QVERIFY(ImageBlending::crossFade(from, from, 0.5, &dst));
+    QCOMPARE(dst.format(), QImage::Format_RGB32);
+}
+
+void ImageBlendingTest::testInvalid()
+{
+    const QImage image = randomImage(QSize(10, 10), QImage::Format_RGB32, 7);
+    QImage dst;
+    QVERIFY(!ImageBlending::crossFade(image, randomImage(QSize(11, 10), QImage::Format_RGB32, 8), 0.5, &dst));
+    QVERIFY(!ImageBlending::crossFade(image, image.convertToFormat(QImage::Format_RGB888), 0.5, &dst));
+}
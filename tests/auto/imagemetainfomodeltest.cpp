@@ -60,4 +60,63 @@ void ImageMetaInfoModelTest::testCatchExiv2Errors()
 
     ImageMetaInfoModel model;
     model.setExiv2Image(image.get());
+    // Format all the entries
+    for (int row = 0; row < model.rowCount(); ++row) {
+        model.fetchMore(model.index(row, 0));
+    }
+    QTRY_VERIFY(!model.isLoading());
+}
+
+void ImageMetaInfoModelTest::testLazyExivGroups()
+{
+    std::unique_ptr<Exiv2::Image> image;
+    {
+        Exiv2ImageLoader loader;
+        QVERIFY(loader.load(pathForTestFile("orient6.jpg")));
+        image = loader.popImage();
+    }
+
+    ImageMetaInfoModel model;
+    model.setExiv2Image(image.get());
+
+    // The EXIF group is the second one, after the "General" group
+    const QModelIndex exifIndex = model.index(1, 0);
+    QCOMPARE(model.data(exifIndex).toString(), QStringLiteral("EXIF"));
+
+    // Nothing has been formatted yet, but single keys can be read
+    QCOMPARE(model.rowCount(exifIndex), 0);
+    QVERIFY(model.hasChildren(exifIndex));
+    QVERIFY(model.canFetchMore(exifIndex));
+    QString label;
+    QString value;
+    model.getInfoForKey(QStringLiteral("Exif.Image.Orientation"), &label, &value);
+    QVERIFY(!label.isEmpty());
+    QVERIFY(!value.isEmpty());
+
+    // Expanding the group formats all its entries
+    model.fetchMore(exifIndex);
+    QVERIFY(model.isLoading());
+    QVERIFY(!model.canFetchMore(exifIndex));
+
+    // Single keys can still be read while the group is being formatted
+    QString loadingLabel;
+    QString loadingValue;
+    model.getInfoForKey(QStringLiteral("Exif.Image.Orientation"), &loadingLabel, &loadingValue);
+    QCOMPARE(loadingLabel, label);
+    QCOMPARE(loadingValue, value);
+
+    QTRY_VERIFY(model.rowCount(exifIndex) > 0);
+    QVERIFY(!model.isLoading());
+
+    QString loadedLabel;
+    QString loadedValue;
+    model.getInfoForKey(QStringLiteral("Exif.Image.Orientation"), &loadedLabel, &loadedValue);
+    QCOMPARE(loadedLabel, label);
+    QCOMPARE(loadedValue, value);
+
+    // Switching images cancels pending work
+    model.fetchMore(model.index(3, 0));
+    model.setExiv2Image(nullptr);
+    QVERIFY(!model.isLoading());
+    QCOMPARE(model.rowCount(exifIndex), 0);
 }
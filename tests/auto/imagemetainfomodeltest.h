@@ -33,6 +33,7 @@ class ImageMetaInfoModelTest : public QObject
 
 private Q_SLOTS:
     void testCatchExiv2Errors();
+    void testLazyExivGroups();
 };
 
 #endif // IMAGEMETAINFOMODELTEST_H
@@ -0,0 +1,150 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "imagescalingtest.h"
+
+// Qt
+#include <QImage>
+#include <QTest>
+
+// Local
+#include "../lib/imagescaling.h"
+
+QTEST_MAIN(ImageScalingTest)
+
+using namespace Gwenview;
+
+Q_DECLARE_METATYPE(ImageScaling::Filter)
+
+void ImageScalingTest::testSize()
+{
+    QImage image(300, 200, QImage::Format_RGB32);
+    image.fill(Qt::red);
+
+    QCOMPARE(ImageScaling::scaled(image, QSize(100, 100), ImageScaling::Box).size(), QSize(100, 100));
+    QCOMPARE(ImageScaling::scaled(image, QSize(128, 128), Qt::KeepAspectRatio, ImageScaling::Box).size(), QSize(128, 85));
+    QCOMPARE(ImageScaling::scaled(image, QSize(600, 600), Qt::KeepAspectRatio, ImageScaling::Bilinear).size(), QSize(600, 400));
+    QVERIFY(ImageScaling::scaled(image, QSize(0, 10), ImageScaling::Box).isNull());
+}
+
+void ImageScalingTest::testUniformColor_data()
+{
+    QTest::addColumn<ImageScaling::Filter>("filter");
+    QTest::addColumn<QSize>("size");
+
+    QTest::newRow("nearest-down") << ImageScaling::Nearest << QSize(37, 21);
+    QTest::newRow("box-down") << ImageScaling::Box << QSize(37, 21);
+    QTest::newRow("bilinear-down") << ImageScaling::Bilinear << QSize(37, 21);
+    QTest::newRow("lanczos3-down") << ImageScaling::Lanczos3 << QSize(37, 21);
+    QTest::newRow("bilinear-up") << ImageScaling::Bilinear << QSize(413, 257);
+    QTest::newRow("lanczos3-up") << ImageScaling::Lanczos3 << QSize(413, 257);
+}
+
+void ImageScalingTest::testUniformColor()
+{
+    QFETCH(ImageScaling::Filter, filter);
+    QFETCH(QSize, size);
+
+    const QColor color(12, 140, 250);
+    QImage image(123, 77, QImage::Format_RGB32);
+    image.fill(color);
+
+    const QImage result = ImageScaling::scaled(image, size, filter);
+    QCOMPARE(result.size(), size);
+    for (int y = 0; y < result.height(); ++y) {
+        for (int x = 0; x < result.width(); ++x) {
+            QCOMPARE(result.pixelColor(x, y), color);
+        }
+    }
+}
+
+void ImageScalingTest::testBoxAverage()
+{
+    QImage image(2, 2, QImage::Format_RGB32);
+    image.setPixel(0, 0, qRgb(0, 0, 0));
+    image.setPixel(1, 0, qRgb(100, 0, 0));
+    image.setPixel(0, 1, qRgb(0, 200, 0));
+    image.setPixel(1, 1, qRgb(100, 200, 40));
+
+    const QImage result = ImageScaling::scaled(image, QSize(1, 1), ImageScaling::Box);
+    QCOMPARE(result.pixel(0, 0), qRgb(50, 100, 10));
+}
+
+void ImageScalingTest::testSixteenBitFormat()
+{
+    QImage image(64, 64, QImage::Format_RGBX64);
+    image.fill(QColor::fromRgba64(1000, 30000, 65000));
+
+    const QImage result = ImageScaling::scaled(image, QSize(20, 20), ImageScaling::Box);
+    QCOMPARE(result.format(), QImage::Format_RGBX64);
+    QCOMPARE(result.pixelColor(10, 10).rgba64(), QRgba64::fromRgba64(1000, 30000, 65000, 65535));
+}
+
+void ImageScalingTest::testTransparency()
+{
+    QImage image(50, 50, QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+
+    const QImage result = ImageScaling::scaled(image, QSize(20, 20), ImageScaling::Lanczos3);
+    QCOMPARE(result.format(), QImage::Format_ARGB32_Premultiplied);
+    for (int y = 0; y < result.height(); ++y) {
+        for (int x = 0; x < result.width(); ++x) {
+            QCOMPARE(result.pixel(x, y), 0u);
+        }
+    }
+}
+
+void ImageScalingTest::testLanczosClamping()
+{
+    // A sharp edge between opaque white and half transparent black makes
+    // Lanczos overshoot. Color values must never exceed alpha.
+    QImage image(40, 40, QImage::Format_ARGB32_Premultiplied);
+    image.fill(qRgba(0, 0, 0, 128));
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 20; x < image.width(); ++x) {
+            image.setPixel(x, y, qRgba(255, 255, 255, 255));
+        }
+    }
+
+    const QImage result = ImageScaling::scaled(image, QSize(97, 13), ImageScaling::Lanczos3);
+    for (int y = 0; y < result.height(); ++y) {
+        for (int x = 0; x < result.width(); ++x) {
+            const QRgb pixel = result.pixel(x, y);
+            QVERIFY(qRed(pixel) <= qAlpha(pixel));
+            QVERIFY(qGreen(pixel) <= qAlpha(pixel));
+            QVERIFY(qBlue(pixel) <= qAlpha(pixel));
+        }
+    }
+}
+
+void ImageScalingTest::testSingleThreaded()
+{
+    // Large enough to be split in bands when running in parallel
+    QImage image(1000, 800, QImage::Format_RGB32);
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            image.setPixel(x, y, qRgb(x % 256, y % 256, (x + y) % 256));
+        }
+    }
+
+    const QSize size(301, 199);
+    const QImage parallel = ImageScaling::scaled(image, size, ImageScaling::Lanczos3, ImageScaling::Parallel);
+    const QImage singleThreaded = ImageScaling::scaled(image, size, ImageScaling::Lanczos3, ImageScaling::SingleThreaded);
+    QCOMPARE(singleThreaded, parallel);
+}
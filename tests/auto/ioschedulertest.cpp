@@ -0,0 +1,156 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "ioschedulertest.h"
+
+// STL
+#include <memory>
+
+// Qt
+#include <QFile>
+#include <QMutex>
+#include <QStringList>
+#include <QTest>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+// Local
+#include "../lib/ioscheduler.h"
+
+QTEST_MAIN(IoSchedulerTest)
+
+using namespace Gwenview;
+
+void IoSchedulerTest::initTestCase()
+{
+    QVERIFY(mDir.isValid());
+}
+
+void IoSchedulerTest::cleanup()
+{
+    IoScheduler::instance()->setConcurrencyLimit(mDir.path(), 0);
+}
+
+void IoSchedulerTest::testConcurrencyLimit()
+{
+    const QString path = mDir.path();
+    IoScheduler::instance()->setConcurrencyLimit(path, 1);
+
+    // Requests from the GUI thread always get a slot
+    auto holder = std::make_unique<IoScheduler::Request>(path, IoScheduler::VisibleThumbnail);
+    QVERIFY(holder->isGranted());
+    QCOMPARE(IoScheduler::instance()->activeCount(path), 1);
+
+    QAtomicInt granted = 0;
+    QFuture<void> future = QtConcurrent::run([&] {
+        IoScheduler::Request request(path, IoScheduler::VisibleThumbnail);
+        granted = 1;
+    });
+    QTRY_COMPARE(IoScheduler::instance()->waitingCount(path), 1);
+    QCOMPARE(int(granted), 0);
+
+    holder.reset();
+    future.waitForFinished();
+    QCOMPARE(int(granted), 1);
+    QCOMPARE(IoScheduler::instance()->activeCount(path), 0);
+}
+
+void IoSchedulerTest::testPriorityOrder()
+{
+    const QString path = mDir.path();
+    IoScheduler::instance()->setConcurrencyLimit(path, 1);
+    auto holder = std::make_unique<IoScheduler::Request>(path, IoScheduler::VisibleThumbnail);
+
+    QMutex mutex;
+    QStringList order;
+    auto read = [&](IoScheduler::Priority priority, const QString &name) {
+        IoScheduler::Request request(path, priority);
+        {
+            QMutexLocker locker(&mutex);
+            order << name;
+        }
+    };
+    // Both requests must wait at the same time, whatever the size of the
+    // global pool
+    QThreadPool pool;
+    pool.setMaxThreadCount(2);
+    // Queue the low priority request first
+    QFuture<void> thumbnail = QtConcurrent::run(&pool, read, IoScheduler::VisibleThumbnail, QStringLiteral("thumbnail"));
+    QTRY_COMPARE(IoScheduler::instance()->waitingCount(path), 1);
+    QFuture<void> preload = QtConcurrent::run(&pool, read, IoScheduler::Preload, QStringLiteral("preload"));
+    QTRY_COMPARE(IoScheduler::instance()->waitingCount(path), 2);
+    QVERIFY(order.isEmpty());
+
+    holder.reset();
+    thumbnail.waitForFinished();
+    preload.waitForFinished();
+    QCOMPARE(order, QStringList() << QStringLiteral("preload") << QStringLiteral("thumbnail"));
+}
+
+void IoSchedulerTest::testCancel()
+{
+    const QString path = mDir.path();
+    IoScheduler::instance()->setConcurrencyLimit(path, 1);
+    IoScheduler::Request holder(path, IoScheduler::VisibleThumbnail);
+
+    IoCancellationToken token;
+    QFuture<bool> future = QtConcurrent::run([path, token] {
+        IoScheduler::Request request(path, IoScheduler::Preload, token);
+        return request.isGranted();
+    });
+    QTRY_COMPARE(IoScheduler::instance()->waitingCount(path), 1);
+    QVERIFY(!future.isFinished());
+
+    token.cancel();
+    QVERIFY(token.isCancelled());
+    QVERIFY(!future.result());
+    QCOMPARE(IoScheduler::instance()->activeCount(path), 1);
+    QCOMPARE(IoScheduler::instance()->waitingCount(path), 0);
+}
+
+void IoSchedulerTest::testVisibleImageNeverWaits()
+{
+    const QString path = mDir.path();
+    IoScheduler::instance()->setConcurrencyLimit(path, 1);
+    IoScheduler::Request holder(path, IoScheduler::VisibleThumbnail);
+
+    QFuture<int> future = QtConcurrent::run([path] {
+        IoScheduler::Request request(path, IoScheduler::VisibleImage);
+        return IoScheduler::instance()->activeCount(path);
+    });
+    // Counted, even though it went over the limit
+    QCOMPARE(future.result(), 2);
+}
+
+void IoSchedulerTest::testPrefetch()
+{
+    const QString path = mDir.filePath(QStringLiteral("data"));
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(3 * 1024 * 1024, 'x'));
+    file.close();
+
+    QVERIFY(IoScheduler::instance()->prefetch(path, IoScheduler::Preload).result());
+    QVERIFY(!IoScheduler::instance()->prefetch(mDir.filePath(QStringLiteral("missing")), IoScheduler::Preload).result());
+
+    IoCancellationToken token;
+    token.cancel();
+    QVERIFY(!IoScheduler::instance()->prefetch(path, IoScheduler::Preload, token).result());
+    QCOMPARE(IoScheduler::instance()->activeCount(path), 0);
+}
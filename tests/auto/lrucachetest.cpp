@@ -0,0 +1,126 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+
+*/
+#include "lrucachetest.h"
+
+// Qt
+#include <QTest>
+
+// Local
+#include "../lib/lrucache.h"
+
+QTEST_MAIN(LruCacheTest)
+
+using namespace Gwenview;
+
+using Cache = LruCache<QString, int>;
+
+static QStringList keys(const Cache &cache)
+{
+    QStringList list;
+    for (const auto &entry : cache) {
+        list << entry.key;
+    }
+    return list;
+}
+
+void LruCacheTest::testFind()
+{
+    Cache cache(10);
+    QVERIFY(!cache.find(QStringLiteral("a")));
+    cache.insert(QStringLiteral("a"), 1);
+    const int *value = cache.find(QStringLiteral("a"));
+    QVERIFY(value);
+    QCOMPARE(*value, 1);
+    QCOMPARE(cache.size(), 1);
+    QCOMPARE(cache.hitCount(), quint64(1));
+    QCOMPARE(cache.missCount(), quint64(1));
+
+    // peek() does not count
+    QVERIFY(cache.peek(QStringLiteral("a")));
+    QVERIFY(!cache.peek(QStringLiteral("b")));
+    QCOMPARE(cache.hitCount(), quint64(1));
+    QCOMPARE(cache.missCount(), quint64(1));
+
+    cache.resetCounters();
+    QCOMPARE(cache.hitCount(), quint64(0));
+    QCOMPARE(cache.missCount(), quint64(0));
+}
+
+void LruCacheTest::testEviction()
+{
+    Cache cache(3);
+    cache.insert(QStringLiteral("a"), 1);
+    cache.insert(QStringLiteral("b"), 2);
+    cache.insert(QStringLiteral("c"), 3);
+    QCOMPARE(keys(cache), QStringList({QStringLiteral("c"), QStringLiteral("b"), QStringLiteral("a")}));
+
+    // Using "a" makes "b" the least recently used entry
+    QVERIFY(cache.find(QStringLiteral("a")));
+    cache.insert(QStringLiteral("d"), 4);
+    QCOMPARE(cache.size(), 3);
+    QVERIFY(!cache.contains(QStringLiteral("b")));
+    QCOMPARE(keys(cache), QStringList({QStringLiteral("d"), QStringLiteral("a"), QStringLiteral("c")}));
+}
+
+void LruCacheTest::testReplace()
+{
+    Cache cache(2);
+    cache.insert(QStringLiteral("a"), 1);
+    cache.insert(QStringLiteral("b"), 2);
+    int *value = cache.insert(QStringLiteral("a"), 10);
+    QCOMPARE(*value, 10);
+    QCOMPARE(cache.size(), 2);
+    QCOMPARE(keys(cache), QStringList({QStringLiteral("a"), QStringLiteral("b")}));
+
+    // Values can be updated in place
+    *cache.find(QStringLiteral("b")) = 20;
+    QCOMPARE(*cache.peek(QStringLiteral("b")), 20);
+}
+
+void LruCacheTest::testRemove()
+{
+    Cache cache(3);
+    cache.insert(QStringLiteral("a"), 1);
+    cache.insert(QStringLiteral("b"), 2);
+    QVERIFY(cache.remove(QStringLiteral("a")));
+    QVERIFY(!cache.remove(QStringLiteral("a")));
+    QCOMPARE(keys(cache), QStringList({QStringLiteral("b")}));
+
+    cache.clear();
+    QVERIFY(cache.isEmpty());
+    QVERIFY(cache.begin() == cache.end());
+}
+
+void LruCacheTest::testSetCapacity()
+{
+    Cache cache(4);
+    for (int i = 0; i < 4; ++i) {
+        cache.insert(QString::number(i), i);
+    }
+    cache.setCapacity(2);
+    QCOMPARE(cache.capacity(), 2);
+    QCOMPARE(keys(cache), QStringList({QStringLiteral("3"), QStringLiteral("2")}));
+
+    // The capacity is at least 1
+    cache.setCapacity(0);
+    QCOMPARE(cache.capacity(), 1);
+    QCOMPARE(keys(cache), QStringList({QStringLiteral("3")}));
+}
@@ -0,0 +1,157 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "memoryaccountingtest.h"
+
+// Qt
+#include <QTest>
+
+// Local
+#include "../lib/memoryaccounting.h"
+
+QTEST_MAIN(MemoryAccountingTest)
+
+using namespace Gwenview;
+
+static MemoryAccounting::Entry findEntry(const QString &name)
+{
+    const QVector<MemoryAccounting::Entry> entries = MemoryAccounting::instance()->usage();
+    for (const MemoryAccounting::Entry &entry : entries) {
+        if (entry.name == name) {
+            return entry;
+        }
+    }
+    return {QString(), 0, 0};
+}
+
+void MemoryAccountingTest::testUsage()
+{
+    MemoryAccounting *accounting = MemoryAccounting::instance();
+    const qint64 initialTotal = accounting->totalUsage();
+    const int id1 = accounting->registerCache(QStringLiteral("testUsage small"), [] {
+        return qint64(100);
+    });
+    const int id2 = accounting->registerCache(QStringLiteral("testUsage small"), [] {
+        return qint64(200);
+    });
+    const int id3 = accounting->registerCache(QStringLiteral("testUsage large"), [] {
+        return qint64(1) << 40;
+    });
+
+    // Caches of the same name are reported together
+    const MemoryAccounting::Entry small = findEntry(QStringLiteral("testUsage small"));
+    QCOMPARE(small.count, 2);
+    QCOMPARE(small.bytes, qint64(300));
+    QCOMPARE(accounting->totalUsage(), initialTotal + 300 + (qint64(1) << 40));
+
+    // Largest first
+    const QVector<MemoryAccounting::Entry> entries = accounting->usage();
+    QCOMPARE(entries.first().name, QStringLiteral("testUsage large"));
+
+    accounting->unregisterCache(id1);
+    accounting->unregisterCache(id2);
+    accounting->unregisterCache(id3);
+}
+
+void MemoryAccountingTest::testUnregister()
+{
+    MemoryAccounting *accounting = MemoryAccounting::instance();
+    const int id = accounting->registerCache(QStringLiteral("testUnregister"), [] {
+        return qint64(42);
+    });
+    QCOMPARE(findEntry(QStringLiteral("testUnregister")).bytes, qint64(42));
+    accounting->unregisterCache(id);
+    QCOMPARE(findEntry(QStringLiteral("testUnregister")).count, 0);
+}
+
+void MemoryAccountingTest::testShed()
+{
+    MemoryAccounting *accounting = MemoryAccounting::instance();
+    qint64 usage = 1000;
+    const int id = accounting->registerCache(
+        QStringLiteral("testShed"),
+        [&usage] {
+            return usage;
+        },
+        [&usage] {
+            usage = 0;
+        });
+    // Caches without a shed function are left alone
+    const int id2 = accounting->registerCache(QStringLiteral("testShed kept"), [] {
+        return qint64(10);
+    });
+
+    accounting->shed();
+    QCOMPARE(usage, qint64(0));
+    QCOMPARE(findEntry(QStringLiteral("testShed")).bytes, qint64(0));
+    QCOMPARE(findEntry(QStringLiteral("testShed kept")).bytes, qint64(10));
+
+    accounting->unregisterCache(id);
+    accounting->unregisterCache(id2);
+}
+
+void MemoryAccountingTest::testShedBytes()
+{
+    MemoryAccounting *accounting = MemoryAccounting::instance();
+    qint64 largeUsage = qint64(2) << 40;
+    qint64 smallUsage = qint64(1) << 40;
+    const int largeId = accounting->registerCache(
+        QStringLiteral("testShedBytes large"),
+        [&largeUsage] {
+            return largeUsage;
+        },
+        [&largeUsage] {
+            largeUsage = 0;
+        });
+    const int smallId = accounting->registerCache(
+        QStringLiteral("testShedBytes small"),
+        [&smallUsage] {
+            return smallUsage;
+        },
+        [&smallUsage] {
+            smallUsage = 0;
+        });
+
+    // Shedding the largest cache frees enough, the other one is kept
+    const qint64 freed = accounting->shed(qint64(1) << 40);
+    QCOMPARE(freed, qint64(2) << 40);
+    QCOMPARE(largeUsage, qint64(0));
+    QCOMPARE(smallUsage, qint64(1) << 40);
+
+    // Both are shed when the first one does not free enough
+    largeUsage = qint64(2) << 40;
+    QCOMPARE(accounting->shed(qint64(3) << 40), qint64(3) << 40);
+    QCOMPARE(largeUsage, qint64(0));
+    QCOMPARE(smallUsage, qint64(0));
+
+    accounting->unregisterCache(largeId);
+    accounting->unregisterCache(smallId);
+}
+
+void MemoryAccountingTest::testReport()
+{
+    MemoryAccounting *accounting = MemoryAccounting::instance();
+    const int id = accounting->registerCache(QStringLiteral("testReport"), [] {
+        return qint64(2048);
+    });
+    const QString report = accounting->report();
+    QVERIFY2(report.contains(QStringLiteral("testReport (1)")), qPrintable(report));
+    QVERIFY2(report.contains(QStringLiteral("Total:")), qPrintable(report));
+    accounting->unregisterCache(id);
+}
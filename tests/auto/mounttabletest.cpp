@@ -0,0 +1,107 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "mounttabletest.h"
+
+// Qt
+#include <QTest>
+#include <QUrl>
+
+// Local
+#include "../lib/mounttable.h"
+
+QTEST_MAIN(MountTableTest)
+
+using namespace Gwenview;
+
+static const char *MOUNT_INFO =
+    "22 1 0:21 / / rw,relatime shared:1 - tmpfs rootfs rw\n"
+    "25 22 0:23 / /proc rw,nosuid,nodev,noexec,relatime shared:12 - proc proc rw\n"
+    "30 22 0:26 / /home rw,relatime shared:2 - tmpfs home rw\n"
+    "40 30 0:45 / /home/user/Photos\\040NAS rw,relatime shared:30 - nfs4 nas:/photos rw,vers=4.2\n"
+    "41 22 0:46 / /mnt/cdrom ro,relatime shared:31 - tmpfs cdrom ro\n"
+    "42 22 0:47 / /mnt/share rw,relatime shared:32 - cifs //server/share rw\n"
+    // Mounted over /mnt/share, this one is visible
+    "43 22 0:48 / /mnt/share rw,relatime shared:33 - fuse.sshfs user@host:/ rw\n"
+    "malformed line\n";
+
+static QVector<MountInfo> testMounts()
+{
+    return MountTable::parseMountInfo(QByteArray(MOUNT_INFO));
+}
+
+void MountTableTest::testParseMountInfo()
+{
+    const QVector<MountInfo> mounts = testMounts();
+    QCOMPARE(mounts.count(), 7);
+
+    // Innermost mounts come first
+    QCOMPARE(mounts.first().mountPoint, QStringLiteral("/home/user/Photos NAS"));
+    QCOMPARE(mounts.last().mountPoint, QStringLiteral("/"));
+
+    const MountInfo nas = mounts.first();
+    QCOMPARE(nas.fsType, QStringLiteral("nfs4"));
+    QCOMPARE(nas.device, QStringLiteral("nas:/photos"));
+    QVERIFY(nas.isNetwork());
+    QVERIFY(!nas.readOnly);
+    QVERIFY(nas.recommendedConcurrency() <= 2);
+
+    const MountInfo home = MountTable::findMount(mounts, QStringLiteral("/home"));
+    QCOMPARE(home.deviceClass, MountInfo::SolidStateDevice);
+    QVERIFY(home.recommendedConcurrency() >= 2);
+
+    QVERIFY(MountTable::findMount(mounts, QStringLiteral("/mnt/cdrom")).readOnly);
+}
+
+void MountTableTest::testFindMount_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<QString>("mountPoint");
+    QTest::addColumn<QString>("fsType");
+
+    QTest::newRow("root") << "/" << "/" << "tmpfs";
+    QTest::newRow("file-in-root") << "/etc/fstab" << "/" << "tmpfs";
+    QTest::newRow("mount-point") << "/home" << "/home" << "tmpfs";
+    QTest::newRow("in-home") << "/home/user/image.png" << "/home" << "tmpfs";
+    QTest::newRow("nested") << "/home/user/Photos NAS/2022/image.jpg" << "/home/user/Photos NAS" << "nfs4";
+    QTest::newRow("prefix-is-not-parent") << "/home/user/Photos NAS 2/image.jpg" << "/home" << "tmpfs";
+    QTest::newRow("mounted-over") << "/mnt/share/image.jpg" << "/mnt/share" << "fuse.sshfs";
+}
+
+void MountTableTest::testFindMount()
+{
+    QFETCH(QString, path);
+    QFETCH(QString, mountPoint);
+    QFETCH(QString, fsType);
+
+    const MountInfo mount = MountTable::findMount(testMounts(), path);
+    QVERIFY(mount.isValid());
+    QCOMPARE(mount.mountPoint, mountPoint);
+    QCOMPARE(mount.fsType, fsType);
+}
+
+void MountTableTest::testMountForUrl()
+{
+    QVERIFY(!MountTable::mountForUrl(QUrl(QStringLiteral("https://example.com/image.jpg"))).isValid());
+#ifdef Q_OS_LINUX
+    const MountInfo mount = MountTable::mountForUrl(QUrl::fromLocalFile(QStringLiteral("/")));
+    QVERIFY(mount.isValid());
+    QCOMPARE(mount.mountPoint, QStringLiteral("/"));
+#endif
+}
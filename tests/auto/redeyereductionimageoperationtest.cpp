@@ -0,0 +1,88 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+// Qt
+#include <QEventLoop>
+#include <QImage>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QUndoStack>
+
+// Local
+#include "../lib/document/documentfactory.h"
+#include "../lib/redeyereduction/redeyereductionimageoperation.h"
+
+#include "redeyereductionimageoperationtest.h"
+
+QTEST_MAIN(RedEyeReductionImageOperationTest)
+
+using namespace Gwenview;
+
+static void waitForAllTasksDone(const Document::Ptr &doc)
+{
+    QEventLoop loop;
+    QObject::connect(doc.data(), &Document::allTasksDone, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+void RedEyeReductionImageOperationTest::initTestCase()
+{
+    qRegisterMetaType<QUrl>("QUrl");
+}
+
+void RedEyeReductionImageOperationTest::init()
+{
+    DocumentFactory::instance()->clearCache();
+}
+
+void RedEyeReductionImageOperationTest::testUndoRedo()
+{
+    // An image larger than a tile, so that the edit covers a few tiles out
+    // of many
+    QImage image(1000, 800, QImage::Format_RGB32);
+    image.fill(QColor(220, 40, 40));
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath(QStringLiteral("red.png"));
+    QVERIFY(image.save(path, "png"));
+
+    Document::Ptr doc = DocumentFactory::instance()->load(QUrl::fromLocalFile(path));
+    doc->startLoadingFullImage();
+    doc->waitUntilLoaded();
+    // Use the loaded image as reference, its format may differ
+    const QImage original = doc->image();
+    QCOMPARE(original.size(), image.size());
+
+    const QRectF rect(200, 200, 300, 300);
+    auto op = new RedEyeReductionImageOperation(rect);
+    op->applyToDocument(doc);
+    waitForAllTasksDone(doc);
+
+    QImage expected = original;
+    RedEyeReductionImageOperation::apply(&expected, rect);
+    QVERIFY(expected != original);
+    const QImage edited = doc->image();
+    QCOMPARE(edited, expected);
+
+    doc->undoStack()->undo();
+    QCOMPARE(doc->image(), original);
+
+    doc->undoStack()->redo();
+    QCOMPARE(doc->image(), edited);
+}
@@ -0,0 +1,137 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "slideshowtest.h"
+
+// Qt
+#include <QStandardPaths>
+#include <QTest>
+#include <QUrl>
+
+// Local
+#include "../lib/gwenviewconfig.h"
+#include "../lib/slideshow.h"
+
+QTEST_MAIN(SlideShowTest)
+
+using namespace Gwenview;
+
+static QList<QUrl> createUrls(int count)
+{
+    QList<QUrl> urls;
+    for (int i = 0; i < count; ++i) {
+        urls << QUrl::fromLocalFile(QStringLiteral("/tmp/image%1.png").arg(i));
+    }
+    return urls;
+}
+
+void SlideShowTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    GwenviewConfig::setInterval(5);
+}
+
+void SlideShowTest::testUpcomingUrls_data()
+{
+    QTest::addColumn<bool>("loop");
+    QTest::addColumn<int>("count");
+    QTest::addColumn<QList<int>>("expected");
+
+    QTest::newRow("next") << false << 1 << QList<int>{3};
+    QTest::newRow("until-end") << false << 4 << QList<int>{3, 4};
+    QTest::newRow("loop") << true << 4 << QList<int>{3, 4, 0, 1};
+    // Around the list, but never back to the current url
+    QTest::newRow("loop-short") << true << 10 << QList<int>{3, 4, 0, 1};
+}
+
+void SlideShowTest::testUpcomingUrls()
+{
+    QFETCH(bool, loop);
+    QFETCH(int, count);
+    QFETCH(QList<int>, expected);
+    GwenviewConfig::setRandom(false);
+    GwenviewConfig::setLoop(loop);
+
+    const QList<QUrl> urls = createUrls(5);
+    SlideShow slideShow(nullptr);
+    slideShow.setCurrentUrl(urls.at(2));
+    slideShow.start(urls);
+    QVERIFY(slideShow.isRunning());
+
+    QList<QUrl> expectedUrls;
+    for (int index : expected) {
+        expectedUrls << urls.at(index);
+    }
+    QCOMPARE(slideShow.upcomingUrls(count), expectedUrls);
+}
+
+void SlideShowTest::testUpcomingUrlsFollowPlayback_data()
+{
+    QTest::addColumn<bool>("random");
+    QTest::addColumn<bool>("loop");
+
+    QTest::newRow("ordered") << false << true;
+    QTest::newRow("random") << true << false;
+    QTest::newRow("random-loop") << true << true;
+}
+
+void SlideShowTest::testUpcomingUrlsFollowPlayback()
+{
+    QFETCH(bool, random);
+    QFETCH(bool, loop);
+    GwenviewConfig::setRandom(random);
+    GwenviewConfig::setLoop(loop);
+
+    const QList<QUrl> urls = createUrls(20);
+    SlideShow slideShow(nullptr);
+    connect(&slideShow, &SlideShow::goToUrl, &slideShow, &SlideShow::setCurrentUrl);
+    slideShow.setCurrentUrl(urls.first());
+    slideShow.start(urls);
+
+    // Go through more than one round, to check the next round is planned
+    // ahead when looping
+    for (int step = 0; step < 30 && slideShow.isRunning(); ++step) {
+        const QList<QUrl> upcoming = slideShow.upcomingUrls(4);
+        for (const QUrl &url : upcoming) {
+            QMetaObject::invokeMethod(&slideShow, "goToNextUrl");
+            QCOMPARE(slideShow.currentUrl(), url);
+        }
+        if (upcoming.isEmpty()) {
+            QVERIFY(!loop);
+            QMetaObject::invokeMethod(&slideShow, "goToNextUrl");
+            QVERIFY(!slideShow.isRunning());
+        }
+    }
+}
+
+void SlideShowTest::testRemainingTime()
+{
+    GwenviewConfig::setRandom(false);
+    const QList<QUrl> urls = createUrls(3);
+    SlideShow slideShow(nullptr);
+    slideShow.setCurrentUrl(urls.first());
+    QCOMPARE(slideShow.remainingTime(), -1);
+
+    slideShow.start(urls);
+    QVERIFY(slideShow.remainingTime() > 4000);
+    QVERIFY(slideShow.remainingTime() <= 5000);
+
+    slideShow.pause();
+    QCOMPARE(slideShow.remainingTime(), -1);
+}
@@ -284,3 +284,38 @@ void ThumbnailProviderTest::testRemoveItemsWhileGenerating()
     provider.removeItems(list);
     loop.exec();
 }
+
+void ThumbnailProviderTest::testGenerateAllSizes()
+{
+    GwenviewConfig::setGenerateAllThumbnailSizes(true);
+
+    KFileItemList list;
+    list << KFileItem(QUrl("file://" + QDir(mSandBox.mPath).absoluteFilePath("red.png")));
+
+    ThumbnailProvider provider;
+    provider.setThumbnailGroup(ThumbnailGroup::Large);
+    provider.appendItems(list);
+    QSignalSpy spy(&provider, SIGNAL(thumbnailLoaded(KFileItem, QPixmap, QSize, qulonglong)));
+    syncRun(&provider);
+    while (!ThumbnailProvider::isThumbnailWriterEmpty()) {
+        QTest::qWait(100);
+    }
+    GwenviewConfig::setGenerateAllThumbnailSizes(false);
+
+    // The emitted thumbnail is the one for the requested group
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(qvariant_cast<QPixmap>(spy.at(0).at(1)).size(), QSize(256, 170));
+
+    // Smaller groups have been stored as well, larger ones are not decoded
+    const QDir largeDir(ThumbnailProvider::thumbnailBaseDir(ThumbnailGroup::Large));
+    const QStringList largeList = largeDir.entryList(QStringList("*.png"));
+    QCOMPARE(largeList.count(), 1);
+    const QDir normalDir(ThumbnailProvider::thumbnailBaseDir(ThumbnailGroup::Normal));
+    const QStringList normalList = normalDir.entryList(QStringList("*.png"));
+    QCOMPARE(normalList, largeList);
+    QImage normalThumb;
+    QVERIFY(normalThumb.load(normalDir.filePath(normalList.first())));
+    QCOMPARE(normalThumb.size(), QSize(128, 85));
+    QCOMPARE(normalThumb.text("Thumb::Image::Width"), QStringLiteral("300"));
+    QCOMPARE(QDir(ThumbnailProvider::thumbnailBaseDir(ThumbnailGroup::XLarge)).entryList(QStringList("*.png")).count(), 0);
+}
@@ -0,0 +1,108 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "tiledimagetest.h"
+
+// Qt
+#include <QImage>
+#include <QPainter>
+#include <QTest>
+
+// Local
+#include "../lib/document/tiledimage.h"
+
+QTEST_MAIN(TiledImageTest)
+
+using namespace Gwenview;
+
+static QImage createTestImage()
+{
+    QImage image(1000, 600, QImage::Format_RGB32);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            line[x] = qRgb(x % 256, y % 256, (x + y) % 256);
+        }
+    }
+    return image;
+}
+
+void TiledImageTest::testTilesForRect()
+{
+    const QImage image = createTestImage();
+
+    // Inside a single tile
+    TiledImage tiles(image, QRect(10, 10, 20, 20));
+    QCOMPARE(tiles.tileCount(), 1);
+    QCOMPARE(tiles.boundingRect(), QRect(0, 0, 256, 256));
+
+    // Across tiles, including the partial ones on the image edges
+    tiles = TiledImage(image, QRect(250, 500, 600, 200));
+    QCOMPARE(tiles.tileCount(), 8);
+    QCOMPARE(tiles.boundingRect(), QRect(0, 256, 1000, 344));
+
+    // Outside of the image
+    tiles = TiledImage(image, QRect(2000, 0, 10, 10));
+    QVERIFY(tiles.isEmpty());
+}
+
+void TiledImageTest::testToImage()
+{
+    const QImage image = createTestImage();
+    const QRect rect(300, 200, 300, 100);
+    TiledImage tiles(image, rect);
+    const QRect bounds = tiles.boundingRect();
+    QCOMPARE(bounds, QRect(256, 0, 512, 512));
+
+    QImage region = tiles.toImage();
+    QCOMPARE(region, image.copy(bounds));
+
+    region.fill(Qt::black);
+    tiles.setImage(region);
+    QCOMPARE(tiles.toImage(), region);
+}
+
+void TiledImageTest::testSwap()
+{
+    const QImage original = createTestImage();
+    QImage image = original;
+    const QRect rect(700, 400, 50, 50);
+
+    TiledImage tiles(image, rect);
+    QImage region = tiles.toImage();
+    {
+        QPainter painter(&region);
+        painter.fillRect(rect.translated(-tiles.boundingRect().topLeft()), Qt::red);
+    }
+    tiles.setImage(region);
+
+    // Apply the edit: tiles now hold the original pixels
+    tiles.swap(&image);
+    QCOMPARE(QColor(image.pixel(710, 410)), QColor(Qt::red));
+    QCOMPARE(image.pixel(10, 10), original.pixel(10, 10));
+    QCOMPARE(image.copy(QRect(0, 0, 512, 600)), original.copy(QRect(0, 0, 512, 600)));
+
+    // Undo
+    tiles.swap(&image);
+    QCOMPARE(image, original);
+
+    // Redo
+    tiles.swap(&image);
+    QCOMPARE(QColor(image.pixel(710, 410)), QColor(Qt::red));
+}
@@ -0,0 +1,156 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "tracingtest.h"
+
+// Qt
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSet>
+#include <QTest>
+#include <QThread>
+
+// Local
+#include "../lib/tracing.h"
+
+QTEST_MAIN(TracingTest)
+
+using namespace Gwenview;
+
+static QJsonArray completeEvents()
+{
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(Tracing::chromeTraceJson(), &error);
+    if (error.error != QJsonParseError::NoError) {
+        qWarning() << error.errorString();
+        return {};
+    }
+    QJsonArray events;
+    const QJsonArray traceEvents = document.object().value(QStringLiteral("traceEvents")).toArray();
+    for (const QJsonValue &value : traceEvents) {
+        if (value.toObject().value(QStringLiteral("ph")).toString() == QLatin1String("X")) {
+            events.append(value);
+        }
+    }
+    return events;
+}
+
+void TracingTest::init()
+{
+    Tracing::clear();
+    Tracing::setEnabled(true);
+}
+
+void TracingTest::cleanup()
+{
+    Tracing::setEnabled(false);
+}
+
+void TracingTest::testDisabled()
+{
+    Tracing::setEnabled(false);
+    {
+        GV_TRACE_SPAN("disabled", "test");
+    }
+    QVERIFY(completeEvents().isEmpty());
+}
+
+void TracingTest::testSpans()
+{
+    {
+        GV_TRACE_SPAN("outer", "test");
+        GV_TRACE_SPAN("inner", "test");
+        QThread::msleep(2);
+    }
+    const QJsonArray events = completeEvents();
+    QCOMPARE(events.size(), 2);
+
+    // Inner spans end first
+    const QJsonObject inner = events[0].toObject();
+    const QJsonObject outer = events[1].toObject();
+    QCOMPARE(inner.value(QStringLiteral("name")).toString(), QStringLiteral("inner"));
+    QCOMPARE(outer.value(QStringLiteral("name")).toString(), QStringLiteral("outer"));
+    QCOMPARE(outer.value(QStringLiteral("cat")).toString(), QStringLiteral("test"));
+    QVERIFY(inner.value(QStringLiteral("dur")).toDouble() >= 2000);
+    QVERIFY(outer.value(QStringLiteral("ts")).toDouble() <= inner.value(QStringLiteral("ts")).toDouble());
+    QVERIFY(outer.value(QStringLiteral("dur")).toDouble() >= inner.value(QStringLiteral("dur")).toDouble());
+}
+
+void TracingTest::testThreads()
+{
+    const int threadCount = 4;
+    const int spanCount = 100;
+    QList<QThread *> threads;
+    for (int i = 0; i < threadCount; ++i) {
+        QThread *thread = QThread::create([] {
+            for (int j = 0; j < spanCount; ++j) {
+                GV_TRACE_SPAN("worker", "test");
+            }
+        });
+        thread->setObjectName(QStringLiteral("Worker %1").arg(i));
+        threads << thread;
+        thread->start();
+    }
+    for (QThread *thread : qAsConst(threads)) {
+        QVERIFY(thread->wait(5000));
+        delete thread;
+    }
+
+    QCOMPARE(completeEvents().size(), threadCount * spanCount);
+
+    const QJsonObject root = QJsonDocument::fromJson(Tracing::chromeTraceJson()).object();
+    QSet<QString> threadNames;
+    const QJsonArray traceEvents = root.value(QStringLiteral("traceEvents")).toArray();
+    for (const QJsonValue &value : traceEvents) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QStringLiteral("name")).toString() == QLatin1String("thread_name")) {
+            threadNames << event.value(QStringLiteral("args")).toObject().value(QStringLiteral("name")).toString();
+        }
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        QVERIFY(threadNames.contains(QStringLiteral("Worker %1").arg(i)));
+    }
+}
+
+void TracingTest::testRingOverflow()
+{
+    // More than the capacity of a thread buffer
+    const int spanCount = 20000;
+    for (int i = 0; i < spanCount; ++i) {
+        GV_TRACE_SPAN("span", "test");
+    }
+    const int size = completeEvents().size();
+    QVERIFY(size > 0);
+    QVERIFY(size < spanCount);
+}
+
+void TracingTest::testClear()
+{
+    {
+        GV_TRACE_SPAN("span", "test");
+    }
+    QCOMPARE(completeEvents().size(), 1);
+    Tracing::clear();
+    QVERIFY(completeEvents().isEmpty());
+    {
+        GV_TRACE_SPAN("span", "test");
+    }
+    QCOMPARE(completeEvents().size(), 1);
+}
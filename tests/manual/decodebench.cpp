@@ -0,0 +1,340 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#include "decodebench.h"
+
+// STL
+#include <memory>
+
+// Qt
+#include <QBuffer>
+#include <QColorSpace>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QSignalSpy>
+#include <QStandardPaths>
+#include <QTest>
+#include <QUrl>
+#include <QtEndian>
+
+// Exiv2
+#include <exiv2/image.hpp>
+
+// Local
+#include <config-gwenview.h>
+#include <lib/cms/cmsprofile.h>
+#include <lib/document/documentfactory.h>
+#include <lib/exiv2imageloader.h>
+#include <lib/gwenviewconfig.h>
+#include <lib/jpegcontent.h>
+#ifdef HAVE_FITS
+#include <lib/imageformats/fitsformat/fitsdata.h>
+#endif
+
+QTEST_MAIN(DecodeBench)
+
+using namespace Gwenview;
+
+static const QSize CORPUS_SIZES[] = {{640, 480}, {1920, 1080}, {4000, 3000}};
+
+// Size of the scaled reads, a common screen size
+static const QSize SCALED_SIZE(1280, 800);
+
+static const qreal DOWN_SAMPLED_ZOOM = 0.25;
+
+// Formats Qt decodes without the plugins built into the application
+static const QByteArrayList QT_IMAGE_FORMATS = {"jpeg", "png"};
+
+/**
+ * Creates an image with gradients and some noise, so that it compresses
+ * like a photo rather than like a flat color
+ */
+static QImage createImage(const QSize &size)
+{
+    QImage image(size, QImage::Format_RGB32);
+    quint32 seed = 1;
+    for (int y = 0; y < size.height(); ++y) {
+        auto *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < size.width(); ++x) {
+            seed = seed * 1103515245 + 12345;
+            const int noise = int((seed >> 16) & 0x1f) - 16;
+            line[x] = qRgb(qBound(0, x * 255 / size.width() + noise, 255),
+                           qBound(0, y * 255 / size.height() + noise, 255),
+                           qBound(0, (x + y) * 255 / (size.width() + size.height()) - noise, 255));
+        }
+    }
+    // Lets the profile extraction find something
+    image.setColorSpace(QColorSpace::SRgb);
+    return image;
+}
+
+#ifdef HAVE_FITS
+static QByteArray fitsCard(const QByteArray &keyword, const QByteArray &value)
+{
+    QByteArray card = keyword.leftJustified(8, ' ');
+    if (!value.isEmpty()) {
+        card += "= " + value.rightJustified(20, ' ');
+    }
+    return card.leftJustified(80, ' ');
+}
+
+/**
+ * Writes a 16 bit grayscale FITS file, the format astronomy cameras produce
+ */
+static bool writeFits(const QString &path, const QImage &image)
+{
+    const int blockSize = 2880;
+    QByteArray data = fitsCard("SIMPLE", "T") + fitsCard("BITPIX", "16") + fitsCard("NAXIS", "2")
+        + fitsCard("NAXIS1", QByteArray::number(image.width())) + fitsCard("NAXIS2", QByteArray::number(image.height())) + fitsCard("END", QByteArray());
+    data = data.leftJustified((data.size() + blockSize - 1) / blockSize * blockSize, ' ');
+
+    const QImage gray = image.convertToFormat(QImage::Format_Grayscale16);
+    QByteArray pixels(gray.width() * gray.height() * 2, Qt::Uninitialized);
+    auto *out = reinterpret_cast<qint16 *>(pixels.data());
+    for (int y = 0; y < gray.height(); ++y) {
+        const auto *line = reinterpret_cast<const quint16 *>(gray.constScanLine(y));
+        for (int x = 0; x < gray.width(); ++x) {
+            // FITS stores signed big endian values
+            qToBigEndian<qint16>(qint16(line[x] - 32768), out++);
+        }
+    }
+    data += pixels;
+    data += QByteArray((blockSize - pixels.size() % blockSize) % blockSize, '\0');
+
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+}
+#endif
+
+static QByteArray readFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.readAll();
+}
+
+static QByteArray formatForPath(const QString &path)
+{
+    return path.section(QLatin1Char('.'), -1).toLatin1();
+}
+
+void DecodeBench::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(mCorpusDir.isValid());
+    for (const QSize &size : CORPUS_SIZES) {
+        const QImage image = createImage(size);
+        const QString baseName = mCorpusDir.path() + QStringLiteral("/%1x%2.").arg(size.width()).arg(size.height());
+        for (const char *format : {"jpeg", "png"}) {
+            const QString path = baseName + QLatin1String(format);
+            QVERIFY2(image.save(path, format, format == QByteArrayLiteral("jpeg") ? 90 : -1), qPrintable(path));
+            mCorpus << path;
+        }
+#ifdef HAVE_FITS
+        const QString path = baseName + QStringLiteral("fits");
+        QVERIFY2(writeFits(path, image), qPrintable(path));
+        mCorpus << path;
+#endif
+    }
+}
+
+void DecodeBench::init()
+{
+    // Measure decoding, not the on-disk cache of decoded images
+    GwenviewConfig::setDecodedImageCacheEnabled(false);
+    DocumentFactory::instance()->clearCache();
+}
+
+void DecodeBench::addCorpusRows(const QByteArrayList &formats)
+{
+    QTest::addColumn<QString>("path");
+    for (const QString &path : qAsConst(mCorpus)) {
+        if (formats.contains(formatForPath(path))) {
+            const QString name = formatForPath(path) + QLatin1Char('-') + QFileInfo(path).completeBaseName();
+            QTest::newRow(qPrintable(name)) << path;
+        }
+    }
+}
+
+void DecodeBench::benchmarkMetaInfo_data()
+{
+    addCorpusRows(QT_IMAGE_FORMATS);
+}
+
+void DecodeBench::benchmarkMetaInfo()
+{
+    QFETCH(QString, path);
+    const QUrl url = QUrl::fromLocalFile(path);
+    QBENCHMARK {
+        DocumentFactory::instance()->clearCache();
+        Document::Ptr doc = DocumentFactory::instance()->load(url);
+        while (doc->loadingState() < Document::MetaInfoLoaded) {
+            QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+        }
+        QVERIFY(doc->loadingState() != Document::LoadingFailed);
+    }
+}
+
+void DecodeBench::benchmarkFullImage_data()
+{
+    addCorpusRows(QT_IMAGE_FORMATS);
+}
+
+void DecodeBench::benchmarkFullImage()
+{
+    QFETCH(QString, path);
+    const QUrl url = QUrl::fromLocalFile(path);
+    QBENCHMARK {
+        DocumentFactory::instance()->clearCache();
+        Document::Ptr doc = DocumentFactory::instance()->load(url);
+        doc->waitUntilLoaded();
+        QCOMPARE(doc->loadingState(), Document::Loaded);
+    }
+}
+
+void DecodeBench::benchmarkDownSampledImage_data()
+{
+    addCorpusRows(QT_IMAGE_FORMATS);
+}
+
+void DecodeBench::benchmarkDownSampledImage()
+{
+    QFETCH(QString, path);
+    const QUrl url = QUrl::fromLocalFile(path);
+    QBENCHMARK {
+        DocumentFactory::instance()->clearCache();
+        Document::Ptr doc = DocumentFactory::instance()->load(url);
+        QSignalSpy spy(doc.data(), &Document::downSampledImageReady);
+        if (!doc->prepareDownSampledImageForZoom(DOWN_SAMPLED_ZOOM)) {
+            while (spy.isEmpty() && doc->loadingState() != Document::LoadingFailed) {
+                QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+            }
+        }
+        QVERIFY(!doc->downSampledImageForZoom(DOWN_SAMPLED_ZOOM).isNull());
+    }
+}
+
+void DecodeBench::benchmarkScaledRead_data()
+{
+    addCorpusRows(QT_IMAGE_FORMATS);
+}
+
+void DecodeBench::benchmarkScaledRead()
+{
+    QFETCH(QString, path);
+    QByteArray data = readFile(path);
+    QBENCHMARK {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer, formatForPath(path));
+        QSize size = reader.size();
+        size.scale(SCALED_SIZE, Qt::KeepAspectRatio);
+        reader.setScaledSize(size);
+        QVERIFY(!reader.read().isNull());
+    }
+}
+
+void DecodeBench::benchmarkJpegContentLoad_data()
+{
+    addCorpusRows({"jpeg"});
+}
+
+void DecodeBench::benchmarkJpegContentLoad()
+{
+    QFETCH(QString, path);
+    const QByteArray data = readFile(path);
+    QBENCHMARK {
+        JpegContent content;
+        QVERIFY(content.loadFromData(data));
+    }
+}
+
+void DecodeBench::benchmarkJpegContentTransform_data()
+{
+    addCorpusRows({"jpeg"});
+}
+
+void DecodeBench::benchmarkJpegContentTransform()
+{
+    QFETCH(QString, path);
+    const QByteArray data = readFile(path);
+    QBENCHMARK {
+        JpegContent content;
+        QVERIFY(content.loadFromData(data));
+        content.transform(ROT_90);
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(content.save(&buffer));
+    }
+}
+
+void DecodeBench::benchmarkExiv2Load_data()
+{
+    addCorpusRows(QT_IMAGE_FORMATS);
+}
+
+void DecodeBench::benchmarkExiv2Load()
+{
+    QFETCH(QString, path);
+    const QByteArray data = readFile(path);
+    QBENCHMARK {
+        Exiv2ImageLoader loader;
+        QVERIFY2(loader.load(data), qPrintable(loader.errorMessage()));
+        QVERIFY(loader.popImage());
+    }
+}
+
+void DecodeBench::benchmarkCmsProfile_data()
+{
+    addCorpusRows(QT_IMAGE_FORMATS);
+}
+
+void DecodeBench::benchmarkCmsProfile()
+{
+    QFETCH(QString, path);
+    const QByteArray data = readFile(path);
+    const QByteArray format = formatForPath(path);
+    QBENCHMARK {
+        QVERIFY(Cms::Profile::loadFromImageData(data, format));
+    }
+}
+
+void DecodeBench::benchmarkFits_data()
+{
+    addCorpusRows({"fits"});
+}
+
+void DecodeBench::benchmarkFits()
+{
+#ifdef HAVE_FITS
+    QFETCH(QString, path);
+    QByteArray data = readFile(path);
+    QBENCHMARK {
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        QVERIFY(!FITSData::FITSToImage(buffer).isNull());
+    }
+#else
+    QSKIP("Built without FITS support");
+#endif
+}
@@ -0,0 +1,76 @@
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+*/
+#ifndef DECODEBENCH_H
+#define DECODEBENCH_H
+
+// Qt
+#include <QByteArrayList>
+#include <QObject>
+#include <QStringList>
+#include <QTemporaryDir>
+
+/**
+ * Benchmarks the decoding paths of Gwenview over a generated corpus of
+ * images of several sizes and formats.
+ *
+ * Run it with "-o decodebench.xml,xml" (or the decodebench-results target)
+ * to get results which can be compared between two builds. The
+ * decodebench-baseline target stores the results of a build, and
+ * decodebench-compare fails if a later build is slower by more than
+ * DECODEBENCH_THRESHOLD percent, see decodebenchcompare.
+ */
+class DecodeBench : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+
+    void benchmarkMetaInfo_data();
+    void benchmarkMetaInfo();
+    void benchmarkFullImage_data();
+    void benchmarkFullImage();
+    void benchmarkDownSampledImage_data();
+    void benchmarkDownSampledImage();
+    void benchmarkScaledRead_data();
+    void benchmarkScaledRead();
+    void benchmarkJpegContentLoad_data();
+    void benchmarkJpegContentLoad();
+    void benchmarkJpegContentTransform_data();
+    void benchmarkJpegContentTransform();
+    void benchmarkExiv2Load_data();
+    void benchmarkExiv2Load();
+    void benchmarkCmsProfile_data();
+    void benchmarkCmsProfile();
+    void benchmarkFits_data();
+    void benchmarkFits();
+
+private:
+    /**
+     * Adds a row for each file of the corpus in one of @p formats
+     */
+    void addCorpusRows(const QByteArrayList &formats);
+
+    QTemporaryDir mCorpusDir;
+    QStringList mCorpus;
+};
+
+#endif /* DECODEBENCH_H */
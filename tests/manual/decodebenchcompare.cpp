@@ -0,0 +1,128 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// Qt
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QMap>
+#include <QXmlStreamReader>
+#include <QtDebug>
+
+// Compares two result files written by decodebench with "-o <file>,xml", and
+// fails if a benchmark got slower than the threshold allows
+
+// Benchmark results by "function/tag (metric)"
+using Results = QMap<QString, qreal>;
+
+static bool readResults(const QString &path, Results *results)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning().noquote() << QStringLiteral("Could not open %1: %2").arg(path, file.errorString());
+        return false;
+    }
+    QXmlStreamReader reader(&file);
+    QString function;
+    while (!reader.atEnd()) {
+        if (!reader.readNextStartElement()) {
+            continue;
+        }
+        const QXmlStreamAttributes attributes = reader.attributes();
+        if (reader.name() == QLatin1String("TestFunction")) {
+            function = attributes.value(QLatin1String("name")).toString();
+        } else if (reader.name() == QLatin1String("BenchmarkResult")) {
+            // The value is per iteration
+            const QString key = QStringLiteral("%1/%2 (%3)")
+                                    .arg(function, attributes.value(QLatin1String("tag")).toString(), attributes.value(QLatin1String("metric")).toString());
+            results->insert(key, attributes.value(QLatin1String("value")).toDouble());
+        }
+    }
+    if (reader.hasError()) {
+        qWarning().noquote() << QStringLiteral("Could not read %1: %2").arg(path, reader.errorString());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Compares decodebench results with a baseline"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("baseline"), QStringLiteral("Results of the reference build"));
+    parser.addPositionalArgument(QStringLiteral("results"), QStringLiteral("Results to check"));
+    parser.addOption(QCommandLineOption(QStringLiteral("threshold"),
+                                        QStringLiteral("Fail if a benchmark is more than <percent> slower than the baseline"),
+                                        QStringLiteral("percent"),
+                                        QStringLiteral("10")));
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.count() != 2) {
+        parser.showHelp(1);
+    }
+    bool ok;
+    const qreal threshold = parser.value(QStringLiteral("threshold")).toDouble(&ok);
+    if (!ok || threshold < 0) {
+        qWarning() << "Invalid threshold";
+        return 1;
+    }
+
+    Results baseline;
+    Results results;
+    if (!readResults(args.at(0), &baseline) || !readResults(args.at(1), &results)) {
+        return 1;
+    }
+
+    int regressionCount = 0;
+    for (auto it = results.constBegin(); it != results.constEnd(); ++it) {
+        if (!baseline.contains(it.key())) {
+            qWarning().noquote() << QStringLiteral("%1: %2, not in the baseline").arg(it.key()).arg(it.value());
+            continue;
+        }
+        const qreal reference = baseline.value(it.key());
+        const qreal change = reference > 0 ? (it.value() - reference) * 100 / reference : 0;
+        const bool regression = change > threshold;
+        if (regression) {
+            ++regressionCount;
+        }
+        qWarning().noquote() << QStringLiteral("%1: %2 -> %3 (%4%5%)%6")
+                                    .arg(it.key())
+                                    .arg(reference)
+                                    .arg(it.value())
+                                    .arg(change >= 0 ? QStringLiteral("+") : QString())
+                                    .arg(change, 0, 'f', 1)
+                                    .arg(regression ? QStringLiteral(" REGRESSION") : QString());
+    }
+    for (auto it = baseline.constBegin(); it != baseline.constEnd(); ++it) {
+        if (!results.contains(it.key())) {
+            qWarning().noquote() << QStringLiteral("%1: missing from the results").arg(it.key());
+        }
+    }
+
+    if (regressionCount > 0) {
+        qWarning().noquote() << QStringLiteral("%1 benchmarks are more than %2% slower than the baseline").arg(regressionCount).arg(threshold);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,375 @@
+// vim: set tabstop=4 shiftwidth=4 expandtab:
+/*
+Gwenview: an image viewer
+Copyright 2022 Gwenview developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
+
+*/
+// STL
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Local
+#include <lib/about.h>
+#include <lib/document/documentfactory.h>
+#include <lib/documentview/documentview.h>
+#include <lib/documentview/rasterimageview.h>
+#include <lib/gwenviewconfig.h>
+
+// KF
+#include <KAboutData>
+#include <KLocalizedString>
+
+// Qt
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGraphicsScene>
+#include <QGraphicsView>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLinearGradient>
+#include <QPainter>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtDebug>
+
+using namespace Gwenview;
+
+static const QSize GENERATED_SIZES[] = {{1920, 1080}, {4000, 3000}, {8000, 6000}};
+
+static const qreal MAXIMUM_ZOOM = 8.0;
+
+static const int ZOOM_FRAME_COUNT = 60;
+static const int PAN_FRAME_COUNT = 60;
+static const int BIRD_EYE_FRAME_COUNT = 30;
+
+// Zoom used by the pan and bird eye scenarios
+static const qreal PAN_ZOOM = 2.0;
+
+static const int LOAD_TIMEOUT = 60000;
+
+struct ScenarioResult {
+    QString image;
+    QString scenario;
+    bool colorManaged;
+    int viewCount;
+    bool parallel;
+    // Frame times, in µs
+    QVector<qint64> frameTimes;
+};
+
+static qint64 percentile(const QVector<qint64> &sortedValues, qreal ratio)
+{
+    if (sortedValues.isEmpty()) {
+        return 0;
+    }
+    return sortedValues.at(qMin(sortedValues.count() - 1, int(sortedValues.count() * ratio)));
+}
+
+static QStringList generateImages(const QString &dirName)
+{
+    QStringList paths;
+    for (const QSize &size : GENERATED_SIZES) {
+        QImage image(size, QImage::Format_RGB32);
+        QPainter painter(&image);
+        QLinearGradient gradient(0, 0, size.width(), size.height());
+        gradient.setColorAt(0, Qt::darkBlue);
+        gradient.setColorAt(0.5, Qt::yellow);
+        gradient.setColorAt(1, Qt::darkGreen);
+        painter.fillRect(image.rect(), gradient);
+        // Details, so that smooth scaling has something to do
+        for (int x = 0; x < size.width(); x += 50) {
+            painter.drawLine(x, 0, size.width() - x, size.height());
+        }
+        painter.end();
+
+        const QString path = dirName + QStringLiteral("/%1x%2.png").arg(size.width()).arg(size.height());
+        if (!image.save(path, "png")) {
+            qFatal("Could not write %s", qPrintable(path));
+        }
+        paths << path;
+    }
+    return paths;
+}
+
+/**
+ * Renders DocumentView frames offscreen, the way the view widget would. With
+ * several views, they are laid out side by side like in compare mode.
+ */
+class FrameRenderer
+{
+public:
+    FrameRenderer(const QSize &viewportSize, int viewCount)
+        : mGraphicsView(&mScene)
+        , mFrame(viewportSize, QImage::Format_ARGB32_Premultiplied)
+    {
+        mGraphicsView.resize(viewportSize);
+        mScene.setSceneRect(QRectF(QPointF(), viewportSize));
+
+        // Same layout as DocumentViewContainer
+        const int colCount = viewCount == 4 ? 2 : qMin(viewCount, 3);
+        const int rowCount = (viewCount + colCount - 1) / colCount;
+        const QSizeF viewSize(viewportSize.width() / colCount, viewportSize.height() / rowCount);
+        for (int i = 0; i < viewCount; ++i) {
+            auto view = new DocumentView(&mScene);
+            view->setGeometry(QRectF(QPointF((i % colCount) * viewSize.width(), (i / colCount) * viewSize.height()), viewSize));
+            view->setGraphicsEffectOpacity(1);
+            view->setCompareMode(viewCount > 1);
+            view->setCurrent(i == 0);
+            mDocumentViews << view;
+        }
+    }
+
+    ~FrameRenderer()
+    {
+        qDeleteAll(mDocumentViews);
+    }
+
+    bool open(const QUrl &url)
+    {
+        for (DocumentView *view : qAsConst(mDocumentViews)) {
+            QSignalSpy spy(view, &DocumentView::completed);
+            view->openUrl(url, DocumentView::Setup());
+            if (!spy.wait(LOAD_TIMEOUT) || !view->imageView()) {
+                return false;
+            }
+            view->document()->waitUntilLoaded();
+            if (view->document()->loadingState() != Document::Loaded) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const QVector<DocumentView *> &documentViews() const
+    {
+        return mDocumentViews;
+    }
+
+    /**
+     * Calls @p change, then renders a frame. Returns the time spent, in µs.
+     */
+    template<typename Function>
+    qint64 frame(Function change)
+    {
+        QElapsedTimer chrono;
+        chrono.start();
+        change();
+        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+        QPainter painter(&mFrame);
+        mScene.render(&painter, QRectF(mFrame.rect()), mScene.sceneRect());
+        painter.end();
+        return chrono.nsecsElapsed() / 1000;
+    }
+
+private:
+    QGraphicsScene mScene;
+    QGraphicsView mGraphicsView;
+    QVector<DocumentView *> mDocumentViews;
+    QImage mFrame;
+};
+
+static QVector<ScenarioResult> benchmarkImage(const QString &path, const QSize &viewportSize, int viewCount, bool colorManaged, bool parallel)
+{
+    QVector<ScenarioResult> results;
+    DocumentFactory::instance()->clearCache();
+    GwenviewConfig::setParallelViewRendering(parallel);
+    FrameRenderer renderer(viewportSize, viewCount);
+    if (!renderer.open(QUrl::fromLocalFile(path))) {
+        qWarning() << "Could not load" << path;
+        return results;
+    }
+    // Changes are applied to all the views, as the synchronizer does in
+    // compare mode
+    const QVector<DocumentView *> views = renderer.documentViews();
+    DocumentView *view = views.first();
+    for (DocumentView *documentView : views) {
+        documentView->imageView()->setDisplayTransformEnabled(colorManaged);
+    }
+    RasterImageView *imageView = view->imageView();
+    const QSize imageSize = view->document()->size();
+    const QSize viewSize = view->size().toSize();
+    const QString imageName = QStringLiteral("%1x%2").arg(imageSize.width()).arg(imageSize.height());
+
+    auto newResult = [&](const QString &scenario) -> ScenarioResult & {
+        results << ScenarioResult{imageName, scenario, colorManaged, viewCount, parallel, {}};
+        return results.last();
+    };
+
+    // First frame, not measured: creates the display transform
+    renderer.frame([] {});
+
+    // Zoom sweep, from zoom to fit to the maximum zoom and back
+    {
+        ScenarioResult &result = newResult(QStringLiteral("zoom"));
+        const qreal fitZoom = imageView->computeZoomToFit();
+        const qreal step = std::pow(MAXIMUM_ZOOM / fitZoom, 1.0 / (ZOOM_FRAME_COUNT / 2 - 1));
+        for (int i = 0; i < ZOOM_FRAME_COUNT; ++i) {
+            const int exponent = i < ZOOM_FRAME_COUNT / 2 ? i : ZOOM_FRAME_COUNT - 1 - i;
+            const qreal zoom = fitZoom * std::pow(step, exponent);
+            result.frameTimes << renderer.frame([&views, zoom] {
+                for (DocumentView *documentView : views) {
+                    documentView->setZoom(zoom);
+                }
+            });
+        }
+    }
+
+    // Pan along the diagonal of the image
+    for (DocumentView *documentView : views) {
+        documentView->setZoom(PAN_ZOOM);
+    }
+    const QSize scrollRange = (QSizeF(imageSize) * PAN_ZOOM).toSize() - viewSize;
+    {
+        ScenarioResult &result = newResult(QStringLiteral("pan"));
+        for (int i = 0; i < PAN_FRAME_COUNT; ++i) {
+            const QPoint position(qMax(0, scrollRange.width()) * i / PAN_FRAME_COUNT, qMax(0, scrollRange.height()) * i / PAN_FRAME_COUNT);
+            result.frameTimes << renderer.frame([&views, position] {
+                for (DocumentView *documentView : views) {
+                    documentView->setPosition(position);
+                }
+            });
+        }
+    }
+
+    // Jumps, as done by clicking in the bird eye view
+    {
+        ScenarioResult &result = newResult(QStringLiteral("birdeye"));
+        quint32 seed = 1;
+        for (int i = 0; i < BIRD_EYE_FRAME_COUNT; ++i) {
+            seed = seed * 1103515245 + 12345;
+            const QPoint position(qMax(1, scrollRange.width()) * ((seed >> 8) & 0xff) / 255, qMax(1, scrollRange.height()) * ((seed >> 16) & 0xff) / 255);
+            result.frameTimes << renderer.frame([&views, position] {
+                for (DocumentView *documentView : views) {
+                    documentView->setPosition(position);
+                }
+            });
+        }
+    }
+    return results;
+}
+
+static void printResult(ScenarioResult result)
+{
+    QVector<qint64> &times = result.frameTimes;
+    std::sort(times.begin(), times.end());
+    const qint64 total = std::accumulate(times.constBegin(), times.constEnd(), qint64(0));
+    QString views;
+    if (result.viewCount > 1) {
+        views = QStringLiteral(" %1 views %2").arg(result.viewCount).arg(result.parallel ? QStringLiteral("parallel") : QStringLiteral("serial"));
+    }
+    qWarning().noquote() << QStringLiteral("%1 %2 %3%10: %4 frames, mean %5 ms, p50 %6 ms, p90 %7 ms, p99 %8 ms, max %9 ms")
+                                .arg(result.image, -10)
+                                .arg(result.scenario, -8)
+                                .arg(result.colorManaged ? QStringLiteral("cms") : QStringLiteral("no-cms"), -7)
+                                .arg(times.count())
+                                .arg(times.isEmpty() ? 0. : total / 1000.0 / times.count(), 0, 'f', 2)
+                                .arg(percentile(times, 0.5) / 1000.0, 0, 'f', 2)
+                                .arg(percentile(times, 0.9) / 1000.0, 0, 'f', 2)
+                                .arg(percentile(times, 0.99) / 1000.0, 0, 'f', 2)
+                                .arg(times.isEmpty() ? 0. : times.last() / 1000.0, 0, 'f', 2)
+                                .arg(views);
+}
+
+static QJsonObject resultToJson(const ScenarioResult &result)
+{
+    QJsonArray frameTimes;
+    for (qint64 time : result.frameTimes) {
+        frameTimes << time / 1000.0;
+    }
+    return QJsonObject{
+        {QStringLiteral("image"), result.image},
+        {QStringLiteral("scenario"), result.scenario},
+        {QStringLiteral("colorManaged"), result.colorManaged},
+        {QStringLiteral("views"), result.viewCount},
+        {QStringLiteral("parallel"), result.parallel},
+        {QStringLiteral("frameTimesMs"), frameTimes},
+    };
+}
+
+int main(int argc, char **argv)
+{
+    // Rendering is done offscreen, no need for a display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    KLocalizedString::setApplicationDomain("documentviewbench");
+    QScopedPointer<KAboutData> aboutData(Gwenview::createAboutData(QStringLiteral("documentviewbench"), /* component name */
+                                                                   i18n("documentviewbench") /* display name */
+                                                                   ));
+
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    aboutData->setupCommandLine(&parser);
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("images", i18n("Images to render. Images of several sizes are generated if none is given"), "[images...]");
+    parser.addOption(QCommandLineOption(QStringLiteral("viewport"), i18n("Size of the rendered view"), "WxH", QStringLiteral("1920x1080")));
+    parser.addOption(QCommandLineOption(QStringLiteral("json"), i18n("Write the frame times to <file> as JSON"), "file"));
+    parser.addOption(QCommandLineOption(QStringLiteral("views"),
+                                        i18n("Number of views showing the image side by side, as in compare mode. Several views are rendered in parallel "
+                                             "and one after the other."),
+                                        "count",
+                                        QStringLiteral("1")));
+    parser.process(app);
+    aboutData->processCommandLine(&parser);
+
+    const QStringList sizeTokens = parser.value(QStringLiteral("viewport")).split(QLatin1Char('x'));
+    const QSize viewportSize = sizeTokens.count() == 2 ? QSize(sizeTokens.first().toInt(), sizeTokens.last().toInt()) : QSize();
+    if (viewportSize.isEmpty()) {
+        qFatal("Invalid viewport size: %s", qPrintable(parser.value(QStringLiteral("viewport"))));
+    }
+
+    const int viewCount = parser.value(QStringLiteral("views")).toInt();
+    if (viewCount < 1) {
+        qFatal("Invalid view count: %s", qPrintable(parser.value(QStringLiteral("views"))));
+    }
+
+    QTemporaryDir tempDir;
+    QStringList paths = parser.positionalArguments();
+    if (paths.isEmpty()) {
+        paths = generateImages(tempDir.path());
+    }
+
+    QJsonArray jsonResults;
+    for (const QString &path : qAsConst(paths)) {
+        for (bool colorManaged : {true, false}) {
+            const QList<bool> parallelModes = viewCount > 1 ? QList<bool>{true, false} : QList<bool>{true};
+            for (bool parallel : parallelModes) {
+                const QVector<ScenarioResult> results = benchmarkImage(path, viewportSize, viewCount, colorManaged, parallel);
+                for (const ScenarioResult &result : results) {
+                    printResult(result);
+                    jsonResults << resultToJson(result);
+                }
+            }
+        }
+    }
+
+    if (parser.isSet(QStringLiteral("json"))) {
+        QFile file(parser.value(QStringLiteral("json")));
+        if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(jsonResults).toJson()) < 0) {
+            qFatal("Could not write %s", qPrintable(file.fileName()));
+        }
+    }
+
+    return 0;
+}
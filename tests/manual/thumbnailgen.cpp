@@ -18,6 +18,10 @@ along with this program; if not, write to the Free Software
 Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA.
 
 */
+// STL
+#include <algorithm>
+#include <numeric>
+
 // Local
 #include <../auto/testutils.h>
 #include <lib/about.h>
@@ -29,12 +33,303 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Cambridge, MA 02110-1301, USA
 
 // Qt
 #include <QCommandLineParser>
+#include <QCryptographicHash>
 #include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageWriter>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainter>
 #include <QTime>
 #include <QtDebug>
 
+// System
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
 using namespace Gwenview;
 
+struct GroupInfo {
+    const char *name;
+    ThumbnailGroup::Enum group;
+};
+
+static const GroupInfo GROUP_INFOS[] = {
+    {"normal", ThumbnailGroup::Normal},
+    {"large", ThumbnailGroup::Large},
+    {"x-large", ThumbnailGroup::XLarge},
+    {"xx-large", ThumbnailGroup::XXLarge},
+};
+
+enum class CacheMode {
+    AsIs,
+    Cold,
+    Warm,
+};
+
+struct RunResult {
+    QString groupName;
+    int itemCount = 0;
+    int failureCount = 0;
+    int cacheHitCount = 0;
+    qint64 wallTime = 0; // ms
+    qint64 cpuTime = 0; // ms
+    qint64 drainTime = 0; // ms
+    int maxWriterBacklog = 0;
+    // Time from the request to the thumbnail, in µs
+    QVector<qint64> latencies;
+    // Time between two consecutive thumbnails, in µs
+    QVector<qint64> intervals;
+};
+
+static qint64 percentile(QVector<qint64> values, qreal ratio)
+{
+    if (values.isEmpty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values.at(qMin(values.count() - 1, int(values.count() * ratio)));
+}
+
+static qint64 cpuTime()
+{
+#ifdef Q_OS_UNIX
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000 + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+    }
+#endif
+    return 0;
+}
+
+/**
+ * Parses a format mix such as "jpeg:80,png:20" into format => weight
+ */
+static QVector<QPair<QByteArray, int>> parseFormatMix(const QString &text)
+{
+    QVector<QPair<QByteArray, int>> mix;
+    const QStringList tokens = text.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    for (const QString &token : tokens) {
+        const QByteArray format = token.section(QLatin1Char(':'), 0, 0).toLatin1();
+        const int weight = token.contains(QLatin1Char(':')) ? token.section(QLatin1Char(':'), 1).toInt() : 1;
+        if (!QImageWriter::supportedImageFormats().contains(format)) {
+            qFatal("Cannot write images in format %s", format.constData());
+        }
+        if (weight > 0) {
+            mix << qMakePair(format, weight);
+        }
+    }
+    return mix;
+}
+
+/**
+ * Creates @p count images in subdirectories of @p dirName, following the
+ * format weights of @p mix
+ */
+static void generateImageTree(const QString &dirName, int count, const QSize &size, const QVector<QPair<QByteArray, int>> &mix, int filesPerDir)
+{
+    const int totalWeight = std::accumulate(mix.constBegin(), mix.constEnd(), 0, [](int total, const QPair<QByteArray, int> &entry) {
+        return total + entry.second;
+    });
+    if (totalWeight == 0) {
+        qFatal("Empty format mix");
+    }
+
+    QImage base(size, QImage::Format_RGB32);
+    {
+        QPainter painter(&base);
+        QLinearGradient gradient(0, 0, size.width(), size.height());
+        gradient.setColorAt(0, Qt::darkBlue);
+        gradient.setColorAt(0.5, Qt::yellow);
+        gradient.setColorAt(1, Qt::darkGreen);
+        painter.fillRect(base.rect(), gradient);
+    }
+
+    QDir dir(dirName);
+    for (int index = 0; index < count; ++index) {
+        // Spread the formats evenly rather than in blocks
+        int slot = (index * 7919) % totalWeight;
+        QByteArray format = mix.last().first;
+        for (const auto &entry : mix) {
+            if (slot < entry.second) {
+                format = entry.first;
+                break;
+            }
+            slot -= entry.second;
+        }
+
+        const QString subDirName = QStringLiteral("%1").arg(index / filesPerDir, 4, 10, QLatin1Char('0'));
+        if (!dir.mkpath(subDirName)) {
+            qFatal("Could not create %s", qPrintable(dir.filePath(subDirName)));
+        }
+        QImage image = base;
+        {
+            QPainter painter(&image);
+            painter.fillRect(QRect(index % size.width(), 0, size.width() / 10, size.height()), QColor::fromHsv(index * 37 % 360, 200, 200));
+        }
+        const QString path = dir.filePath(QStringLiteral("%1/image%2.%3").arg(subDirName).arg(index, 6, 10, QLatin1Char('0')).arg(QString::fromLatin1(format)));
+        if (!image.save(path, format.constData())) {
+            qFatal("Could not write %s", qPrintable(path));
+        }
+    }
+    qWarning() << "Generated" << count << "images in" << dirName;
+}
+
+/**
+ * Evicts the files of @p list from the page cache. Dropping the whole page
+ * cache requires root, otherwise the kernel is asked to evict each file.
+ */
+static void dropPageCache(const KFileItemList &list)
+{
+#ifdef Q_OS_LINUX
+    sync();
+    QFile dropCaches(QStringLiteral("/proc/sys/vm/drop_caches"));
+    if (dropCaches.open(QIODevice::WriteOnly) && dropCaches.write("1\n") == 2) {
+        return;
+    }
+    for (const KFileItem &item : list) {
+        const int fd = open(QFile::encodeName(item.localPath()).constData(), O_RDONLY);
+        if (fd >= 0) {
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+#else
+    Q_UNUSED(list);
+    qWarning() << "Dropping the page cache is not supported on this platform";
+#endif
+}
+
+static QString thumbnailPath(const KFileItem &item, ThumbnailGroup::Enum group)
+{
+    // See the freedesktop.org thumbnail specification
+    const QByteArray uri = QFile::encodeName(item.url().adjusted(QUrl::RemovePassword).url());
+    return ThumbnailProvider::thumbnailBaseDir(group) + QString::fromLatin1(QCryptographicHash::hash(uri, QCryptographicHash::Md5).toHex())
+        + QStringLiteral(".png");
+}
+
+static void waitForThumbnailWriter(RunResult *result)
+{
+    waitForDeferredDeletes();
+    while (!ThumbnailProvider::isThumbnailWriterEmpty()) {
+        result->maxWriterBacklog = qMax(result->maxWriterBacklog, ThumbnailProvider::thumbnailWriterBacklog());
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+}
+
+static RunResult run(const KFileItemList &list, const GroupInfo &info, bool perFormatReport)
+{
+    RunResult result;
+    result.groupName = QString::fromLatin1(info.name);
+    result.itemCount = list.count();
+    for (const KFileItem &item : list) {
+        if (QFile::exists(thumbnailPath(item, info.group))) {
+            ++result.cacheHitCount;
+        }
+    }
+
+    ThumbnailProvider job;
+    job.setThumbnailGroup(info.group);
+
+    // Items are processed one after the other: the time between two
+    // consecutive results is accounted to the second one
+    QHash<QString, QVector<qint64>> timingsForFormat;
+    QElapsedTimer chrono;
+    QElapsedTimer itemChrono;
+    auto recordTiming = [&](const KFileItem &item) {
+        const qint64 interval = itemChrono.nsecsElapsed() / 1000;
+        itemChrono.restart();
+        result.latencies << chrono.nsecsElapsed() / 1000;
+        result.intervals << interval;
+        result.maxWriterBacklog = qMax(result.maxWriterBacklog, ThumbnailProvider::thumbnailWriterBacklog());
+        if (perFormatReport) {
+            timingsForFormat[QFileInfo(item.url().fileName()).suffix().toLower()] << interval;
+        }
+    };
+    QObject::connect(&job, &ThumbnailProvider::thumbnailLoaded, recordTiming);
+    QObject::connect(&job, &ThumbnailProvider::thumbnailLoadingFailed, [&](const KFileItem &item) {
+        ++result.failureCount;
+        recordTiming(item);
+    });
+
+    const qint64 cpuStart = cpuTime();
+    chrono.start();
+    itemChrono.start();
+    job.appendItems(list);
+
+    QEventLoop loop;
+    QObject::connect(&job, SIGNAL(finished()), &loop, SLOT(quit()));
+    loop.exec();
+
+    result.wallTime = chrono.restart();
+    waitForThumbnailWriter(&result);
+    result.drainTime = chrono.elapsed();
+    result.cpuTime = cpuTime() - cpuStart;
+
+    for (auto it = timingsForFormat.constBegin(); it != timingsForFormat.constEnd(); ++it) {
+        QVector<qint64> timings = it.value();
+        std::sort(timings.begin(), timings.end());
+        const qint64 total = std::accumulate(timings.constBegin(), timings.constEnd(), qint64(0));
+        qWarning().noquote() << QStringLiteral("%1: %2 files, total %3 ms, average %4 ms, median %5 ms, max %6 ms")
+                                    .arg(it.key().isEmpty() ? QStringLiteral("(no extension)") : it.key())
+                                    .arg(timings.count())
+                                    .arg(total / 1000.0, 0, 'f', 1)
+                                    .arg(total / 1000.0 / timings.count(), 0, 'f', 1)
+                                    .arg(timings.at(timings.count() / 2) / 1000.0, 0, 'f', 1)
+                                    .arg(timings.last() / 1000.0, 0, 'f', 1);
+    }
+    return result;
+}
+
+static void printResult(const RunResult &result, const QString &modeName)
+{
+    const qreal seconds = qMax<qint64>(result.wallTime, 1) / 1000.0;
+    qWarning().noquote() << QStringLiteral("%1 (%2): %3 items in %4 s, %5 items/s, %6 failed, %7 cache hits")
+                                .arg(result.groupName, modeName)
+                                .arg(result.itemCount)
+                                .arg(seconds, 0, 'f', 2)
+                                .arg(result.itemCount / seconds, 0, 'f', 1)
+                                .arg(result.failureCount)
+                                .arg(result.cacheHitCount);
+    qWarning().noquote() << QStringLiteral("  time to thumbnail: p50 %1 ms, p99 %2 ms; per item: p50 %3 ms, p99 %4 ms")
+                                .arg(percentile(result.latencies, 0.5) / 1000.0, 0, 'f', 1)
+                                .arg(percentile(result.latencies, 0.99) / 1000.0, 0, 'f', 1)
+                                .arg(percentile(result.intervals, 0.5) / 1000.0, 0, 'f', 1)
+                                .arg(percentile(result.intervals, 0.99) / 1000.0, 0, 'f', 1);
+    qWarning().noquote() << QStringLiteral("  CPU %1% of one core, writer backlog max %2, %3 ms to save pending thumbnails")
+                                .arg(100. * result.cpuTime / qMax<qint64>(result.wallTime + result.drainTime, 1), 0, 'f', 0)
+                                .arg(result.maxWriterBacklog)
+                                .arg(result.drainTime);
+}
+
+static QJsonObject resultToJson(const RunResult &result, const QString &modeName)
+{
+    return QJsonObject{
+        {QStringLiteral("group"), result.groupName},
+        {QStringLiteral("mode"), modeName},
+        {QStringLiteral("items"), result.itemCount},
+        {QStringLiteral("failures"), result.failureCount},
+        {QStringLiteral("cacheHits"), result.cacheHitCount},
+        {QStringLiteral("wallTimeMs"), result.wallTime},
+        {QStringLiteral("cpuTimeMs"), result.cpuTime},
+        {QStringLiteral("drainTimeMs"), result.drainTime},
+        {QStringLiteral("itemsPerSecond"), result.itemCount * 1000. / qMax<qint64>(result.wallTime, 1)},
+        {QStringLiteral("latencyP50Ms"), percentile(result.latencies, 0.5) / 1000.0},
+        {QStringLiteral("latencyP99Ms"), percentile(result.latencies, 0.99) / 1000.0},
+        {QStringLiteral("intervalP50Ms"), percentile(result.intervals, 0.5) / 1000.0},
+        {QStringLiteral("intervalP99Ms"), percentile(result.intervals, 0.99) / 1000.0},
+        {QStringLiteral("maxWriterBacklog"), result.maxWriterBacklog},
+    };
+}
+
 int main(int argc, char **argv)
 {
     KLocalizedString::setApplicationDomain("thumbnailgen");
@@ -49,10 +344,29 @@ int main(int argc, char **argv)
     parser.addHelpOption();
     parser.addVersionOption();
     parser.addPositionalArgument("image-dir", i18n("Image dir to open"));
-    parser.addPositionalArgument("size", i18n("What size of thumbnails to generate. Can be either 'normal' or 'large'"));
+    parser.addPositionalArgument("size",
+                                 i18n("What size of thumbnails to generate. Can be 'normal', 'large', 'x-large', 'xx-large' or 'all' to compare them"));
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("t") << QStringLiteral("thumbnail-dir"),
                                         i18n("Use <dir> instead of ~/.thumbnails to store thumbnails"),
                                         "thumbnail-dir"));
+    parser.addOption(QCommandLineOption(QStringLiteral("benchmark"),
+                                        i18n("Report the time spent on each file format. Use an empty thumbnail dir to measure generation")));
+    parser.addOption(QCommandLineOption(QStringLiteral("no-jpeg-fast-path"), i18n("Decode JPEG files with QImageReader instead of the dedicated decoder")));
+    parser.addOption(QCommandLineOption(QStringLiteral("compare-jpeg-paths"),
+                                        i18n("Run each size with QImageReader, then with the dedicated JPEG decoder, and report the speedup. Requires --cache cold")));
+    parser.addOption(QCommandLineOption(QStringLiteral("generate"), i18n("Fill image-dir with <count> generated images first"), "count"));
+    parser.addOption(QCommandLineOption(QStringLiteral("formats"),
+                                        i18n("Format mix of the generated images, as format:weight pairs"),
+                                        "mix",
+                                        QStringLiteral("jpeg:80,png:20")));
+    parser.addOption(QCommandLineOption(QStringLiteral("image-size"), i18n("Size of the generated images"), "WxH", QStringLiteral("3000x2000")));
+    parser.addOption(QCommandLineOption(QStringLiteral("files-per-dir"), i18n("Number of generated images per directory"), "count", QStringLiteral("200")));
+    parser.addOption(QCommandLineOption(QStringLiteral("cache"),
+                                        i18n("'cold' empties the thumbnail dir and drops the page cache before each run, 'warm' does an unmeasured run "
+                                             "first, 'as-is' uses the caches in their current state"),
+                                        "mode",
+                                        QStringLiteral("as-is")));
+    parser.addOption(QCommandLineOption(QStringLiteral("json"), i18n("Write the results to <file> as JSON"), "file"));
     parser.process(app);
     aboutData->processCommandLine(&parser);
 
@@ -63,15 +377,36 @@ int main(int argc, char **argv)
         return 1;
     }
     const QString imageDirName = args.first();
-    ThumbnailGroup::Enum group = ThumbnailGroup::Normal;
-    if (args.last() == "large") {
-        group = ThumbnailGroup::Large;
-    } else if (args.last() == "normal") {
-        // group is already set to the right value
-    } else {
+    QVector<GroupInfo> groupInfos;
+    for (const GroupInfo &info : GROUP_INFOS) {
+        if (args.last() == QLatin1String("all") || args.last() == QLatin1String(info.name)) {
+            groupInfos << info;
+        }
+    }
+    if (groupInfos.isEmpty()) {
         qFatal("Invalid thumbnail size: %s", qPrintable(args.last()));
     }
     QString thumbnailBaseDirName = parser.value(QStringLiteral("thumbnail-dir"));
+    const bool compareJpegPaths = parser.isSet(QStringLiteral("compare-jpeg-paths"));
+    ThumbnailProvider::setJpegFastPathEnabled(!parser.isSet(QStringLiteral("no-jpeg-fast-path")));
+
+    CacheMode cacheMode = CacheMode::AsIs;
+    const QString modeName = parser.value(QStringLiteral("cache"));
+    if (modeName == QLatin1String("cold")) {
+        cacheMode = CacheMode::Cold;
+        // Do not wipe the thumbnails of the user
+        if (thumbnailBaseDirName.isEmpty()) {
+            qFatal("--cache cold requires --thumbnail-dir");
+        }
+    } else if (modeName == QLatin1String("warm")) {
+        cacheMode = CacheMode::Warm;
+    } else if (modeName != QLatin1String("as-is")) {
+        qFatal("Invalid cache mode: %s", qPrintable(modeName));
+    }
+    if (compareJpegPaths && cacheMode != CacheMode::Cold) {
+        // With existing thumbnails, neither decoder would run
+        qFatal("--compare-jpeg-paths requires --cache cold");
+    }
 
     // Set up thumbnail base dir
     if (!thumbnailBaseDirName.isEmpty()) {
@@ -90,36 +425,66 @@ int main(int argc, char **argv)
         ThumbnailProvider::setThumbnailBaseDir(thumbnailBaseDirName);
     }
 
+    // Generate images
+    if (parser.isSet(QStringLiteral("generate"))) {
+        const QStringList sizeTokens = parser.value(QStringLiteral("image-size")).split(QLatin1Char('x'));
+        const QSize size = sizeTokens.count() == 2 ? QSize(sizeTokens.first().toInt(), sizeTokens.last().toInt()) : QSize();
+        if (size.isEmpty()) {
+            qFatal("Invalid image size: %s", qPrintable(parser.value(QStringLiteral("image-size"))));
+        }
+        generateImageTree(imageDirName,
+                          parser.value(QStringLiteral("generate")).toInt(),
+                          size,
+                          parseFormatMix(parser.value(QStringLiteral("formats"))),
+                          qMax(1, parser.value(QStringLiteral("files-per-dir")).toInt()));
+    }
+
     // List dir
-    QDir dir(imageDirName);
     KFileItemList list;
-    const auto entryList = dir.entryList();
-    for (const QString &name : entryList) {
-        const QUrl url = QUrl::fromLocalFile(dir.absoluteFilePath(name));
-        KFileItem item(url);
-        list << item;
+    QDirIterator it(imageDirName, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        list << KFileItem(QUrl::fromLocalFile(it.next()));
     }
     qWarning() << "Generating thumbnails for" << list.count() << "files";
 
-    // Start the job
-    QElapsedTimer chrono;
-    ThumbnailProvider job;
-    job.setThumbnailGroup(group);
-    job.appendItems(list);
-
-    chrono.start();
-
-    QEventLoop loop;
-    QObject::connect(&job, SIGNAL(finished()), &loop, SLOT(quit()));
-    loop.exec();
-
-    qWarning() << "Time to generate thumbnails:" << chrono.restart();
+    QJsonArray jsonResults;
+    auto measure = [&](const GroupInfo &info, const QString &resultName) {
+        if (cacheMode == CacheMode::Cold) {
+            // Thumbnails of all groups are created from a single decode:
+            // remove them all, or the next groups would be cache hits
+            for (const GroupInfo &groupInfo : GROUP_INFOS) {
+                QDir(ThumbnailProvider::thumbnailBaseDir(groupInfo.group)).removeRecursively();
+            }
+            dropPageCache(list);
+        } else if (cacheMode == CacheMode::Warm) {
+            run(list, info, false);
+        }
+        const RunResult result = run(list, info, parser.isSet(QStringLiteral("benchmark")));
+        printResult(result, resultName);
+        jsonResults << resultToJson(result, resultName);
+        return result;
+    };
+    for (const GroupInfo &info : qAsConst(groupInfos)) {
+        if (!compareJpegPaths) {
+            measure(info, modeName);
+            continue;
+        }
+        ThumbnailProvider::setJpegFastPathEnabled(false);
+        const RunResult readerResult = measure(info, modeName + QStringLiteral(", QImageReader"));
+        ThumbnailProvider::setJpegFastPathEnabled(true);
+        const RunResult fastPathResult = measure(info, modeName + QStringLiteral(", JPEG decoder"));
+        qWarning().noquote() << QStringLiteral("%1: JPEG decoder is %2x faster than QImageReader (wall time), %3x (CPU time)")
+                                    .arg(QLatin1String(info.name))
+                                    .arg(qreal(readerResult.wallTime) / qMax<qint64>(fastPathResult.wallTime, 1), 0, 'f', 2)
+                                    .arg(qreal(readerResult.cpuTime) / qMax<qint64>(fastPathResult.cpuTime, 1), 0, 'f', 2);
+    }
 
-    waitForDeferredDeletes();
-    while (!ThumbnailProvider::isThumbnailWriterEmpty()) {
-        QCoreApplication::processEvents();
+    if (parser.isSet(QStringLiteral("json"))) {
+        QFile file(parser.value(QStringLiteral("json")));
+        if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(jsonResults).toJson()) < 0) {
+            qFatal("Could not write %s", qPrintable(file.fileName()));
+        }
     }
-    qWarning() << "Time to save pending thumbnails:" << chrono.restart();
 
     return 0;
 }